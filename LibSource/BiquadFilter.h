@@ -262,6 +262,7 @@ public:
         state[k*BIQUAD_STATE_VARIABLES_PER_STAGE]=d1;
         state[k*BIQUAD_STATE_VARIABLES_PER_STAGE+1]=d2;
       }
+      input=output; // subsequent stages process the output of the previous one
     }
 #endif /* ARM_CORTEX */
   }
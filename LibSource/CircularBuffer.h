@@ -0,0 +1,186 @@
+#ifndef __CircularBuffer_h__
+#define __CircularBuffer_h__
+
+#include <string.h>
+#include "FloatArray.h"
+#include "ShortArray.h"
+#include "basicmaths.h"
+#include "message.h"
+
+/**
+ * Circular buffer with a power of two size, so that indices wrap with a bit mask.
+ * Block reads and writes are done with at most two contiguous copies.
+ * Samples can be stored as float, or as Q15 fixed point int16_t to halve the memory footprint:
+ * FloatArray reads and writes convert on the fly.
+ *
+ * Large buffers can be placed in external memory by passing in a statically allocated array:
+ * @code
+ * static float buffer[1<<18] EXTERNAL_RAM;
+ * CircularBuffer<float> delay(buffer, 1<<18);
+ * @endcode
+ */
+template<typename T>
+class CircularBuffer {
+protected:
+  T* data;
+  uint32_t size;
+  uint32_t mask;
+  uint32_t writepos;
+
+  static void copy(float* dst, float* src, int len){
+    FloatArray(dst, len).copyFrom(src, len);
+  }
+  static void copy(int16_t* dst, int16_t* src, int len){
+    ShortArray(dst, len).copyFrom(src, len);
+  }
+  static void copy(int16_t* dst, float* src, int len){
+    ShortArray(dst, len).copyFrom(FloatArray(src, len));
+  }
+  static void copy(float* dst, int16_t* src, int len){
+    ShortArray(src, len).copyTo(FloatArray(dst, len));
+  }
+  static float toFloat(float value){
+    return value;
+  }
+  static float toFloat(int16_t value){
+    return value * (1.0f/32768);
+  }
+
+  template<typename S>
+  void writeBlock(S* src, int len){
+    ASSERT((uint32_t)len <= size, "Block too large");
+    uint32_t pos = writepos & mask;
+    uint32_t first = min((uint32_t)len, size-pos);
+    copy(data+pos, src, first);
+    if(first < (uint32_t)len)
+      copy(data, src+first, len-first);
+    writepos += len;
+  }
+
+  template<typename S>
+  void readBlock(S* dst, int len, int delay){
+    ASSERT((uint32_t)(len+delay) <= size, "Delay too long");
+    uint32_t pos = (writepos - delay - len) & mask;
+    uint32_t first = min((uint32_t)len, size-pos);
+    copy(dst, data+pos, first);
+    if(first < (uint32_t)len)
+      copy(dst+first, data, len-first);
+  }
+
+public:
+  CircularBuffer() : data(NULL), size(0), mask(0), writepos(0) {}
+
+  /**
+   * @param buf storage for the samples
+   * @param len number of samples, must be a power of two
+   */
+  CircularBuffer(T* buf, uint32_t len) : data(buf), size(len), mask(len-1), writepos(0) {
+    ASSERT((len & (len-1)) == 0, "Size must be a power of two");
+  }
+
+  uint32_t getSize(){
+    return size;
+  }
+
+  T* getData(){
+    return data;
+  }
+
+  /**
+   * Total number of samples written since construction or reset, wraps around at 2^32.
+   */
+  uint32_t getWriteIndex(){
+    return writepos;
+  }
+
+  void reset(){
+    writepos = 0;
+  }
+
+  void clear(){
+    memset(data, 0, size*sizeof(T));
+  }
+
+  /**
+   * Write a single sample.
+   */
+  void write(T value){
+    data[writepos++ & mask] = value;
+  }
+
+  /**
+   * Read a single sample.
+   * @param delay number of samples back from the last written one, 0 to size-1
+   */
+  T read(int delay){
+    return data[(writepos - 1 - delay) & mask];
+  }
+
+  /**
+   * Read a single sample, converted to a float
+   */
+  float readFloat(int delay){
+    return toFloat(read(delay));
+  }
+
+  /**
+   * Write a block of samples, converted to the storage type.
+   */
+  void write(FloatArray input){
+    writeBlock((float*)input, input.getSize());
+  }
+
+  /**
+   * Write a block of samples in the storage type.
+   */
+  void write(T* input, int len){
+    writeBlock(input, len);
+  }
+
+  /**
+   * Read a block of samples, converted to float.
+   * The last sample read is the one written @param delay samples before the most recent one,
+   * so with a delay of 0 this reads back the last output.getSize() samples written.
+   * For a delay effect, write the input block first, then read the delayed block.
+   */
+  void read(FloatArray output, int delay){
+    readBlock((float*)output, output.getSize(), delay);
+  }
+
+  /**
+   * Read a block of samples in the storage type.
+   */
+  void read(T* output, int len, int delay){
+    readBlock(output, len, delay);
+  }
+
+  /**
+   * Get the smallest power of two that is greater than or equal to @param len
+   */
+  static uint32_t getPowerOfTwo(uint32_t len){
+    uint32_t size = 1;
+    while(size < len)
+      size <<= 1;
+    return size;
+  }
+
+  /**
+   * Create a circular buffer that holds at least @param len samples, rounded up to a power of two.
+   */
+  static CircularBuffer<T>* create(uint32_t len){
+    len = getPowerOfTwo(len);
+    CircularBuffer<T>* obj = new CircularBuffer<T>(new T[len], len);
+    obj->clear();
+    return obj;
+  }
+
+  static void destroy(CircularBuffer<T>* obj){
+    delete[] obj->data;
+    delete obj;
+  }
+};
+
+typedef CircularBuffer<float> CircularFloatBuffer;
+typedef CircularBuffer<int16_t> CircularShortBuffer;
+
+#endif /* __CircularBuffer_h__ */
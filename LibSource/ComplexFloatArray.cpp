@@ -24,6 +24,12 @@ void ComplexFloatArray::getMagnitudeValues(FloatArray destination){
 #endif
 }
 
+void ComplexFloatArray::getPhaseValues(FloatArray destination){
+  ASSERT(destination.getSize()>=size, "Wrong size");
+  for(int i=0; i<size; i++)
+    destination[i] = polynomial_atan2f(data[i].im, data[i].re);
+}
+
 float ComplexFloatArray::mag2(const int i){
   float result;
 /// @note When built for ARM Cortex-M processor series, this method uses the optimized <a href="http://www.keil.com/pack/doc/CMSIS/General/html/index.html">CMSIS library</a>
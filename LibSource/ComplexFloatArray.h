@@ -136,6 +136,13 @@ public:
     @param[out] destination The array where the magnitude squared values will be stored.
   */  
   void getMagnitudeSquaredValues(FloatArray destination);
+
+  /**
+    The phases of the elements of the array, in radians from -pi to pi.
+    Uses polynomial_atan2f() from basicmaths.h, accurate to within 2e-6 radians.
+    @param[out] destination The array where the phase values will be stored.
+  */
+  void getPhaseValues(FloatArray destination);
   
    /**
     The complex conjugate values of the element of the array.
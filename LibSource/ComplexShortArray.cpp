@@ -1,6 +1,7 @@
 #include "ComplexShortArray.h"
 #include "basicmaths.h"
 #include "message.h"
+#include <limits.h>
 
 int16_t ComplexShortArray::mag(const int i){
   int16_t result;
@@ -8,8 +9,7 @@ int16_t ComplexShortArray::mag(const int i){
 #ifdef ARM_CORTEX
   arm_cmplx_mag_q15((int16_t*)&(data[i]), &result,1);
 #else
-  #error TODO
-  result=sqrtf(mag2(i));
+  result=data[i].getMagnitude();
 #endif
   return result;
 }
@@ -36,10 +36,9 @@ int16_t ComplexShortArray::mag2(const int i){
   // this is saturating
   arm_shift_q15((int16_t*)&result, 2, (int16_t*)&result, 1);
 #else
-  #error TODO
-  int16_t re=data[i].re;
-  int16_t im=data[i].im;
-  result=re*re+im*im;
+  int32_t re=data[i].re;
+  int32_t im=data[i].im;
+  result=min((re*re+im*im)>>15, SHRT_MAX);
 #endif  
   return result;
 }
@@ -85,14 +84,13 @@ void ComplexShortArray::complexByComplexMultiplication(ComplexShortArray operand
 #ifdef ARM_CORTEX
   arm_cmplx_mult_cmplx_q15((int16_t*)getData(), (int16_t*)operand2.getData(), (int16_t*)result.getData(), size );  
 #else
-  assert(false, "TODO");
-  float *pSrcA=(float*)data;
-  float *pSrcB=(float*)operand2;
-  float *pDst=(float*)result;
-  for(int n=0; n<size; n++) {        
-    pDst[(2*n)+0] = pSrcA[(2*n)+0] * pSrcB[(2*n)+0] - pSrcA[(2*n)+1] * pSrcB[(2*n)+1];        
-    pDst[(2*n)+1] = pSrcA[(2*n)+0] * pSrcB[(2*n)+1] + pSrcA[(2*n)+1] * pSrcB[(2*n)+0];        
-  }        
+  // 3.13 output format, as arm_cmplx_mult_cmplx_q15
+  for(unsigned int n=0; n<size; n++) {
+    int32_t re = ((int32_t)data[n].re*operand2[n].re >> 17) - ((int32_t)data[n].im*operand2[n].im >> 17);
+    int32_t im = ((int32_t)data[n].re*operand2[n].im >> 17) + ((int32_t)data[n].im*operand2[n].re >> 17);
+    result[n].re = re;
+    result[n].im = im;
+  }
 #endif  
 }
 
@@ -109,13 +107,54 @@ void ComplexShortArray::setAll(int16_t value){
 #ifdef ARM_CORTEX
   arm_fill_q15(value, (int16_t*)data, size*2 ); //note the *2 multiplier which accounts for real and imaginary parts
 #else
-  ComplexFloat val;
-  val.re=value;
-  val.im=value;
-  setAll(val);
+  for(unsigned int n=0; n<size; n++){
+    data[n].re=value;
+    data[n].im=value;
+  }
 #endif /* ARM_CORTEX */
 }
 
+ComplexShortArray ComplexShortArray::subArray(unsigned int offset, unsigned int length){
+  ASSERT(size >= offset+length, "Array too small");
+  return ComplexShortArray(data+offset, length);
+}
+
+int ComplexShortArray::getHeadroom(){
+  // or together the magnitude bits of all values
+  uint32_t bits = 0;
+  int16_t* values = (int16_t*)data;
+  for(unsigned int n=0; n<size*2; n++)
+    bits |= (uint16_t)(values[n] ^ (values[n] >> 15));
+  return bits == 0 ? 15 : 14 - log2i(bits);
+}
+
+int ComplexShortArray::normalise(){
+  int headroom = getHeadroom();
+  if(headroom > 0)
+    ShortArray((int16_t*)data, size*2).shift(headroom);
+  return headroom;
+}
+
+void ComplexShortArray::toFloat(ComplexFloatArray destination, int exponent){
+  ASSERT(destination.getSize() >= (int)size, "Array too small");
+  FloatArray values((float*)destination.getData(), size*2);
+  ShortArray((int16_t*)data, size*2).copyTo(values);
+  values.multiply(ldexpf(1.0f, exponent));
+}
+
+int ComplexShortArray::fromFloat(ComplexFloatArray source){
+  ASSERT(source.getSize() >= (int)size, "Array too small");
+  FloatArray values((float*)source.getData(), size*2);
+  float peak = max(values.getMaxValue(), -values.getMinValue());
+  int exponent = 0;
+  frexpf(peak, &exponent);
+  float scale = ldexpf(32768.0f, -exponent);
+  int16_t* destination = (int16_t*)data;
+  for(unsigned int n=0; n<size*2; n++)
+    destination[n] = (int16_t)max(min(roundf(values[n]*scale), (float)SHRT_MAX), (float)SHRT_MIN);
+  return exponent;
+}
+
 #if 0
 void ComplexShortArray::add(ComplexShortArray operand2, ComplexShortArray destination){
   ASSERT(operand2.size == size && destination.size >= size, "Arrays size mismatch");
@@ -193,11 +232,6 @@ int ComplexShortArray::getMaxMagnitudeIndex(){ //this is probably slower than ge
   return maxInd;
 }
 
-ComplexShortArray ComplexShortArray::subArray(int offset, int length){
-  ASSERT(size >= offset+length, "Array too small");
-  return ComplexShortArray(data+offset, length);
-}
-
 float ComplexShortArray::getMaxMagnitudeValue(){ //this is probably slower than getMagnitudeSquaredValues() and getMaxValue() on it
   float maxMag=-1;
   for(int n=0; n<size; n++){
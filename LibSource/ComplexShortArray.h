@@ -1,7 +1,9 @@
 #ifndef __ComplexShortArray_h__
 #define __ComplexShortArray_h__
 
+#include <limits.h>
 #include "ShortArray.h"
+#include "ComplexFloatArray.h"
 #include "basicmaths.h"
 class ComplexIntArray;
 
@@ -35,8 +37,7 @@ struct ComplexShort {
     out = out >> 1;
     return out;
   #else
-    #error TODO
-    return int16_t(sqrtf(re*re+im*im) + 0.5);
+    return int16_t(min(sqrtf((int32_t)re*re+(int32_t)im*im) + 0.5f, (float)SHRT_MAX));
   #endif
   }
   
@@ -250,6 +251,38 @@ public:
    * @param factor The value by which all the elements of the array are multiplied.
    */
   void scale(int16_t factor);
+
+  /**
+   * Get the headroom of the array: the number of bits by which all the values
+   * can be shifted left without overflow.
+   * @return the headroom in bits, 15 if all values are zero
+   */
+  int getHeadroom();
+
+  /**
+   * Normalise the array for block floating point.
+   * Shifts all the values left by the headroom of the array, so that the largest value
+   * uses the full 16 bit range. The block exponent of the array must be decreased by
+   * the returned amount.
+   * @return the number of bits the values have been shifted by
+   */
+  int normalise();
+
+  /**
+   * Convert a block floating point array to float.
+   * Each element is set to its Q15 value times 2^exponent.
+   * @param[out] destination The destination array
+   * @param[in] exponent The block exponent of the array
+   */
+  void toFloat(ComplexFloatArray destination, int exponent);
+
+  /**
+   * Convert a float array to block floating point.
+   * The exponent is chosen so that the largest value uses the full 16 bit range.
+   * @param[in] source The source array
+   * @return the block exponent of the array
+   */
+  int fromFloat(ComplexFloatArray source);
   
   /**
    * Allows to index the array using array-style brackets.
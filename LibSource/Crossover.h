@@ -0,0 +1,225 @@
+#ifndef __Crossover_h__
+#define __Crossover_h__
+
+#include "FloatArray.h"
+#include "Patch.h"
+#include "message.h"
+
+/**
+ * Linkwitz-Riley 4th order crossover point.
+ * Built from trapezoidal state variable filters with Butterworth damping:
+ * the first filter provides both the lowpass and the highpass output from
+ * one set of state variables, a second lowpass and a second highpass filter
+ * complete the two LR4 responses. The same coefficients give the 2nd order
+ * allpass with the phase response of the LR4 sum, used to align other bands.
+ */
+class LinkwitzRileySection {
+private:
+  static constexpr float DAMPING = M_SQRT2; // 1/Q, sqrt(2) for Butterworth
+  float a1, a2, a3;
+  float state[6]; // split, lowpass and highpass filter states
+public:
+  LinkwitzRileySection(){
+    setFrequency(0.25f);
+    reset();
+  }
+
+  /**
+   * Set the crossover frequency.
+   * @param fc frequency normalised to the sampling rate, below 0.5
+   */
+  void setFrequency(float fc){
+    float g = tanf(M_PI*fc);
+    a1 = 1.0f/(1.0f + g*(g + DAMPING));
+    a2 = g*a1;
+    a3 = g*a2;
+  }
+
+  void reset(){
+    for(int i=0; i<6; ++i)
+      state[i] = 0.0f;
+  }
+
+  /**
+   * Split @param input into @param low and @param high bands.
+   * Either output may point to the same memory as the input.
+   */
+  void process(const float* input, float* low, float* high, int size){
+    float ic1 = state[0], ic2 = state[1];
+    for(int n=0; n<size; ++n){
+      float v0 = input[n];
+      float v3 = v0 - ic2;
+      float v1 = a1*ic1 + a2*v3;
+      float v2 = ic2 + a2*ic1 + a3*v3;
+      ic1 = 2*v1 - ic1;
+      ic2 = 2*v2 - ic2;
+      high[n] = v0 - DAMPING*v1 - v2;
+      low[n] = v2;
+    }
+    state[0] = ic1;
+    state[1] = ic2;
+    // second lowpass
+    ic1 = state[2];
+    ic2 = state[3];
+    for(int n=0; n<size; ++n){
+      float v3 = low[n] - ic2;
+      float v1 = a1*ic1 + a2*v3;
+      float v2 = ic2 + a2*ic1 + a3*v3;
+      ic1 = 2*v1 - ic1;
+      ic2 = 2*v2 - ic2;
+      low[n] = v2;
+    }
+    state[2] = ic1;
+    state[3] = ic2;
+    // second highpass
+    ic1 = state[4];
+    ic2 = state[5];
+    for(int n=0; n<size; ++n){
+      float v0 = high[n];
+      float v3 = v0 - ic2;
+      float v1 = a1*ic1 + a2*v3;
+      float v2 = ic2 + a2*ic1 + a3*v3;
+      ic1 = 2*v1 - ic1;
+      ic2 = 2*v2 - ic2;
+      high[n] = v0 - DAMPING*v1 - v2;
+    }
+    state[4] = ic1;
+    state[5] = ic2;
+  }
+
+  /**
+   * Apply the allpass response of this crossover point in place.
+   * @param st two state variables, separate for each signal that is filtered
+   */
+  void allpass(float* buf, float* st, int size){
+    float ic1 = st[0], ic2 = st[1];
+    for(int n=0; n<size; ++n){
+      float v0 = buf[n];
+      float v3 = v0 - ic2;
+      float v1 = a1*ic1 + a2*v3;
+      float v2 = ic2 + a2*ic1 + a3*v3;
+      ic1 = 2*v1 - ic1;
+      ic2 = 2*v2 - ic2;
+      buf[n] = v0 - 2*DAMPING*v1;
+    }
+    st[0] = ic1;
+    st[1] = ic2;
+  }
+};
+
+/**
+ * Multiband crossover with Linkwitz-Riley 4th order slopes.
+ * Splits one input into N bands, written directly into the channels of an output buffer.
+ * Each band is filtered in place, and lower bands are passed through the allpass
+ * response of the higher crossover points, so that all bands are phase aligned:
+ * the sum of the bands has a flat magnitude response.
+ */
+class Crossover {
+private:
+  LinkwitzRileySection* sections; // bands-1
+  float* apstate; // 2 state variables for each compensating allpass
+  float* frequencies;
+  int bands;
+  float sampleRate;
+public:
+  /**
+   * @param numBands number of output bands, at least 2
+   * @param sr sampling rate
+   * @param secs array of numBands-1 crossover sections
+   * @param freqs array of numBands-1 crossover frequencies
+   * @param aps array of (numBands-1)*(numBands-2) allpass state variables
+   */
+  Crossover(int numBands, float sr, LinkwitzRileySection* secs, float* freqs, float* aps)
+    : sections(secs), apstate(aps), frequencies(freqs), bands(numBands), sampleRate(sr) {
+    ASSERT(bands >= 2, "Crossover needs at least 2 bands");
+    // spread default crossover points logarithmically between 100Hz and 10kHz
+    for(int i=0; i<bands-1; ++i){
+      float fc = bands == 2 ? 1000.0f : 100.0f*powf(100.0f, (float)i/(bands-2));
+      setFrequency(i, fc);
+    }
+    reset();
+  }
+
+  int getBands(){
+    return bands;
+  }
+
+  /**
+   * Set the frequency of a crossover point.
+   * Filters can be modulated without glitches.
+   * @param index crossover point, from 0 (between the two lowest bands) to bands-2
+   * @param freq frequency in Hz
+   */
+  void setFrequency(int index, float freq){
+    ASSERT(index < bands-1, "Invalid crossover index");
+    freq = min(freq, sampleRate*0.49f);
+    frequencies[index] = freq;
+    sections[index].setFrequency(freq/sampleRate);
+  }
+
+  float getFrequency(int index){
+    return frequencies[index];
+  }
+
+  void setSampleRate(float sr){
+    sampleRate = sr;
+    for(int i=0; i<bands-1; ++i)
+      setFrequency(i, frequencies[i]);
+  }
+
+  void reset(){
+    for(int i=0; i<bands-1; ++i)
+      sections[i].reset();
+    for(int i=0; i<(bands-1)*(bands-2); ++i)
+      apstate[i] = 0.0f;
+  }
+
+  /**
+   * Split a block of samples into frequency bands.
+   * @param input samples, left intact unless the first output channel shares its memory
+   * @param output buffer with at least as many channels as bands, lowest band first
+   */
+  void process(FloatArray input, AudioBuffer& output){
+    ASSERT(output.getChannels() >= bands, "Not enough output channels");
+    ASSERT(output.getSize() >= input.getSize(), "Output buffer too small");
+    int size = input.getSize();
+    float* src = input;
+    float* aps = apstate;
+    for(int k=0; k<bands-1; ++k){
+      // split the remaining highest band into band k and k+1
+      float* low = output.getSamples(k);
+      float* high = output.getSamples(k+1);
+      sections[k].process(src, low, high, size);
+      // align the phase of the lower bands with the new split
+      for(int j=0; j<k; ++j){
+	sections[k].allpass(output.getSamples(j), aps, size);
+	aps += 2;
+      }
+      src = high;
+    }
+  }
+
+  /**
+   * Sum the bands back into one signal.
+   */
+  void combine(AudioBuffer& input, FloatArray output){
+    ASSERT(input.getChannels() >= bands, "Not enough input channels");
+    input.getSamples(0).copyTo(output);
+    for(int i=1; i<bands; ++i)
+      output.add(input.getSamples(i).subArray(0, output.getSize()));
+  }
+
+  static Crossover* create(int bands, float sr){
+    return new Crossover(bands, sr, new LinkwitzRileySection[bands-1], new float[bands-1],
+			 new float[max(1, (bands-1)*(bands-2))]);
+  }
+
+  static void destroy(Crossover* obj){
+    delete[] obj->sections;
+    delete[] obj->frequencies;
+    delete[] obj->apstate;
+    delete obj;
+  }
+};
+
+#endif /* __Crossover_h__ */
@@ -0,0 +1,174 @@
+#ifndef __DelayLine_h__
+#define __DelayLine_h__
+
+#include "CircularBuffer.h"
+#include "Interpolator.h"
+
+/**
+ * Delay line with fractional read taps.
+ * Delays are given in samples, counting back from the most recently written sample.
+ * Block reads take one delay value per output sample, and are aligned with the last block
+ * written: output[i] is delayed relative to the i'th sample of that block.
+ * A typical modulated delay effect writes the input block first, then reads the output block.
+ *
+ * Three interpolation methods are provided:
+ * - linear: cheapest, low pass filters the output for fractional delays
+ * - Hermite: 4-point, 3rd order, flat response up to higher frequencies
+ * - allpass: first order, flat magnitude response, suitable for feedback loops and
+ * slowly modulated delays. The filter state is shared, so use one allpass tap per delay line.
+ * Any other kernel from Interpolator.h, such as a SincKernel, can be used with readInterpolated().
+ */
+template<typename T>
+class DelayLine : public CircularBuffer<T> {
+protected:
+  float apstate;
+
+  float get(int index){
+    return this->toFloat(this->data[(this->writepos - 1 - index) & this->mask]);
+  }
+
+  /* the kernels are symmetric, so they interpolate the samples in reverse order of time */
+  template<class Kernel>
+  float interpolate(const Kernel& kernel, float delay){
+    int n = (int)delay;
+    float frac = delay - n;
+    float x[Kernel::TAPS];
+    for(int j=0; j<Kernel::TAPS; ++j)
+      x[j] = get(n - Kernel::BEFORE + j);
+    return kernel.interpolate(x + Kernel::BEFORE, frac);
+  }
+
+  float linear(float delay){
+    return interpolate(LinearKernel(), delay);
+  }
+
+  float hermite(float delay){
+    return interpolate(HermiteKernel(), delay);
+  }
+
+  float allpass(float delay){
+    // integer part chosen so that the allpass delay is between 0.5 and 1.5 samples
+    int n = (int)(delay - 0.5f);
+    float frac = delay - n;
+    float eta = (1 - frac)/(1 + frac);
+    apstate = eta*(get(n) - apstate) + get(n+1);
+    return apstate;
+  }
+
+public:
+  DelayLine() : apstate(0.0f) {}
+
+  /**
+   * @param buf storage for the samples, for example a static EXTERNAL_RAM array
+   * @param len number of samples, must be a power of two
+   */
+  DelayLine(T* buf, uint32_t len) : CircularBuffer<T>(buf, len), apstate(0.0f) {}
+
+  /**
+   * Get the largest delay, in samples, that can be read with any of the interpolating taps
+   */
+  float getMaxDelay(){
+    return this->size - 3;
+  }
+
+  void reset(){
+    CircularBuffer<T>::reset();
+    apstate = 0.0f;
+  }
+
+  /**
+   * Linear interpolating read tap.
+   * @param delay from 0 to getMaxDelay()
+   */
+  float readLinear(float delay){
+    return linear(delay);
+  }
+
+  /**
+   * Hermite interpolating read tap.
+   * @param delay from 1 to getMaxDelay(), the interpolator needs one sample on either side
+   */
+  float readHermite(float delay){
+    return hermite(max(delay, 1.0f));
+  }
+
+  /**
+   * Read tap with an interpolation kernel from Interpolator.h.
+   * @param delay from Kernel::BEFORE to getSize() - Kernel::TAPS + Kernel::BEFORE:
+   * the kernel needs that many samples on either side
+   */
+  template<class Kernel>
+  float readInterpolated(const Kernel& kernel, float delay){
+    return interpolate(kernel, max(delay, (float)Kernel::BEFORE));
+  }
+
+  /**
+   * Allpass interpolating read tap.
+   * Must be called once per sample written, since the output depends on the previous one.
+   * @param delay from 0.5 to getMaxDelay()
+   */
+  float readAllpass(float delay){
+    return allpass(max(delay, 0.5f));
+  }
+
+  /**
+   * Read a block of linearly interpolated samples, with one delay value per output sample.
+   */
+  void readLinear(FloatArray output, FloatArray delays){
+    ASSERT(delays.getSize() >= output.getSize(), "Not enough delay values");
+    int size = output.getSize();
+    for(int i=0; i<size; ++i)
+      output[i] = linear(size - 1 - i + delays[i]);
+  }
+
+  /**
+   * Read a block of Hermite interpolated samples, with one delay value per output sample.
+   */
+  void readHermite(FloatArray output, FloatArray delays){
+    ASSERT(delays.getSize() >= output.getSize(), "Not enough delay values");
+    int size = output.getSize();
+    for(int i=0; i<size; ++i)
+      output[i] = hermite(size - 1 - i + max(delays[i], 1.0f));
+  }
+
+  /**
+   * Read a block of samples with an interpolation kernel, with one delay value per output sample.
+   */
+  template<class Kernel>
+  void readInterpolated(const Kernel& kernel, FloatArray output, FloatArray delays){
+    ASSERT(delays.getSize() >= output.getSize(), "Not enough delay values");
+    int size = output.getSize();
+    for(int i=0; i<size; ++i)
+      output[i] = interpolate(kernel, size - 1 - i + max(delays[i], (float)Kernel::BEFORE));
+  }
+
+  /**
+   * Read a block of allpass interpolated samples, with one delay value per output sample.
+   */
+  void readAllpass(FloatArray output, FloatArray delays){
+    ASSERT(delays.getSize() >= output.getSize(), "Not enough delay values");
+    int size = output.getSize();
+    for(int i=0; i<size; ++i)
+      output[i] = allpass(size - 1 - i + max(delays[i], 0.5f));
+  }
+
+  /**
+   * Create a delay line that holds at least @param len samples, rounded up to a power of two.
+   */
+  static DelayLine<T>* create(uint32_t len){
+    len = CircularBuffer<T>::getPowerOfTwo(len);
+    DelayLine<T>* obj = new DelayLine<T>(new T[len], len);
+    obj->clear();
+    return obj;
+  }
+
+  static void destroy(DelayLine<T>* obj){
+    delete[] obj->data;
+    delete obj;
+  }
+};
+
+typedef DelayLine<float> FloatDelayLine;
+typedef DelayLine<int16_t> ShortDelayLine;
+
+#endif /* __DelayLine_h__ */
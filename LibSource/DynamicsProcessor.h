@@ -0,0 +1,389 @@
+#ifndef __DynamicsProcessor_h__
+#define __DynamicsProcessor_h__
+
+#include <stdint.h>
+#include "FloatArray.h"
+#include "CircularBuffer.h"
+#include "Patch.h"
+
+/**
+ * Maximum of the last N values of a signal, in O(1) amortised time per sample.
+ * Keeps a monotonic deque: a queue of values that decrease from front to back.
+ * A new value removes all smaller values from the back, since they can no longer be
+ * the maximum, and the front is removed when it falls out of the window.
+ */
+class SlidingMaximum {
+private:
+  float* values;
+  uint32_t* times;
+  uint32_t mask;
+  uint32_t head; // index of the front, the maximum
+  uint32_t tail; // index after the back
+  uint32_t now;
+  uint32_t window;
+public:
+  /**
+   * @param v, t storage for @param capacity values and times, a power of two
+   * larger than the longest window
+   */
+  SlidingMaximum(float* v, uint32_t* t, int capacity)
+    : values(v), times(t), mask(capacity-1), head(0), tail(0), now(0), window(1) {
+    ASSERT((capacity & (capacity-1)) == 0, "Capacity must be a power of two");
+  }
+
+  /** set the number of values that the maximum is taken over */
+  void setWindow(int length){
+    ASSERT((uint32_t)length <= mask, "Window too long");
+    window = max(1, length);
+  }
+
+  int getWindow(){
+    return window;
+  }
+
+  void reset(){
+    head = tail = 0;
+  }
+
+  /** add a value and get the maximum of the window that ends with it */
+  float process(float x){
+    while(tail != head && values[(tail-1) & mask] <= x)
+      tail--;
+    values[tail & mask] = x;
+    times[tail & mask] = now;
+    tail++;
+    if(now - times[head & mask] >= window)
+      head++;
+    now++;
+    return values[head & mask];
+  }
+
+  /** process a block of values, which may be in place */
+  void process(FloatArray input, FloatArray output){
+    for(int n=0; n<input.getSize(); ++n)
+      output[n] = process(input[n]);
+  }
+
+  static SlidingMaximum* create(int maxWindow){
+    int capacity = CircularBuffer<float>::getPowerOfTwo(maxWindow+1);
+    return new SlidingMaximum(new float[capacity], new uint32_t[capacity], capacity);
+  }
+
+  static void destroy(SlidingMaximum* obj){
+    delete[] obj->values;
+    delete[] obj->times;
+    delete obj;
+  }
+};
+
+/**
+ * Compressor, limiter, expander and gate, with optional lookahead.
+ * Each block goes through a chain of passes over arrays of samples: level detection
+ * (peak or RMS), conversion to dB, the static gain curve with a soft knee, attack and
+ * release ballistics, and conversion back to a gain that multiplies the signal.
+ *
+ * Without lookahead, attack and release are one pole filters on the gain reduction.
+ * With lookahead, the signal is delayed, and the gain reduction is held at its maximum
+ * over the lookahead time, then smoothed with a moving average of the same length.
+ * This ramps the gain down over the lookahead time, and guarantees that the reduction
+ * is fully applied when a peak comes out of the delay: with an infinite ratio and
+ * peak detection, it is a brickwall limiter.
+ *
+ * The level can be detected from a sidechain instead of the signal itself. Channels can
+ * be linked, so that they all get the gain reduction of the loudest one.
+ * The gain reduction can be shown on a patch parameter:
+ * @code
+ * setParameterValue(PARAMETER_F, dynamics->getGainReduction()/24);
+ * @endcode
+ */
+class DynamicsProcessor {
+public:
+  enum DynamicsMode {
+    CompressorMode, // reduce levels above the threshold
+    ExpanderMode // reduce levels below the threshold, a gate with a high ratio
+  };
+  enum DetectorMode {
+    PeakDetector,
+    RmsDetector
+  };
+private:
+  int channels;
+  float sampleRate;
+  int maxLookahead;
+  DynamicsMode mode;
+  DetectorMode detector;
+  bool linked;
+  float threshold, ratio, knee, range, makeup;
+  float attack, release, rmsCoefficient;
+  int lookahead;
+  CircularFloatBuffer* delays;
+  SlidingMaximum** holds;
+  float* averages; // moving average windows, maxLookahead+1 per detector
+  float* sums;
+  float* envelopes;
+  float* squares; // mean square levels
+  int position;
+  FloatArray level;
+  FloatArray gain;
+
+  static float getCoefficient(float seconds, float sr){
+    return seconds > 0 ? expf(-1/(seconds*sr)) : 0;
+  }
+
+  /* static curve: from input level in dB, to gain reduction in dB */
+  void computeReduction(FloatArray x){
+    float slope = mode == CompressorMode ? 1 - 1/ratio : ratio - 1;
+    float halfknee = knee*0.5f;
+    for(int n=0; n<x.getSize(); ++n){
+      float over = mode == CompressorMode ? x[n] - threshold : threshold - x[n];
+      float r;
+      if(over <= -halfknee)
+	r = 0;
+      else if(over < halfknee)
+	r = slope*(over + halfknee)*(over + halfknee)/(2*knee);
+      else
+	r = slope*over;
+      x[n] = min(r, range);
+    }
+  }
+
+  /* from a block of input levels to a block of gains, for detector d */
+  void detect(int d, FloatArray x){
+    int size = x.getSize();
+    if(detector == RmsDetector){
+      float ms = squares[d];
+      for(int n=0; n<size; ++n){
+	ms = x[n]*x[n] + rmsCoefficient*(ms - x[n]*x[n]);
+	x[n] = sqrtf(ms);
+      }
+      squares[d] = ms;
+    }
+    x.gainToDb();
+    computeReduction(x);
+    float env = envelopes[d];
+    if(lookahead > 0){
+      holds[d]->process(x, x);
+      // moving average over lookahead+1 samples
+      float* window = averages + d*(maxLookahead+1);
+      float sum = sums[d];
+      float scale = 1.0f/(lookahead+1);
+      int pos = position;
+      for(int n=0; n<size; ++n){
+	sum += x[n] - window[pos];
+	window[pos] = x[n];
+	if(++pos > lookahead){
+	  pos = 0;
+	  // start again from the exact sum, so that rounding errors don't accumulate
+	  sum = 0;
+	  for(int i=0; i<=lookahead; ++i)
+	    sum += window[i];
+	}
+	float avg = max(0.0f, sum*scale);
+	env = avg > env ? avg : avg + release*(env - avg);
+	x[n] = makeup - env;
+      }
+      sums[d] = sum;
+    }else{
+      for(int n=0; n<size; ++n){
+	float r = x[n];
+	env = r + (r > env ? attack : release)*(env - r);
+	x[n] = makeup - env;
+      }
+    }
+    envelopes[d] = env;
+    x.dbToGain();
+  }
+
+  void process(AudioBuffer& buffer, AudioBuffer* sidechain){
+    int size = buffer.getSize();
+    ASSERT(size <= level.getSize(), "Block too large");
+    ASSERT(buffer.getChannels() >= channels, "Not enough channels");
+    FloatArray x = level.subArray(0, size);
+    FloatArray g = gain.subArray(0, size);
+    int newposition = (position + size) % (lookahead+1);
+    for(int ch=0; ch<channels; ++ch){
+      FloatArray samples = buffer.getSamples(ch);
+      FloatArray source = samples;
+      if(sidechain)
+	source = sidechain->getSamples(ch % sidechain->getChannels());
+      if(!linked || ch == 0){
+	source.rectify(x);
+	if(linked){
+	  for(int c=1; c<channels; ++c){
+	    FloatArray other = sidechain ? sidechain->getSamples(c % sidechain->getChannels()) : buffer.getSamples(c);
+	    for(int n=0; n<size; ++n)
+	      x[n] = max(x[n], fabsf(other[n]));
+	  }
+	}
+	detect(linked ? 0 : ch, x);
+	x.copyTo(g);
+      }
+      if(lookahead > 0){
+	delays[ch].write(samples);
+	delays[ch].read(samples, lookahead);
+      }
+      samples.multiply(g);
+    }
+    position = newposition;
+  }
+
+public:
+  /**
+   * @param maxDelay longest lookahead in samples
+   * @param delayBuffers one circular buffer per channel, holding at least maxDelay plus one block
+   * @param holdBuffers one sliding maximum per channel, for windows of up to maxDelay+1
+   * @param averageBuffers channels*(maxDelay+1) values
+   * @param state 3*channels values
+   * @param buf 2*blocksize values
+   */
+  DynamicsProcessor(int numChannels, float sr, int blocksize, int maxDelay,
+		    CircularFloatBuffer* delayBuffers, SlidingMaximum** holdBuffers,
+		    float* averageBuffers, float* state, float* buf)
+    : channels(numChannels), sampleRate(sr), maxLookahead(maxDelay),
+      mode(CompressorMode), detector(PeakDetector), linked(true),
+      threshold(-20), ratio(4), knee(0), range(120), makeup(0),
+      lookahead(0), delays(delayBuffers), holds(holdBuffers), averages(averageBuffers),
+      sums(state), envelopes(state+channels), squares(state+2*channels), position(0) {
+    level = FloatArray(buf, blocksize);
+    gain = FloatArray(buf+blocksize, blocksize);
+    setAttack(0.01);
+    setRelease(0.1);
+    setRmsTime(0.01);
+    reset();
+  }
+
+  int getChannels(){
+    return channels;
+  }
+
+  void setMode(DynamicsMode value){
+    mode = value;
+  }
+
+  void setDetector(DetectorMode value){
+    detector = value;
+  }
+
+  /** set the time constant of the RMS detector */
+  void setRmsTime(float seconds){
+    rmsCoefficient = getCoefficient(seconds, sampleRate);
+  }
+
+  /** link the detection of all channels, so that they get the same gain */
+  void setStereoLink(bool value){
+    linked = value;
+  }
+
+  void setThreshold(float dB){
+    threshold = dB;
+  }
+
+  /** ratio of level change above (compressor) or below (expander) the threshold, at least 1 */
+  void setRatio(float value){
+    ratio = max(1.0f, value);
+  }
+
+  /** set the width of the soft knee in dB, 0 for a hard knee */
+  void setKnee(float dB){
+    knee = max(0.0f, dB);
+  }
+
+  /** limit the gain reduction, for example to set the depth of a gate */
+  void setRange(float dB){
+    range = max(0.0f, dB);
+  }
+
+  /** set the gain added after compression */
+  void setMakeupGain(float dB){
+    makeup = dB;
+  }
+
+  /** set the attack time, used without lookahead */
+  void setAttack(float seconds){
+    attack = getCoefficient(seconds, sampleRate);
+  }
+
+  void setRelease(float seconds){
+    release = getCoefficient(seconds, sampleRate);
+  }
+
+  /**
+   * Set the lookahead, which delays the signal and replaces the attack time.
+   * Changing the lookahead while processing interrupts the signal.
+   */
+  void setLookahead(float seconds){
+    int samples = min((int)(seconds*sampleRate + 0.5f), maxLookahead);
+    if(samples != lookahead){
+      lookahead = max(0, samples);
+      reset();
+    }
+  }
+
+  /** get the delay of the signal in samples */
+  int getLatency(){
+    return lookahead;
+  }
+
+  /** get the current gain reduction in dB, the largest of all channels */
+  float getGainReduction(){
+    float r = envelopes[0];
+    for(int i=1; i<channels; ++i)
+      r = max(r, envelopes[i]);
+    return r;
+  }
+
+  void reset(){
+    position = 0;
+    for(int i=0; i<channels; ++i){
+      delays[i].clear();
+      holds[i]->reset();
+      holds[i]->setWindow(lookahead+1);
+      sums[i] = 0;
+      envelopes[i] = 0;
+      squares[i] = 0;
+    }
+    FloatArray(averages, channels*(maxLookahead+1)).clear();
+  }
+
+  /** process a buffer in place */
+  void process(AudioBuffer& buffer){
+    process(buffer, NULL);
+  }
+
+  /** process a buffer in place, with levels detected from the sidechain */
+  void process(AudioBuffer& buffer, AudioBuffer& sidechain){
+    process(buffer, &sidechain);
+  }
+
+  /**
+   * @param maxLookahead longest lookahead in seconds
+   */
+  static DynamicsProcessor* create(int channels, float sr, int blocksize, float maxLookahead = 0.01){
+    int maxDelay = (int)(maxLookahead*sr + 0.5f);
+    uint32_t len = CircularFloatBuffer::getPowerOfTwo(maxDelay+blocksize);
+    CircularFloatBuffer* delays = new CircularFloatBuffer[channels];
+    SlidingMaximum** holds = new SlidingMaximum*[channels];
+    for(int i=0; i<channels; ++i){
+      delays[i] = CircularFloatBuffer(new float[len], len);
+      holds[i] = SlidingMaximum::create(maxDelay+1);
+    }
+    return new DynamicsProcessor(channels, sr, blocksize, maxDelay, delays, holds,
+				 new float[channels*(maxDelay+1)], new float[3*channels],
+				 new float[2*blocksize]);
+  }
+
+  static void destroy(DynamicsProcessor* obj){
+    for(int i=0; i<obj->channels; ++i){
+      delete[] obj->delays[i].getData();
+      SlidingMaximum::destroy(obj->holds[i]);
+    }
+    delete[] obj->delays;
+    delete[] obj->holds;
+    delete[] obj->averages;
+    delete[] obj->sums;
+    delete[] (float*)obj->level;
+    delete obj;
+  }
+};
+
+#endif /* __DynamicsProcessor_h__ */
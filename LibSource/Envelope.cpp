@@ -1,5 +1,6 @@
 #include "Envelope.h"
 #include "message.h"
+#include "basicmaths.h"
 
 /*
 void EnvelopeGenerator::calculateMultiplier(double startLevel,
@@ -10,14 +11,18 @@ void EnvelopeGenerator::calculateMultiplier(double startLevel,
 */
 
 const float AdsrEnvelope::minTime = 0.001;
+const float AdsrEnvelope::attackRatio = 0.3; // attack target overshoot, relative to full scale
+const float AdsrEnvelope::decayRatio = 0.001; // decay and release target undershoot
 
 AdsrEnvelope::AdsrEnvelope(float sampleRate) : 
   samplePeriod(1.0/sampleRate),
   stage(kIdle),
   trig(kGate),
+  curve(kLinear),
   level(0.0),
   gateState(false),
-  gateTime(-1) {
+  gateTime(-1),
+  remaining(-1) {
   setAttack(0.0);
   setDecay(0.0);
   setSustain(1.0);
@@ -27,26 +32,50 @@ AdsrEnvelope::AdsrEnvelope(float sampleRate) :
 
 AdsrEnvelope::~AdsrEnvelope(){}
 
+/* coefficient of a one pole curve that covers full scale, plus ratio, in time seconds */
+static float getCoefficient(float time, float samplePeriod, float ratio){
+  return expf(-logf((1.0f + ratio)/ratio)*samplePeriod/time);
+}
+
+void AdsrEnvelope::setSampleRate(float sampleRate){
+  samplePeriod = 1.0/sampleRate;
+  setAttack(attackTime);
+  setDecay(decayTime);
+  setRelease(releaseTime);
+}
+
 void AdsrEnvelope::setAttack(float newAttack){
-  newAttack = newAttack > minTime ? newAttack : minTime;
-  attackIncrement = samplePeriod / newAttack;
+  attackTime = newAttack > minTime ? newAttack : minTime;
+  attackIncrement = samplePeriod / attackTime;
+  attackCoefficient = getCoefficient(attackTime, samplePeriod, attackRatio);
+  remaining = -1;
 }
 
 void AdsrEnvelope::setDecay(float newDecay){
-  newDecay = newDecay > minTime ? newDecay : minTime;
-  decayIncrement = - samplePeriod / newDecay;
+  decayTime = newDecay > minTime ? newDecay : minTime;
+  decayIncrement = - samplePeriod / decayTime;
+  decayCoefficient = getCoefficient(decayTime, samplePeriod, decayRatio);
+  remaining = -1;
 }
 
 void AdsrEnvelope::setRelease(float newRelease){
-  newRelease = newRelease > minTime ? newRelease : minTime;
-  releaseIncrement = - samplePeriod / newRelease;
+  releaseTime = newRelease > minTime ? newRelease : minTime;
+  releaseIncrement = - samplePeriod / releaseTime;
+  releaseCoefficient = getCoefficient(releaseTime, samplePeriod, decayRatio);
+  remaining = -1;
 }
 
 void AdsrEnvelope::setSustain(float newSustain){
   sustain = newSustain;
+  remaining = -1;
  // TODO: in the real world, you would probably glide to the new sustain level at a rate determined by either decay or attack
 }
 
+void AdsrEnvelope::setCurve(EnvelopeCurve newCurve){
+  curve = newCurve;
+  remaining = -1;
+}
+
 void AdsrEnvelope::setRetrigger(bool state){
   retrigger = state;
 }
@@ -82,77 +111,135 @@ float AdsrEnvelope::getLevel(){
 
 void AdsrEnvelope::setLevel(float newLevel){
   level = newLevel;
+  remaining = -1;
 }
 
-void AdsrEnvelope::attenuate(FloatArray output){
-  for(int n = 0; n < output.getSize(); n++)
-    output[n] *= getNextSample();
+bool AdsrEnvelope::isIdle(){
+  return stage == kIdle && gateTime < 0;
 }
 
-void AdsrEnvelope::getEnvelope(FloatArray output){
-  for(int n = 0; n < output.getSize(); n++)
-    output[n] = getNextSample();
-}
-
-float AdsrEnvelope::getNextSample(){
-  if(gateTime == 0){
+/* apply a gate change, once its delay has passed */
+void AdsrEnvelope::updateGate(){
+  gateTime = -1;
+  remaining = -1;
+  if(gateState){
+    // start over from the current level
     stage = kAttack;
-    if(trig == kTrigger){
+    if(trig == kTrigger)
       gateState = false;
-    }
+  }else if(trig == kGate && stage != kIdle){
+    stage = kRelease;
   }
-  if(gateTime >= 0){
-    gateTime--; // this will stop at -1
+}
+
+/* number of steps from the current level to reach or pass the end level */
+int AdsrEnvelope::getSegmentLength(float end, float target, float coefficient, float increment){
+  float steps;
+  if(curve == kLinear){
+    steps = (end - level)/increment;
+  }else{
+    float ratio = (end - target)/(level - target);
+    steps = ratio > 0 && ratio < 1 ? logf(ratio)/logf(coefficient) : 0;
   }
-  switch (stage) {
+  return steps > 1 ? (int)ceilf(steps) : 1;
+}
+
+/* render up to size samples of the current stage, and return the number rendered */
+int AdsrEnvelope::render(float* output, int size){
+  float end, target, coefficient, increment;
+  switch(stage){
   case kAttack:
-    // attack ramp
-    level += attackIncrement;
-    if(level >= 1.0){
-      level = 1.0;
-      stage = kDecay;
-    }else if(gateState == false && trig == kGate){
-      stage = kRelease;
-    }
+    end = 1.0;
+    target = 1.0 + attackRatio;
+    coefficient = attackCoefficient;
+    increment = attackIncrement;
     break;
   case kDecay:
-    // decay ramp
-    level += decayIncrement;
-    if(level <= sustain){
-      level = sustain;
-      if(trig == kGate){
-        stage = kSustain;
-      } else { // (trig == kTrigger)
-        stage = kRelease;
-      }
-    } else if(gateState == false && trig == kGate){
-      stage = kRelease;
-    }
-    break;
-  case kSustain:
-    level = sustain;
-    if(gateState == false){
-      stage = kRelease;
-    }
+    end = sustain;
+    target = sustain - decayRatio;
+    coefficient = decayCoefficient;
+    increment = decayIncrement;
     break;
   case kRelease:
-    // release ramp
-    level += releaseIncrement;
-    if(level <= 0.0){
-      level = 0.0;
-      if (retrigger == true)
-        trigger();
-      else // (retrigger == false)
-        stage = kIdle;
-    }else if(gateState == true ){ // if during release the gate is on again, start over from the current level
-      stage = kAttack;
-    }
+    end = 0.0;
+    target = -decayRatio;
+    coefficient = releaseCoefficient;
+    increment = releaseIncrement;
     break;
+  case kSustain:
+    level = sustain;
+    for(int n = 0; n < size; n++)
+      output[n] = level;
+    return size;
   case kIdle:
+  default:
     level = 0.0;
-    if(gateState == true)
-      stage = kAttack;
-    break;
+    for(int n = 0; n < size; n++)
+      output[n] = 0.0f;
+    return size;
   }
-  return level;
+  if(remaining < 0)
+    remaining = getSegmentLength(end, target, coefficient, increment);
+  int len = min(size, remaining);
+  if(curve == kLinear){
+    float start = level;
+    for(int n = 0; n < len; n++)
+      output[n] = start + (n+1)*increment;
+  }else{
+    float distance = level - target;
+    for(int n = 0; n < len; n++){
+      distance *= coefficient;
+      output[n] = target + distance;
+    }
+  }
+  level = output[len-1];
+  remaining -= len;
+  if(remaining == 0){
+    // end of segment: finish exactly on the end level, and move on to the next stage
+    output[len-1] = level = end;
+    remaining = -1;
+    if(stage == kAttack){
+      stage = kDecay;
+    }else if(stage == kDecay){
+      stage = trig == kGate ? kSustain : kRelease;
+    }else if(retrigger){
+      trigger();
+    }else{
+      stage = kIdle;
+    }
+  }
+  return len;
+}
+
+void AdsrEnvelope::attenuate(FloatArray output){
+  float buffer[32];
+  for(int pos = 0; pos < output.getSize(); pos += 32){
+    int len = min(32, output.getSize() - pos);
+    getEnvelope(FloatArray(buffer, len));
+    for(int n = 0; n < len; n++)
+      output[pos+n] *= buffer[n];
+  }
+}
+
+void AdsrEnvelope::getEnvelope(FloatArray output){
+  float* out = output.getData();
+  int size = output.getSize();
+  int pos = 0;
+  while(pos < size){
+    if(gateTime == 0)
+      updateGate();
+    int len = size - pos;
+    if(gateTime > 0)
+      len = min(len, gateTime);
+    len = render(out+pos, len);
+    if(gateTime > 0)
+      gateTime -= len;
+    pos += len;
+  }
+}
+
+float AdsrEnvelope::getNextSample(){
+  float sample;
+  getEnvelope(FloatArray(&sample, 1));
+  return sample;
 }
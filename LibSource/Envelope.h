@@ -19,7 +19,15 @@ public:
 };
 
 /**
- * Linear ADSR Envelope
+ * ADSR Envelope with linear or exponential segments.
+ * Exponential segments follow the charge and discharge curve of a capacitor, as in an
+ * analog envelope generator: each segment approaches a target level beyond its end
+ * level, so that it reaches the end level in the set time.
+ * Blocks are rendered one segment at a time: the number of samples remaining in the
+ * current segment is calculated from the level, and filled with a linear or exponential
+ * ramp, so the stage only changes at the end of a segment or on a gate change.
+ * A gate change with a delay is applied at that sample offset into the following
+ * samples; only one change can be pending at a time.
  */
 class AdsrEnvelope : public Envelope {
 private:
@@ -27,15 +35,15 @@ private:
   enum EnvelopeTrigger { kGate, kTrigger };
 
 public:
+  enum EnvelopeCurve { kLinear, kExponential };
   AdsrEnvelope(float newSampleRate);
   virtual ~AdsrEnvelope();
-  void setSampleRate(float sampleRate){
-    samplePeriod = 1.0/sampleRate;
-  }
+  void setSampleRate(float sampleRate);
   void setAttack(float newAttack);
   void setDecay(float newDecay);
   void setRelease(float newRelase);
   void setSustain(float newSustain);
+  void setCurve(EnvelopeCurve newCurve);
   void trigger();
   void trigger(bool state);
   void trigger(bool state, int triggerDelay);
@@ -44,6 +52,7 @@ public:
   void gate(bool state, int gateDelay);
   float getLevel();
   void setLevel(float newLevel);
+  bool isIdle();
   float getNextSample(); // increments envelope one step
   void getEnvelope(FloatArray output); // increments envelope by output buffer length
   void attenuate(FloatArray buf); // increments envelope by buffer length
@@ -55,17 +64,30 @@ public:
   }
 private:
   static const float minTime;
+  static const float attackRatio;
+  static const float decayRatio;
   float samplePeriod;
   EnvelopeStage stage;
   EnvelopeTrigger trig;
+  EnvelopeCurve curve;
   bool retrigger;
   float level;
+  float attackTime;
+  float decayTime;
+  float releaseTime;
   float attackIncrement;
   float decayIncrement;
   float releaseIncrement;
+  float attackCoefficient;
+  float decayCoefficient;
+  float releaseCoefficient;
   float sustain;
   bool gateState;
   int gateTime;
+  int remaining; // samples left in the current segment, or -1 if not calculated
+  void updateGate();
+  int getSegmentLength(float end, float target, float coefficient, float increment);
+  int render(float* output, int size);
 };
 
 #endif /* ENVELOPE_HPP */
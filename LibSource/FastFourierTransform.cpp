@@ -3,80 +3,218 @@
 #include "ProgramVector.h"
 #include "ServiceCall.h"
 
+/*
+ * Mixed radix sizes compute the real FFT of size N with a complex FFT of size N/2,
+ * taking the even samples as real part and the odd samples as imaginary part.
+ * The spectra of the even and odd samples are then separated, and recombined with the
+ * twiddle factors exp(-2*pi*i*k/N).
+ * Output is packed as in the CMSIS arm_rfft_fast_f32: the real valued DC and Nyquist
+ * bins are stored in the real and imaginary parts of the first element, followed by
+ * bins 1 to N/2-1.
+ */
+
+static kiss_fft_cfg kiss_fft_create(int nfft, int inverse){
+  size_t len = 0;
+  kiss_fft_alloc(nfft, inverse, NULL, &len);
+  return kiss_fft_alloc(nfft, inverse, new char[len], &len);
+}
+
+static void kiss_fft_destroy(kiss_fft_cfg cfg){
+  delete[] (char*)cfg;
+}
+
 #ifdef ARM_CORTEX
-FastFourierTransform::FastFourierTransform(){}
+static bool isCmsisSize(int len){
+  return len==32 || len ==64 || len==128 || len==256 || len==512 || len==1024 || len==2048 || len==4096;
+}
+#endif /* ARM_CORTEX */
 
-FastFourierTransform::FastFourierTransform(int len){
-  init(len);
+bool FastFourierTransform::isSupportedSize(int len){
+  if(len < 4 || (len & 1))
+    return false;
+  len /= 2;
+  while(len % 2 == 0)
+    len /= 2;
+  while(len % 3 == 0)
+    len /= 3;
+  while(len % 5 == 0)
+    len /= 5;
+  return len == 1;
 }
 
-FastFourierTransform::~FastFourierTransform(){}
+static FastFourierPlan* plans = NULL;
 
-void FastFourierTransform::init(int len){
-  ASSERT(len==32 || len ==64 || len==128 || len==256 || len==512 || len==1024 || len==2048 || len==4096, "Unsupported FFT size");
-  void* args[] = {(void*)&instance, (void*)&len};
-  getProgramVector()->serviceCall(OWL_SERVICE_ARM_RFFT_FAST_INIT_F32, args, 2);
-  // arm_rfft_fast_init_f32(&instance, len);
-  // Supported FFT Lengths are 32, 64, 128, 256, 512, 1024, 2048, 4096.
+FastFourierPlan::FastFourierPlan(int len)
+  : size(len), references(0), cfgfft(NULL), cfgifft(NULL), next(NULL) {
+#ifdef ARM_CORTEX
+  if(isCmsisSize(len)){
+    void* args[] = {(void*)&instance, (void*)&len};
+    getProgramVector()->serviceCall(OWL_SERVICE_ARM_RFFT_FAST_INIT_F32, args, 2);
+    // arm_rfft_fast_init_f32(&instance, len);
+    return;
+  }
+#endif /* ARM_CORTEX */
+  int half = len/2;
+  cfgfft = kiss_fft_create(half, 0);
+  cfgifft = kiss_fft_create(half, 1);
+  twiddles = ComplexFloatArray::create(half/2+1);
+  for(int k=0; k<twiddles.getSize(); k++){
+    float phase = -2*M_PI*k/len;
+    twiddles[k].re = cos(phase);
+    twiddles[k].im = sin(phase);
+  }
 }
 
-void FastFourierTransform::fft(FloatArray in, ComplexFloatArray out){
-  ASSERT(in.getSize() >= getSize(), "Input array too small");
-  ASSERT(out.getSize() >= getSize()/2, "Output array too small");
-  arm_rfft_fast_f32(&instance, (float*)in, (float*)out, 0);
+FastFourierPlan::~FastFourierPlan(){
+  if(cfgfft != NULL){
+    kiss_fft_destroy(cfgfft);
+    kiss_fft_destroy(cfgifft);
+    ComplexFloatArray::destroy(twiddles);
+  }
 }
 
-void FastFourierTransform::ifft(ComplexFloatArray in, FloatArray out){
-  ASSERT(in.getSize() >= getSize()/2, "Input array too small");
-  ASSERT(out.getSize() >= getSize(), "Output array too small");
-  arm_rfft_fast_f32(&instance, (float*)in, (float*)out, 1);
+FastFourierPlan* FastFourierPlan::acquire(int size){
+  FastFourierPlan* plan = plans;
+  while(plan != NULL && plan->size != size)
+    plan = plan->next;
+  if(plan == NULL){
+    plan = new FastFourierPlan(size);
+    plan->next = plans;
+    plans = plan;
+  }
+  plan->references++;
+  return plan;
 }
 
-int FastFourierTransform::getSize(){
-  return instance.fftLenRFFT;
+void FastFourierPlan::release(FastFourierPlan* plan){
+  if(--plan->references > 0)
+    return;
+  // the plan may already have been detached from the cache by clear()
+  FastFourierPlan** link = &plans;
+  while(*link != NULL && *link != plan)
+    link = &(*link)->next;
+  if(*link == plan)
+    *link = plan->next;
+  delete plan;
+}
+
+void FastFourierPlan::clear(){
+  while(plans != NULL){
+    FastFourierPlan* plan = plans;
+    plans = plan->next;
+    plan->next = NULL;
+    // plans that are still in use are freed by their last release()
+    if(plan->references == 0)
+      delete plan;
+  }
 }
 
-#else /* ARM_CORTEX */
+int FastFourierPlan::getCount(){
+  int count = 0;
+  for(FastFourierPlan* plan = plans; plan != NULL; plan = plan->next)
+    count++;
+  return count;
+}
 
-FastFourierTransform::FastFourierTransform(){}
+FastFourierTransform::FastFourierTransform() :
+  plan(NULL), ownsTemp(false) {}
 
-FastFourierTransform::FastFourierTransform(int aSize){
+FastFourierTransform::FastFourierTransform(int aSize) :
+  plan(NULL), ownsTemp(false) {
   init(aSize);
 }
 
 FastFourierTransform::~FastFourierTransform(){
-  ComplexFloatArray::destroy(temp);
+  deinit();
+}
+
+void FastFourierTransform::deinit(){
+  if(plan != NULL)
+    FastFourierPlan::release(plan);
+  plan = NULL;
+  if(ownsTemp)
+    ComplexFloatArray::destroy(temp);
+  ownsTemp = false;
 }
 
 void FastFourierTransform::init(int aSize){
-  ASSERT(aSize==32 || aSize ==64 || aSize==128 || aSize==256 || aSize==512 || aSize==1024 || aSize==2048 || aSize==4096, "Unsupported FFT size");
-  cfgfft = kiss_fft_alloc(aSize, 0 , 0, 0);
-  cfgifft = kiss_fft_alloc(aSize, 1,0, 0);
-  temp = ComplexFloatArray::create(getSize());
+  init(aSize, ComplexFloatArray());
+}
+
+void FastFourierTransform::init(int aSize, ComplexFloatArray scratch){
+  ASSERT(isSupportedSize(aSize), "Unsupported FFT size");
+  deinit();
+  plan = FastFourierPlan::acquire(aSize);
+  if(plan->cfgfft == NULL)
+    return;
+  if(scratch.getSize() == 0){
+    temp = ComplexFloatArray::create(aSize/2);
+    ownsTemp = true;
+  }else{
+    ASSERT(scratch.getSize() >= aSize/2, "Scratch array too small");
+    temp = scratch;
+  }
 }
 
 void FastFourierTransform::fft(FloatArray input, ComplexFloatArray output){
   ASSERT(input.getSize() >= getSize(), "Input array too small");
-  ASSERT(output.getSize() >= getSize(), "Output array too small");
-  for(int n=0; n<getSize(); n++){
-    temp[n].re=input[n];
-    temp[n].im=0;
+  ASSERT(output.getSize() >= getSize()/2, "Output array too small");
+#ifdef ARM_CORTEX
+  if(plan->cfgfft == NULL){
+    arm_rfft_fast_f32(&plan->instance, (float*)input, (float*)output, 0);
+    return;
+  }
+#endif /* ARM_CORTEX */
+  int half = plan->size/2;
+  ComplexFloatArray twiddles = plan->twiddles;
+  kiss_fft(plan->cfgfft, (kiss_fft_cpx*)(float*)input, (kiss_fft_cpx*)(float*)temp.getData());
+  output[0].re = temp[0].re + temp[0].im;
+  output[0].im = temp[0].re - temp[0].im;
+  for(int k=1; k<=half/2; k++){
+    // even and odd spectra, scaled by 2
+    float ere = temp[k].re + temp[half-k].re;
+    float eim = temp[k].im - temp[half-k].im;
+    float ore = temp[k].re - temp[half-k].re;
+    float oim = temp[k].im + temp[half-k].im;
+    float tre = ore*twiddles[k].re - oim*twiddles[k].im;
+    float tim = ore*twiddles[k].im + oim*twiddles[k].re;
+    output[k].re = 0.5f*(ere + tim);
+    output[k].im = 0.5f*(eim - tre);
+    output[half-k].re = 0.5f*(ere - tim);
+    output[half-k].im = -0.5f*(eim + tre);
   }
-  kiss_fft(cfgfft, (kiss_fft_cpx*)(float*)temp.getData(), (kiss_fft_cpx*)(float*)output);
 }
-  
+
 void FastFourierTransform::ifft(ComplexFloatArray input, FloatArray output){
-  ASSERT(input.getSize() >= getSize(), "Input array too small");
+  ASSERT(input.getSize() >= getSize()/2, "Input array too small");
   ASSERT(output.getSize() >= getSize(), "Output array too small");
-  kiss_fft(cfgifft, (kiss_fft_cpx*)(float*)input, (kiss_fft_cpx*)(float*)temp.getData());
-  float scale=1.0f/getSize();
-  for(int n=0; n<getSize(); n++){
-    output[n]=temp[n].re*scale;
+#ifdef ARM_CORTEX
+  if(plan->cfgfft == NULL){
+    arm_rfft_fast_f32(&plan->instance, (float*)input, (float*)output, 1);
+    return;
   }
+#endif /* ARM_CORTEX */
+  int half = plan->size/2;
+  ComplexFloatArray twiddles = plan->twiddles;
+  temp[0].re = input[0].re + input[0].im;
+  temp[0].im = input[0].re - input[0].im;
+  for(int k=1; k<=half/2; k++){
+    float ere = input[k].re + input[half-k].re;
+    float eim = input[k].im - input[half-k].im;
+    float dre = input[k].re - input[half-k].re;
+    float dim = input[k].im + input[half-k].im;
+    // multiply by the conjugate twiddle factor
+    float ore = dre*twiddles[k].re + dim*twiddles[k].im;
+    float oim = dim*twiddles[k].re - dre*twiddles[k].im;
+    temp[k].re = ere - oim;
+    temp[k].im = eim + ore;
+    temp[half-k].re = ere + oim;
+    temp[half-k].im = ore - eim;
+  }
+  kiss_fft(plan->cfgifft, (kiss_fft_cpx*)(float*)temp.getData(), (kiss_fft_cpx*)(float*)output);
+  output.subArray(0, plan->size).multiply(1.0f/plan->size);
 }
-    
+
 int FastFourierTransform::getSize(){
-  return temp.getSize();
+  return plan == NULL ? 0 : plan->size;
 }
-
-#endif /* ifndef ARM_CORTEX */
@@ -4,22 +4,67 @@
 #include "FloatArray.h"
 #include "ComplexFloatArray.h"
 
-#ifndef ARM_CORTEX
 #include "kiss_fft.h"
+
+/**
+ * Read-only tables for one FFT size, shared by all transforms of that size.
+ * Plans are cached and reference counted: acquire() returns the existing plan
+ * for a size if there is one, release() frees it when it is no longer used.
+ */
+class FastFourierPlan {
+public:
+  int size;
+  int references;
+#ifdef ARM_CORTEX
+  arm_rfft_fast_instance_f32 instance;
 #endif /* ARM_CORTEX */
+  kiss_fft_cfg cfgfft;
+  kiss_fft_cfg cfgifft;
+  ComplexFloatArray twiddles;
+  FastFourierPlan* next;
+
+  /**
+   * Get the plan for an FFT size, creating it if it is not already cached.
+   */
+  static FastFourierPlan* acquire(int size);
+
+  /**
+   * Release a plan, freeing it when no transform uses it anymore.
+   */
+  static void release(FastFourierPlan* plan);
+
+  /**
+   * Empty the cache of plans. Called when a patch is unloaded.
+   * Plans that are still used by a transform are not freed but detached from the cache,
+   * so that transforms which outlive the patch stay valid, and new transforms get
+   * new plans.
+   */
+  static void clear();
+
+  /**
+   * Get the number of cached plans.
+   */
+  static int getCount();
+
+private:
+  FastFourierPlan(int size);
+  ~FastFourierPlan();
+};
 
 /**
  * This class performs direct and inverse Fast Fourier Transform.
+ * Power of two sizes from 32 to 4096 use the CMSIS library on ARM Cortex-M.
+ * Other even sizes, and all sizes on other platforms, use a mixed radix real FFT
+ * built on a complex KissFFT of half the size. Sizes where half the FFT size only has
+ * factors of 2, 3 and 5 are supported, for example 480, 960 or 8192.
+ * Tables are shared between all instances of the same size, see FastFourierPlan.
  */ 
 class FastFourierTransform {
 private:
-#ifdef ARM_CORTEX
-  arm_rfft_fast_instance_f32 instance;
-#else /* ARM_CORTEX */
-  kiss_fft_cfg cfgfft;
-  kiss_fft_cfg cfgifft;
+  FastFourierPlan* plan;
   ComplexFloatArray temp;
-#endif /* ARM_CORTEX */
+  bool ownsTemp;
+  void deinit();
 
 public:
   /**
@@ -32,7 +77,7 @@ public:
   /**
    * Construct and initialize the instance.
    * @param[in] aSize The size of the FFT
-   * @remarks Only sizes of 32, 64, 128, 256, 512, 1024, 2048, 4096 are supported, due to limitations of the CMSIS library.
+   * @remarks Size must be even, and half the size must only have factors of 2, 3 and 5. See isSupportedSize()
    * @note When built for ARM Cortex-M processor series, this method uses the optimized <a href="http://www.keil.com/pack/doc/CMSIS/General/html/index.html">CMSIS library</a>
   */
   FastFourierTransform(int aSize);
@@ -46,10 +91,25 @@ public:
   */
   void init(int aSize);
 
+  /**
+   * Initialize the instance with user supplied scratch memory.
+   * Large transforms can be given a buffer placed in external memory, e.g. with EXTERNAL_RAM
+   * @param aSize The size of the FFT
+   * @param scratch Working memory of at least aSize/2 elements, not used by the CMSIS sizes
+  */
+  void init(int aSize, ComplexFloatArray scratch);
+
+  /**
+   * Check if an FFT size is supported.
+   * @return true if @param aSize is even and aSize/2 only has prime factors of 2, 3 and 5
+   */
+  static bool isSupportedSize(int aSize);
+
   /**
    * Perform the direct FFT.
    * @param[in] input The real-valued input array
-   * @param[out] output The complex-valued output array
+   * @param[out] output The complex-valued output array, with getSize()/2 elements.
+   * The real-valued DC and Nyquist bins are packed into the real and imaginary part of the first element.
    * @remarks Calling this method will mess up the content of the **input** array.
    * @note When built for ARM Cortex-M processor series, this method uses the optimized <a href="http://www.keil.com/pack/doc/CMSIS/General/html/index.html">CMSIS library</a>
   */
@@ -58,7 +118,7 @@ public:
   /**
    * Perform the inverse FFT.
    * The output is rescaled by 1/fftSize.
-   * @param[in] input The complex-valued input array
+   * @param[in] input The complex-valued input array, packed as the output of fft()
    * @param[out] output The real-valued output array
    * @remarks Calling this method will mess up the content of the **input** array.
    * @note When built for ARM Cortex-M processor series, this method uses the optimized <a href="http://www.keil.com/pack/doc/CMSIS/General/html/index.html">CMSIS library</a>
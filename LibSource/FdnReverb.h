@@ -0,0 +1,353 @@
+#ifndef __FdnReverb_h__
+#define __FdnReverb_h__
+
+#include "FloatArray.h"
+#include "DelayLine.h"
+#include "basicmaths.h"
+#include "message.h"
+
+/* longest delay in samples at 48kHz and size 1, for 8 or 16 lines */
+#define FDN_LONGEST_DELAY(lines) ((lines) == 8 ? 3301 : 3433)
+/* smallest power of two that is greater than or equal to x, for constant expressions */
+#define FDN_OR_SHIFT_1(x) ((x) | (x) >> 1)
+#define FDN_OR_SHIFT_2(x) (FDN_OR_SHIFT_1(x) | FDN_OR_SHIFT_1(x) >> 2)
+#define FDN_OR_SHIFT_4(x) (FDN_OR_SHIFT_2(x) | FDN_OR_SHIFT_2(x) >> 4)
+#define FDN_OR_SHIFT_8(x) (FDN_OR_SHIFT_4(x) | FDN_OR_SHIFT_4(x) >> 8)
+#define FDN_POWER_OF_TWO(x) ((FDN_OR_SHIFT_8((x)-1) | FDN_OR_SHIFT_8((x)-1) >> 16) + 1)
+/**
+ * Number of floats for the delay lines of an FdnReverb, as a constant expression.
+ * @param sr sample rate in Hz, a whole number
+ * @param size maximum size that will be set with setSize(), a whole number
+ */
+#define FDN_DELAY_MEMORY_SIZE(lines, sr, size) \
+  ((lines)*FDN_POWER_OF_TWO(FDN_LONGEST_DELAY(lines)*(size)*(sr)/48000 + FdnReverb::MAX_DEPTH + 4))
+/** Number of floats for the filter state and block buffers of an FdnReverb, as a constant expression */
+#define FDN_STATE_MEMORY_SIZE(lines, blocksize) ((lines)*(1 + (blocksize)) + 2*(blocksize))
+
+/**
+ * Feedback delay network reverb, with 8 or 16 delay lines.
+ * Each block of samples is read from all delay lines, filtered, mixed with an orthogonal
+ * matrix (Hadamard or Householder) and written back with the input, so the matrix is
+ * applied to whole blocks, with additions and subtractions of FloatArrays.
+ * Blocks are split into chunks that are shorter than the shortest delay.
+ *
+ * Each line has a first order damping filter, which sets the decay time at high
+ * frequencies relative to the decay time at DC, and a gain that sets the decay time.
+ * Every other line is read with a slowly modulated, Hermite interpolated tap, which breaks
+ * up metallic resonances. The other lines are read with block copies.
+ * Parameter changes are smoothed: gains ramp over each block, and changes of size glide
+ * the delay times at no more than 1/16 sample per sample.
+ *
+ * The delay lines need lines*2^n samples of memory and are best placed in external
+ * RAM, while the filter state and block buffers are small and accessed for every sample,
+ * and are best placed in core coupled memory, with sizes for the highest sample rate and
+ * block size that the patch will run at:
+ * @code
+ * static float delays[FDN_DELAY_MEMORY_SIZE(16, 48000, 2)] EXTERNAL_RAM;
+ * static float state[FDN_STATE_MEMORY_SIZE(16, 128)] CCM_RAM;
+ * reverb = FdnReverb::create(16, getSampleRate(), getBlockSize(), 2, delays, state);
+ * @endcode
+ * The sizes are the same as from getDelayMemorySize() and getStateMemorySize().
+ */
+class FdnReverb {
+public:
+  enum MixingMatrix {
+    HadamardMatrix, // full mixing of all lines, in log2(lines) stages
+    HouseholderMatrix // cheaper, each line feeds back mostly into itself
+  };
+  static const int MAX_LINES = 16;
+  static const int MAX_DEPTH = 16; // maximum modulation depth in samples
+private:
+  int lines;
+  float sampleRate;
+  float maxSize;
+  MixingMatrix matrix;
+  FloatDelayLine delays[MAX_LINES];
+  FloatArray buffers[MAX_LINES];
+  FloatArray taps;
+  FloatArray dry;
+  float target[MAX_LINES]; // delay time at the current size
+  float delay[MAX_LINES]; // delay time, gliding towards the target
+  float tap[MAX_LINES]; // modulated delay time at the end of the last chunk
+  float gain[MAX_LINES];
+  float pole[MAX_LINES]; // damping filter coefficient
+  float* lowpass; // damping filter states
+  float size, decay, damping, depth, rate, phase;
+  float* delayMemory;
+  float* stateMemory;
+  bool ownsMemory;
+
+  /* delays in samples at 48kHz and size 1: prime numbers from 30 to 72ms */
+  static float getLength(int line, int lines){
+    static const float lengths[MAX_LINES] = {
+      1447, 1553, 1693, 1831, 1949, 2083, 2213, 2351,
+      2477, 2617, 2749, 2887, 3019, 3163, 3301, 3433 };
+    return lengths[line*MAX_LINES/lines];
+  }
+
+  static uint32_t getLineSize(int lines, float sr, float maxSize){
+    uint32_t len = (uint32_t)(FDN_LONGEST_DELAY(lines)*maxSize*sr/48000) + MAX_DEPTH + 4;
+    return CircularBuffer<float>::getPowerOfTwo(len);
+  }
+
+  void updateParameters(){
+    float norm = matrix == HadamardMatrix ? 1/sqrtf(lines) : 1;
+    for(int i=0; i<lines; ++i){
+      // gain for a decay of 60dB in decay seconds: 10^(-3*delay/(sr*decay))
+      float g = exp2f(-9.965784f*delay[i]/(sampleRate*decay));
+      // unity DC gain one pole low pass with a gain of g^(1/damping - 1) at Nyquist
+      float gh = exp2f(-9.965784f*delay[i]*(1/damping - 1)/(sampleRate*decay));
+      pole[i] = (1 - gh)/(1 + gh);
+      gain[i] = g*norm;
+    }
+  }
+
+  void hadamard(int n){
+    // fast Walsh-Hadamard transform on blocks: a, b = a+b, a-b
+    for(int h=1; h<lines; h*=2){
+      for(int i=0; i<lines; i+=h*2){
+	for(int j=i; j<i+h; ++j){
+	  FloatArray a = buffers[j].subArray(0, n);
+	  FloatArray b = buffers[j+h].subArray(0, n);
+	  a.add(b);
+	  b.multiply(-2);
+	  b.add(a);
+	}
+      }
+    }
+  }
+
+  void householder(int n){
+    // x - 2/N*sum(x)
+    FloatArray sum = taps.subArray(0, n);
+    buffers[0].subArray(0, n).copyTo(sum);
+    for(int i=1; i<lines; ++i)
+      sum.add(buffers[i].subArray(0, n));
+    sum.multiply(-2.0f/lines);
+    for(int i=0; i<lines; ++i)
+      buffers[i].subArray(0, n).add(sum);
+  }
+
+  void processChunk(FloatArray input, FloatArray left, FloatArray right){
+    int n = input.getSize();
+    FloatArray in = dry.subArray(0, n);
+    in.copyFrom(input);
+    float maxStep = n*(1.0f/16);
+    phase += rate*n/sampleRate;
+    if(phase > 1)
+      phase -= 1;
+    float oldgain[MAX_LINES];
+    float oldpole[MAX_LINES];
+    for(int i=0; i<lines; ++i){
+      oldgain[i] = gain[i];
+      oldpole[i] = pole[i];
+      delay[i] += max(-maxStep, min(maxStep, target[i] - delay[i]));
+    }
+    updateParameters();
+    left.clear();
+    right.clear();
+    for(int i=0; i<lines; ++i){
+      FloatArray buf = buffers[i].subArray(0, n);
+      float end = delay[i];
+      if(i & 1)
+	end += depth*(1 + sinf(2*M_PI*(phase + (float)i/lines)))*0.5f;
+      if(end == tap[i] && end == (int)end){
+	delays[i].read(buf, (int)end - n);
+      }else{
+	// block reads are aligned with the last block written
+	float step = (end - tap[i])/n;
+	float d = tap[i] - n;
+	for(int k=0; k<n; ++k)
+	  taps[k] = d + step*(k+1);
+	delays[i].readHermite(buf, taps.subArray(0, n));
+      }
+      tap[i] = end;
+      if(i & 1)
+	right.add(buf);
+      else
+	left.add(buf);
+      // damping filter and gain, with coefficients ramped over the chunk
+      float g = oldgain[i];
+      float dg = (gain[i] - g)/n;
+      float p = oldpole[i];
+      float dp = (pole[i] - p)/n;
+      float y = lowpass[i];
+      for(int k=0; k<n; ++k){
+	g += dg;
+	p += dp;
+	y = buf[k] + p*(y - buf[k]);
+	buf[k] = y*g;
+      }
+      lowpass[i] = y;
+    }
+    if(matrix == HadamardMatrix)
+      hadamard(n);
+    else
+      householder(n);
+    for(int i=0; i<lines; ++i){
+      FloatArray buf = buffers[i].subArray(0, n);
+      if(i & 2)
+	buf.subtract(in);
+      else
+	buf.add(in);
+      delays[i].write(buf);
+    }
+    float norm = 2.0f/lines;
+    left.multiply(norm);
+    right.multiply(norm);
+  }
+
+public:
+  FdnReverb(int aLines, float sr, int blocksize, float aMaxSize, MixingMatrix aMatrix,
+	    float* aDelayMemory, float* aStateMemory)
+    : lines(aLines), sampleRate(sr), maxSize(aMaxSize), matrix(aMatrix),
+      size(1), decay(2), damping(0.5), depth(0), rate(0.5), phase(0),
+      delayMemory(aDelayMemory), stateMemory(aStateMemory), ownsMemory(false) {
+    ASSERT(lines == 8 || lines == 16, "FDN reverb needs 8 or 16 lines");
+    uint32_t len = getLineSize(lines, sr, maxSize);
+    lowpass = stateMemory;
+    float* state = stateMemory + lines;
+    for(int i=0; i<lines; ++i){
+      delays[i] = FloatDelayLine(delayMemory+i*len, len);
+      delays[i].clear();
+      lowpass[i] = 0;
+      buffers[i] = FloatArray(state, blocksize);
+      state += blocksize;
+    }
+    taps = FloatArray(state, blocksize);
+    dry = FloatArray(state+blocksize, blocksize);
+    setSize(1);
+    for(int i=0; i<lines; ++i){
+      delay[i] = target[i];
+      tap[i] = target[i];
+    }
+    updateParameters();
+  }
+
+  ~FdnReverb(){
+    if(ownsMemory){
+      delete[] delayMemory;
+      delete[] stateMemory;
+    }
+  }
+
+  int getNumberOfLines(){
+    return lines;
+  }
+
+  /**
+   * Set the room size, as a multiple of delays from 30 to 72ms.
+   * @param value from 0.25 to the maximum size given at creation
+   */
+  void setSize(float value){
+    size = max(0.25f, min(maxSize, value));
+    for(int i=0; i<lines; ++i)
+      target[i] = (int)(getLength(i, lines)*size*sampleRate/48000 + 0.5f);
+  }
+
+  float getSize(){
+    return size;
+  }
+
+  /** set the time in seconds for the reverb to decay by 60dB */
+  void setDecay(float seconds){
+    decay = max(0.01f, seconds);
+  }
+
+  float getDecay(){
+    return decay;
+  }
+
+  /**
+   * Set the decay time at high frequencies, relative to the decay time at low frequencies.
+   * @param ratio from 0.05 to 1, 1 for no damping
+   */
+  void setDamping(float ratio){
+    damping = max(0.05f, min(1.0f, ratio));
+  }
+
+  float getDamping(){
+    return damping;
+  }
+
+  /**
+   * Set the delay modulation of every other line.
+   * @param samples modulation depth, up to MAX_DEPTH samples
+   * @param frequency modulation rate in Hz
+   */
+  void setModulation(float samples, float frequency){
+    depth = max(0.0f, min((float)MAX_DEPTH, samples));
+    rate = frequency;
+  }
+
+  void clear(){
+    for(int i=0; i<lines; ++i){
+      delays[i].clear();
+      lowpass[i] = 0;
+    }
+  }
+
+  /**
+   * Process a block of mono input into a stereo reverb signal, without the dry signal.
+   * The input and output arrays may be the same.
+   */
+  void process(FloatArray input, FloatArray left, FloatArray right){
+    int len = input.getSize();
+    ASSERT(len <= taps.getSize(), "Block too large");
+    int pos = 0;
+    while(pos < len){
+      // chunks must be shorter than the delays, so that every sample read has been written
+      float shortest = delay[0];
+      for(int i=1; i<lines; ++i)
+	shortest = min(shortest, delay[i]);
+      int n = min(len - pos, (int)shortest - MAX_DEPTH - 4);
+      processChunk(input.subArray(pos, n), left.subArray(pos, n), right.subArray(pos, n));
+      pos += n;
+    }
+  }
+
+  /**
+   * Get the number of floats needed for the delay lines.
+   * FDN_DELAY_MEMORY_SIZE() gives the same size at compile time.
+   * @param maxSize the maximum size that will be set with setSize()
+   */
+  static int getDelayMemorySize(int lines, float sampleRate, float maxSize){
+    return lines*getLineSize(lines, sampleRate, maxSize);
+  }
+
+  /**
+   * Get the number of floats needed for the filter state and block buffers.
+   * FDN_STATE_MEMORY_SIZE() gives the same size at compile time.
+   */
+  static int getStateMemorySize(int lines, int blocksize){
+    return lines*(1 + blocksize) + 2*blocksize;
+  }
+
+  /**
+   * Create a reverb with memory that is allocated by the caller, for example in external RAM
+   * for the delays and core coupled memory for the state.
+   */
+  static FdnReverb* create(int lines, float sampleRate, int blocksize, float maxSize,
+			   float* delayMemory, float* stateMemory, MixingMatrix matrix = HadamardMatrix){
+    return new FdnReverb(lines, sampleRate, blocksize, maxSize, matrix, delayMemory, stateMemory);
+  }
+
+  /**
+   * Create a reverb with memory allocated on the heap.
+   * @param maxSize the maximum size that will be set with setSize()
+   */
+  static FdnReverb* create(int lines, float sampleRate, int blocksize, float maxSize = 1,
+			   MixingMatrix matrix = HadamardMatrix){
+    float* delayMemory = new float[getDelayMemorySize(lines, sampleRate, maxSize)];
+    float* stateMemory = new float[getStateMemorySize(lines, blocksize)];
+    FdnReverb* reverb = new FdnReverb(lines, sampleRate, blocksize, maxSize, matrix, delayMemory, stateMemory);
+    reverb->ownsMemory = true;
+    return reverb;
+  }
+
+  static void destroy(FdnReverb* reverb){
+    delete reverb;
+  }
+};
+
+#endif /* __FdnReverb_h__ */
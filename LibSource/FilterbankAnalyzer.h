@@ -0,0 +1,189 @@
+#ifndef __FilterbankAnalyzer_h__
+#define __FilterbankAnalyzer_h__
+
+#include "FloatArray.h"
+#include "ComplexFloatArray.h"
+
+/**
+ * Maps the output of FastFourierTransform to constant-Q or mel frequency bands.
+ * Each band is a triangular filter over the FFT bins, spanning from the centre of the
+ * band below to the centre of the band above. Centres are spaced evenly on a logarithmic
+ * (constant-Q) or mel scale, and the weights of each band sum to one, so the output is
+ * the weighted mean magnitude of the bins in the band.
+ * The filter kernels are precomputed once and stored as a sparse matrix in compressed
+ * sparse row (CSR) form: only the non-zero weights are stored, with their bin index, and
+ * the weights of each band start at an offset given by the row index. Since every bin
+ * contributes to at most two bands, analysis costs about two multiply-adds per bin.
+ * Bands that are narrower than the bin spacing interpolate between the two nearest bins.
+ */
+class FilterbankAnalyzer {
+public:
+  typedef enum FilterbankType {
+    ConstantQFilterbank,
+    MelFilterbank
+  } FilterbankType;
+private:
+  FilterbankType type;
+  int bins; // number of FFT bins, from DC to Nyquist
+  int bands;
+  float binWidth;
+  float lowest; // lower edge of the first band
+  float highest; // upper edge of the last band
+  FloatArray centres;
+  FloatArray weights; // non-zero kernel values, band by band
+  uint16_t* columns; // bin index of each weight
+  uint16_t* rows; // offset of the first weight of each band, and the total
+  FloatArray magnitudes; // scratch
+
+  float warp(float frequency){
+    if(type == MelFilterbank)
+      return 2595*log10f(1 + frequency/700);
+    return log2f(frequency);
+  }
+
+  float unwarp(float value){
+    if(type == MelFilterbank)
+      return 700*(powf(10, value/2595) - 1);
+    return exp2f(value);
+  }
+
+  /**
+   * Compute the kernel of band @param b, or only count its non-zero weights if
+   * @param offset is negative.
+   * @return the number of non-zero weights
+   */
+  int kernel(int b, int offset){
+    float lo = b == 0 ? lowest : centres[b-1];
+    float hi = b == bands-1 ? highest : centres[b+1];
+    float centre = centres[b];
+    int first = max(0, (int)ceilf(lo/binWidth));
+    int last = min(bins-1, (int)floorf(hi/binWidth));
+    int count = 0;
+    float sum = 0;
+    for(int k=first; k<=last; ++k){
+      float f = k*binWidth;
+      float w = f <= centre ? (f-lo)/(centre-lo) : (hi-f)/(hi-centre);
+      if(w > 0){
+	if(offset >= 0){
+	  weights[offset+count] = w;
+	  columns[offset+count] = k;
+	}
+	sum += w;
+	count++;
+      }
+    }
+    if(count == 0){
+      // narrower than a bin: interpolate between the nearest bins
+      int k = min(bins-2, (int)(centre/binWidth));
+      float frac = centre/binWidth - k;
+      if(offset >= 0){
+	weights[offset] = 1 - frac;
+	weights[offset+1] = frac;
+	columns[offset] = k;
+	columns[offset+1] = k+1;
+      }
+      return 2;
+    }
+    if(offset >= 0)
+      weights.subArray(offset, count).multiply(1/sum);
+    return count;
+  }
+
+public:
+  /**
+   * @param sampleRate sample rate of the analysed signal
+   * @param fftSize size of the FastFourierTransform
+   * @param numberOfBands number of output bands
+   * @param minFrequency lower edge of the lowest band
+   * @param maxFrequency upper edge of the highest band, at most the Nyquist frequency
+   * @param aType constant-Q or mel band spacing
+   */
+  FilterbankAnalyzer(float sampleRate, int fftSize, int numberOfBands, float minFrequency, float maxFrequency, FilterbankType aType = ConstantQFilterbank)
+    : type(aType), bins(fftSize/2+1), bands(numberOfBands), binWidth(sampleRate/fftSize),
+      lowest(minFrequency), highest(maxFrequency) {
+    ASSERT(bands > 0 && minFrequency > 0 && maxFrequency > minFrequency && maxFrequency <= sampleRate/2, "Invalid filterbank");
+    centres = FloatArray::create(bands);
+    float lo = warp(minFrequency);
+    float step = (warp(maxFrequency) - lo)/(bands+1);
+    for(int b=0; b<bands; ++b)
+      centres[b] = unwarp(lo + (b+1)*step);
+    rows = new uint16_t[bands+1];
+    rows[0] = 0;
+    for(int b=0; b<bands; ++b)
+      rows[b+1] = rows[b] + kernel(b, -1);
+    weights = FloatArray::create(rows[bands]);
+    columns = new uint16_t[rows[bands]];
+    for(int b=0; b<bands; ++b)
+      kernel(b, rows[b]);
+    magnitudes = FloatArray::create(bins);
+  }
+
+  ~FilterbankAnalyzer(){
+    FloatArray::destroy(centres);
+    FloatArray::destroy(weights);
+    FloatArray::destroy(magnitudes);
+    delete[] columns;
+    delete[] rows;
+  }
+
+  int getNumberOfBands(){
+    return bands;
+  }
+
+  /**
+   * Get the centre frequency of band @param band
+   */
+  float getFrequency(int band){
+    return centres[band];
+  }
+
+  /**
+   * Get the number of non-zero weights in the filterbank, which is the number of
+   * multiply-adds per analysis.
+   */
+  int getKernelSize(){
+    return rows[bands];
+  }
+
+  /**
+   * Compute the band values from bin values, such as magnitudes or powers.
+   * @param input bin values from DC to Nyquist, fftSize/2+1 elements
+   * @param output band values
+   */
+  void process(FloatArray input, FloatArray output){
+    ASSERT(input.getSize() >= bins && output.getSize() >= bands, "Array too small");
+    const float* w = weights.getData();
+    const uint16_t* col = columns;
+    const float* x = input.getData();
+    for(int b=0; b<bands; ++b){
+      float sum = 0;
+      for(int i=rows[b]; i<rows[b+1]; ++i)
+	sum += w[i]*x[col[i]];
+      output[b] = sum;
+    }
+  }
+
+  /**
+   * Compute the band magnitudes of a spectrum.
+   * @param spectrum packed spectrum, as returned by FastFourierTransform::fft()
+   * @param output band magnitudes
+   */
+  void process(ComplexFloatArray spectrum, FloatArray output){
+    ASSERT(spectrum.getSize() >= bins-1, "Spectrum too small");
+    spectrum.subArray(0, bins-1).getMagnitudeValues(magnitudes);
+    // the first element holds the real valued DC and Nyquist bins
+    magnitudes[0] = fabsf(spectrum[0].re);
+    magnitudes[bins-1] = fabsf(spectrum[0].im);
+    process(magnitudes, output);
+  }
+
+  static FilterbankAnalyzer* create(float sampleRate, int fftSize, int bands, float minFrequency, float maxFrequency, FilterbankType type = ConstantQFilterbank){
+    return new FilterbankAnalyzer(sampleRate, fftSize, bands, minFrequency, maxFrequency, type);
+  }
+
+  static void destroy(FilterbankAnalyzer* obj){
+    delete obj;
+  }
+};
+
+#endif /* __FilterbankAnalyzer_h__ */
@@ -1,7 +1,11 @@
 #include "FloatArray.h"
 #include "basicmaths.h"
 #include "message.h"
+#include "RandomGenerator.h"
 #include <string.h>
+#include <stdint.h>
+
+static RandomGenerator generator;
 
  FloatArray::FloatArray() :
    data(NULL), size(0) {}
@@ -379,6 +383,132 @@ void FloatArray::multiply(float scalar, FloatArray destination){
 #endif
 }
 
+/* 2^x, using a minimax polynomial for the fraction and adding the integer part to the exponent bits */
+static inline float exp2Kernel(float x){
+  x = x < -126.0f ? -126.0f : (x > 127.0f ? 127.0f : x);
+  int32_t i = (int32_t)x;
+  i -= x < i;
+  float f = x - i;
+  union {
+    float f;
+    uint32_t i;
+  } p;
+  p.f = 1.0f + f*(0.69304484f + f*(0.24128024f + f*(0.052242398f + f*0.013426731f)));
+  p.i += (uint32_t)i << 23;
+  return p.f;
+}
+
+/* log2(|x|), from the exponent bits and a minimax polynomial for the mantissa in [0.75, 1.5) */
+static inline float log2Kernel(float x){
+  union {
+    float f;
+    uint32_t i;
+  } m;
+  m.f = x;
+  int32_t e = (int32_t)((m.i >> 23) & 0xff) - 127;
+  m.i = (m.i & 0x007fffff) | 0x3f800000;
+  if(m.f >= 1.5f){
+    m.f *= 0.5f;
+    e++;
+  }
+  float u = m.f - 1.0f;
+  return e + u*(1.4426816f + u*(-0.72109449f + u*(0.48164558f + u*(-0.37106976f + u*(0.29272786f + u*-0.14517978f)))));
+}
+
+void FloatArray::fastExp2(FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  for(int n=0; n<size; n++)
+    destination.data[n] = exp2Kernel(data[n]);
+}
+
+void FloatArray::fastExp2(){
+  fastExp2(*this);
+}
+
+void FloatArray::fastExp(FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  for(int n=0; n<size; n++)
+    destination.data[n] = exp2Kernel(data[n]*1.44269504f);
+}
+
+void FloatArray::fastExp(){
+  fastExp(*this);
+}
+
+void FloatArray::fastLog(FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  for(int n=0; n<size; n++)
+    destination.data[n] = log2Kernel(data[n])*0.69314718f;
+}
+
+void FloatArray::fastLog(){
+  fastLog(*this);
+}
+
+void FloatArray::fastPow(float exponent, FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  for(int n=0; n<size; n++)
+    destination.data[n] = exp2Kernel(log2Kernel(data[n])*exponent);
+}
+
+void FloatArray::fastPow(float exponent){
+  fastPow(exponent, *this);
+}
+
+void FloatArray::fastTanh(FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  for(int n=0; n<size; n++){
+    // tanh(x) = (e^2x - 1)/(e^2x + 1)
+    float t = exp2Kernel(data[n]*2.88539008f);
+    destination.data[n] = (t - 1.0f)/(t + 1.0f);
+  }
+}
+
+void FloatArray::fastTanh(){
+  fastTanh(*this);
+}
+
+void FloatArray::softclip(FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  for(int n=0; n<size; n++){
+    float x = data[n];
+    x = x < -1.0f ? -1.0f : (x > 1.0f ? 1.0f : x);
+    destination.data[n] = x*(1.5f - 0.5f*x*x);
+  }
+}
+
+void FloatArray::softclip(){
+  softclip(*this);
+}
+
+void FloatArray::fastAtan2(FloatArray x, FloatArray destination){
+  ASSERT(x.size == size && destination.size >= size, "Arrays size mismatch");
+  for(int n=0; n<size; n++)
+    destination.data[n] = polynomial_atan2f(data[n], x.data[n]);
+}
+
+void FloatArray::dbToGain(FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  // 10^(dB/20) = 2^(dB*log2(10)/20)
+  for(int n=0; n<size; n++)
+    destination.data[n] = exp2Kernel(data[n]*0.16609640f);
+}
+
+void FloatArray::dbToGain(){
+  dbToGain(*this);
+}
+
+void FloatArray::gainToDb(FloatArray destination){
+  ASSERT(destination.size >= size, "Destination array too small");
+  // 20*log10(x) = 20*log10(2)*log2(x)
+  for(int n=0; n<size; n++)
+    destination.data[n] = log2Kernel(data[n])*6.0205999f;
+}
+
+void FloatArray::gainToDb(){
+  gainToDb(*this);
+}
+
 void FloatArray::negate(FloatArray& destination){//allows in-place
   /// @note When built for ARM Cortex-M processor series, this method uses the optimized <a href="http://www.keil.com/pack/doc/CMSIS/General/html/index.html">CMSIS library</a>
 #ifdef ARM_CORTEX
@@ -399,13 +529,9 @@ void FloatArray::noise(){
 }
 
 void FloatArray::noise(float min, float max){
-  float amplitude = fabs(max-min);
-  float offset = min;
   ASSERT(getSize()>10, "10<getSize");
   ASSERT(size==getSize(), "getSize");
-  for(int n=0; n<size; n++){
-    data[n]=(rand()/(RAND_MAX+1.0f)) * amplitude + offset;
-  }
+  generator.fill(*this, min, max);
 }
 
 
@@ -125,6 +125,131 @@ public:
   */
   void negate(); 
   
+  /**
+   * Base 2 exponential of the array.
+   * Stores 2 to the power of the elements in the array into destination.
+   * Uses a 4th order polynomial for the fractional part: the maximum relative error is
+   * 3e-6, or 0.005 cents when the values are in octaves.
+   * Values are limited to the range [-126, 127].
+   * @param[out] destination the destination array.
+  */
+  void fastExp2(FloatArray destination);
+  
+  /**
+   * Base 2 exponential of the array.
+   * Sets each element in the array to 2 to the power of the element.
+  */
+  void fastExp2();
+  
+  /**
+   * Natural exponential of the array.
+   * Stores e to the power of the elements in the array into destination.
+   * The maximum relative error is 1e-5 for values in the range [-87, 88].
+   * @param[out] destination the destination array.
+  */
+  void fastExp(FloatArray destination);
+  
+  /**
+   * Natural exponential of the array.
+   * Sets each element in the array to e to the power of the element.
+  */
+  void fastExp();
+  
+  /**
+   * Natural logarithm of the array.
+   * Stores the logarithm of the absolute value of the elements in the array into destination.
+   * Uses a 6th order polynomial for the mantissa: the maximum absolute error is 2e-6.
+   * Zero results in about -88.
+   * @param[out] destination the destination array.
+  */
+  void fastLog(FloatArray destination);
+  
+  /**
+   * Natural logarithm of the array.
+   * Sets each element in the array to the logarithm of its absolute value.
+  */
+  void fastLog();
+  
+  /**
+   * Power of the array.
+   * Stores the absolute value of the elements in the array, raised to the power of **exponent**, into destination.
+   * The maximum relative error is 2e-5 for exponents in the range [-10, 10].
+   * @param[in] exponent the power to raise the elements to
+   * @param[out] destination the destination array.
+  */
+  void fastPow(float exponent, FloatArray destination);
+  
+  /**
+   * Power of the array.
+   * Sets each element in the array to its absolute value raised to the power of **exponent**.
+  */
+  void fastPow(float exponent);
+  
+  /**
+   * Hyperbolic tangent of the array.
+   * Stores the hyperbolic tangent of the elements in the array into destination.
+   * The maximum absolute error is 3e-6.
+   * @param[out] destination the destination array.
+  */
+  void fastTanh(FloatArray destination);
+  
+  /**
+   * Hyperbolic tangent of the array.
+   * Sets each element in the array to its hyperbolic tangent.
+  */
+  void fastTanh();
+  
+  /**
+   * Soft clip the array.
+   * Stores the elements in the array, soft clipped with a cubic curve, into destination:
+   * 1.5x - 0.5x^3 in the range [-1, 1], and -1 or 1 outside it.
+   * @param[out] destination the destination array.
+  */
+  void softclip(FloatArray destination);
+  
+  /**
+   * Soft clip the array.
+   * Soft clips each element in the array with a cubic curve.
+  */
+  void softclip();
+  
+  /**
+   * Arc tangent of two arrays.
+   * Stores the angle in radians of the points (**x**, y), with y the elements in the array, into destination.
+   * Uses the same polynomial as ComplexFloatArray::getPhaseValues(), within 2e-6 radians.
+   * @param[in] x the x coordinates
+   * @param[out] destination the destination array.
+  */
+  void fastAtan2(FloatArray x, FloatArray destination);
+  
+  /**
+   * Convert decibels to gain.
+   * Stores the gain factor of the elements in the array, in decibels, into destination.
+   * The maximum relative error is 5e-6 for values in the range [-120, 120].
+   * @param[out] destination the destination array.
+  */
+  void dbToGain(FloatArray destination);
+  
+  /**
+   * Convert decibels to gain.
+   * Sets each element in the array, in decibels, to its gain factor.
+  */
+  void dbToGain();
+  
+  /**
+   * Convert gain to decibels.
+   * Stores the elements in the array, as gain factors, in decibels into destination.
+   * The maximum absolute error is 2e-5 dB. Zero results in about -764dB.
+   * @param[out] destination the destination array.
+  */
+  void gainToDb(FloatArray destination);
+  
+  /**
+   * Convert gain to decibels.
+   * Sets each element in the array, as a gain factor, to its value in decibels.
+  */
+  void gainToDb();
+  
   /**
    * Random values
    * Fills the array with random values in the range [-1, 1)
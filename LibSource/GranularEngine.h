@@ -0,0 +1,250 @@
+#ifndef __GranularEngine_h__
+#define __GranularEngine_h__
+
+#include "FloatArray.h"
+#include "CircularBuffer.h"
+#include "RandomGenerator.h"
+#include "Window.h"
+#include "Interpolator.h"
+
+/**
+ * A single grain: a windowed segment of the source buffer, read at a fixed speed.
+ */
+class Grain {
+public:
+  uint32_t index; // integer part of the read position in the source buffer
+  float frac; // fractional part of the read position, apart so that speeds are exact in large buffers
+  float speed; // source samples per output sample, not negative
+  float phase; // read index in the window table
+  float increment; // window table samples per output sample
+  float left, right; // output gains
+  int remaining; // number of samples until the end of the grain
+
+  /**
+   * Add the grain to the output, returns false when the grain has ended.
+   * Costs the same for every sample, so that the load is proportional to the number of grains.
+   */
+  bool render(const float* source, uint32_t mask, const float* window,
+	      float* outL, float* outR, int size){
+    int n = min(size, remaining);
+    LinearKernel linear;
+    uint32_t i = index;
+    float f = frac;
+    float ph = phase;
+    for(int k=0; k<n; ++k){
+      int j = (int)ph;
+      float s = linear.read(source, mask, i, f)*linear.interpolate(window + j, ph - j);
+      outL[k] += s*left;
+      outR[k] += s*right;
+      f += speed;
+      uint32_t steps = (uint32_t)f;
+      i += steps;
+      f -= steps;
+      ph += increment;
+    }
+    index = i & mask;
+    frac = f;
+    phase = ph;
+    remaining -= n;
+    return remaining > 0;
+  }
+};
+
+/**
+ * Granular synthesis engine, with a pool of grains that is allocated when it is created,
+ * so that no memory is allocated while processing.
+ * Grains read from a circular source buffer, which can record live input or hold a
+ * sample, with linear interpolation and a window from a precomputed table.
+ * New grains are scheduled at sample accurate times, with a set density and random
+ * variation of timing, source position, pitch and stereo position.
+ * When all grains are in use, new grains are skipped, which bounds the processing time.
+ */
+class GranularEngine {
+private:
+  float sampleRate;
+  CircularFloatBuffer source;
+  Window window;
+  Grain* grains;
+  int* unused; // stack of unused grain indices
+  int maxGrains;
+  int available;
+  int* active; // indices of grains in use
+  int count;
+  RandomGenerator random;
+  float density, size, speed, delay, amplitude;
+  float timingJitter, positionJitter, pitchJitter, spread;
+  float untilNext; // samples until the next grain starts
+
+  void start(int offset, float* left, float* right, int blocksize){
+    if(available == 0)
+      return;
+    int index = unused[--available];
+    Grain& g = grains[index];
+    int length = max(2, (int)(size*sampleRate));
+    float ratio = speed;
+    if(pitchJitter > 0)
+      ratio *= exp2f(pitchJitter*random.getNextSample()*(1.0f/12));
+    // start far enough back that the grain doesn't overtake the write position
+    float back = delay + positionJitter*sampleRate*random.getNextFloat();
+    back = max(back, length*(ratio - 1) + blocksize + 2);
+    back = min(back, (float)source.getSize() - 4);
+    g.index = (source.getWriteIndex() - (uint32_t)back) & (source.getSize()-1);
+    g.frac = 0;
+    g.speed = ratio;
+    g.phase = 0;
+    g.increment = (float)(window.getSize()-1)/length;
+    float pan = 0.5f + spread*random.getNextSample()*0.5f;
+    g.left = amplitude*sqrtf(1 - pan);
+    g.right = amplitude*sqrtf(pan);
+    g.remaining = length;
+    if(g.render(source.getData(), source.getSize()-1, window.getData(),
+		left+offset, right+offset, blocksize-offset))
+      active[count++] = index;
+    else
+      unused[available++] = index;
+  }
+
+public:
+  /**
+   * @param buffer source buffer of @param bufferSize samples, a power of two
+   * @param grainBuffer @param numGrains grains, with @param freeBuffer and @param activeBuffer
+   * holding as many indices
+   * @param win window table
+   */
+  GranularEngine(float sr, float* buffer, int bufferSize, Grain* grainBuffer,
+		 int* freeBuffer, int* activeBuffer, int numGrains, Window win)
+    : sampleRate(sr), source(buffer, bufferSize), window(win), grains(grainBuffer),
+      unused(freeBuffer), maxGrains(numGrains), active(activeBuffer),
+      density(10), size(0.1), speed(1), delay(0), amplitude(1),
+      timingJitter(0), positionJitter(0), pitchJitter(0), spread(0), untilNext(0) {
+    source.clear();
+    reset();
+  }
+
+  /** stop all grains */
+  void reset(){
+    count = 0;
+    for(int i=0; i<maxGrains; ++i)
+      unused[i] = maxGrains-1-i;
+    available = maxGrains;
+    untilNext = 0;
+  }
+
+  /** the source buffer, which can be filled with a sample instead of recording */
+  CircularFloatBuffer& getSource(){
+    return source;
+  }
+
+  int getActiveGrains(){
+    return count;
+  }
+
+  int getMaxGrains(){
+    return maxGrains;
+  }
+
+  /** set the number of grains started per second */
+  void setDensity(float grainsPerSecond){
+    density = max(0.0f, min(sampleRate, grainsPerSecond));
+  }
+
+  /** set the length of each grain in seconds */
+  void setGrainSize(float seconds){
+    size = seconds;
+  }
+
+  /** set the playback speed of grains, 2 for an octave up */
+  void setSpeed(float ratio){
+    speed = max(0.0f, ratio);
+  }
+
+  /** set how far back from the write position grains start, in seconds */
+  void setPosition(float seconds){
+    delay = max(0.0f, seconds*sampleRate);
+  }
+
+  void setAmplitude(float value){
+    amplitude = value;
+  }
+
+  /** randomise the time between grains, from 0 for regular to 1 */
+  void setTimingJitter(float amount){
+    timingJitter = max(0.0f, min(1.0f, amount));
+  }
+
+  /** randomise the start position of grains, further back by up to @param seconds */
+  void setPositionJitter(float seconds){
+    positionJitter = max(0.0f, seconds);
+  }
+
+  /** randomise the pitch of grains by up to +/- @param semitones */
+  void setPitchJitter(float semitones){
+    pitchJitter = max(0.0f, semitones);
+  }
+
+  /** randomise the stereo position of grains, from 0 for center to 1 for full width */
+  void setSpread(float amount){
+    spread = max(0.0f, min(1.0f, amount));
+  }
+
+  /** write a block of input into the source buffer */
+  void record(FloatArray input){
+    source.write(input);
+  }
+
+  /**
+   * Render a block of grains into stereo output.
+   * Grains that start in this block begin at their sample offset.
+   */
+  void process(FloatArray left, FloatArray right){
+    int blocksize = left.getSize();
+    left.clear();
+    right.clear();
+    // continue grains that are playing
+    for(int i=0; i<count;){
+      int index = active[i];
+      if(grains[index].render(source.getData(), source.getSize()-1, window.getData(),
+			      left.getData(), right.getData(), blocksize)){
+	i++;
+      }else{
+	unused[available++] = index;
+	active[i] = active[--count];
+      }
+    }
+    // start new grains
+    if(density > 0){
+      while(untilNext < blocksize){
+	int offset = max(0, (int)untilNext);
+	start(offset, left.getData(), right.getData(), blocksize);
+	float interval = sampleRate/density;
+	untilNext += interval*(1 + timingJitter*random.getNextSample());
+      }
+      untilNext -= blocksize;
+    }else{
+      untilNext = 0;
+    }
+  }
+
+  /**
+   * @param bufferLength length of the source buffer in seconds, rounded up to a power of two
+   * @param maxGrains size of the grain pool
+   */
+  static GranularEngine* create(float sr, float bufferLength, int maxGrains,
+				Window::WindowType type = Window::HannWindow, int windowSize = 1024){
+    int len = CircularFloatBuffer::getPowerOfTwo(bufferLength*sr);
+    return new GranularEngine(sr, new float[len], len, new Grain[maxGrains],
+			      new int[maxGrains], new int[maxGrains], maxGrains,
+			      Window::create(type, windowSize));
+  }
+
+  static void destroy(GranularEngine* obj){
+    delete[] obj->source.getData();
+    delete[] obj->grains;
+    delete[] obj->unused;
+    delete[] obj->active;
+    Window::destroy(obj->window);
+    delete obj;
+  }
+};
+
+#endif /* __GranularEngine_h__ */
@@ -0,0 +1,197 @@
+#ifndef __Interpolator_h__
+#define __Interpolator_h__
+
+#include "FloatArray.h"
+#include "basicmaths.h"
+#include "message.h"
+
+/**
+ * Interpolation kernels for fractional reads from tables and delay lines.
+ * A kernel interpolates between the samples x[0] and x[1] at a fraction from 0 to 1,
+ * using TAPS samples from x[-BEFORE] to x[TAPS-BEFORE-1]. All kernels are symmetric,
+ * so they can also read a sequence backwards, as delay lines do.
+ *
+ * - LinearKernel: 2 points, cheapest, low pass filters fractional reads
+ * - HermiteKernel: 4-point, 3rd order Hermite (Catmull-Rom) spline, with a continuous slope
+ * - LagrangeKernel: 4-point, 3rd order Lagrange polynomial, exact for polynomials up to
+ * 3rd order but with steps in the slope at the samples
+ * - SincKernel: Blackman windowed sinc of N points, from a precomputed polyphase table.
+ * Flat up to close to Nyquist and low in aliasing, and the cutoff can be lowered for
+ * resampling down.
+ *
+ * Each kernel gets the block reads of Interpolator, which are compiled for that kernel
+ * so that the inner loops have no branches or calls:
+ * @code
+ * HermiteKernel hermite;
+ * hermite.read(table, indices, fractions, output);
+ * @endcode
+ */
+template<class Kernel>
+class Interpolator {
+public:
+  /**
+   * Interpolate a table of power of two size that wraps around, such as a wavetable or the
+   * memory of a circular buffer.
+   * @param mask size of the table minus one
+   */
+  inline float read(const float* data, uint32_t mask, uint32_t index, float frac) const {
+    const Kernel* kernel = static_cast<const Kernel*>(this);
+    index &= mask;
+    if(index >= (uint32_t)Kernel::BEFORE && index + Kernel::TAPS - Kernel::BEFORE <= mask+1)
+      return kernel->interpolate(data + index, frac);
+    float x[Kernel::TAPS];
+    for(int j=0; j<Kernel::TAPS; ++j)
+      x[j] = data[(index - Kernel::BEFORE + j) & mask];
+    return kernel->interpolate(x + Kernel::BEFORE, frac);
+  }
+
+  /**
+   * Gather and interpolate a block of samples from a table that wraps around:
+   * output[i] is read at indices[i] + fractions[i].
+   * @param table of power of two size
+   * @param indices whole numbers, wrapped to the table
+   * @param fractions from 0 to 1
+   */
+  void read(FloatArray table, FloatArray indices, FloatArray fractions, FloatArray output) const {
+    ASSERT((table.getSize() & (table.getSize()-1)) == 0, "Table size must be a power of two");
+    ASSERT(indices.getSize() >= output.getSize() && fractions.getSize() >= output.getSize(), "Not enough indices");
+    const float* data = table.getData();
+    uint32_t mask = table.getSize()-1;
+    const float* idx = indices.getData();
+    const float* frac = fractions.getData();
+    float* out = output.getData();
+    int size = output.getSize();
+    for(int i=0; i<size; ++i)
+      out[i] = read(data, mask, (uint32_t)(int)idx[i], frac[i]);
+  }
+
+  /**
+   * Gather and interpolate a block of samples from a table that wraps around,
+   * at fractional @param positions.
+   */
+  void read(FloatArray table, FloatArray positions, FloatArray output) const {
+    ASSERT((table.getSize() & (table.getSize()-1)) == 0, "Table size must be a power of two");
+    ASSERT(positions.getSize() >= output.getSize(), "Not enough positions");
+    const float* data = table.getData();
+    uint32_t mask = table.getSize()-1;
+    const float* pos = positions.getData();
+    float* out = output.getData();
+    int size = output.getSize();
+    for(int i=0; i<size; ++i){
+      int index = (int)pos[i];
+      if(pos[i] < index)
+	index--;
+      out[i] = read(data, mask, (uint32_t)index, pos[i] - index);
+    }
+  }
+};
+
+class LinearKernel : public Interpolator<LinearKernel> {
+public:
+  static const int TAPS = 2;
+  static const int BEFORE = 0;
+  inline float interpolate(const float* x, float frac) const {
+    return x[0] + frac*(x[1] - x[0]);
+  }
+};
+
+class HermiteKernel : public Interpolator<HermiteKernel> {
+public:
+  static const int TAPS = 4;
+  static const int BEFORE = 1;
+  inline float interpolate(const float* x, float frac) const {
+    float c = (x[1] - x[-1])*0.5f;
+    float v = x[0] - x[1];
+    float w = c + v;
+    float a = w + v + (x[2] - x[0])*0.5f;
+    float b = w + a;
+    return ((a*frac - b)*frac + c)*frac + x[0];
+  }
+};
+
+class LagrangeKernel : public Interpolator<LagrangeKernel> {
+public:
+  static const int TAPS = 4;
+  static const int BEFORE = 1;
+  inline float interpolate(const float* x, float frac) const {
+    float dm1 = frac - 1;
+    float dm2 = frac - 2;
+    float dp1 = frac + 1;
+    float a = dp1*frac;
+    float b = dm1*dm2;
+    return (x[2]*a*dm1 - x[-1]*frac*b)*(1.0f/6) + (x[0]*dp1*b - x[1]*a*dm2)*0.5f;
+  }
+};
+
+/**
+ * Windowed sinc kernel of N points, N even. The table holds the kernel at phases+1
+ * evenly spaced fractions, and reads interpolate linearly between the two nearest.
+ * Each phase is normalised to unity gain at DC.
+ */
+template<int N = 8>
+class SincKernel : public Interpolator<SincKernel<N> > {
+private:
+  float* table;
+  int phases;
+public:
+  static const int TAPS = N;
+  static const int BEFORE = N/2-1;
+
+  SincKernel() : table(NULL), phases(0) {}
+
+  SincKernel(float* aTable, int aPhases) : table(aTable), phases(aPhases) {}
+
+  int getNumberOfPhases() const {
+    return phases;
+  }
+
+  /* the N coefficients for a fraction of @param phase / getNumberOfPhases() */
+  const float* getCoefficients(int phase) const {
+    return table + phase*N;
+  }
+
+  inline float interpolate(const float* x, float frac) const {
+    float p = frac*phases;
+    int phase = min((int)p, phases-1);
+    float d = p - phase;
+    const float* c0 = table + phase*N;
+    const float* c1 = c0 + N;
+    const float* src = x - BEFORE;
+    float s0 = 0, s1 = 0;
+    for(int j=0; j<N; ++j){
+      s0 += src[j]*c0[j];
+      s1 += src[j]*c1[j];
+    }
+    return s0 + d*(s1 - s0);
+  }
+
+  /**
+   * Create a kernel with a table of @param phases fractions.
+   * @param cutoff as a fraction of the Nyquist frequency, below 1 to resample down
+   */
+  static SincKernel<N>* create(int phases = 128, float cutoff = 1.0f){
+    ASSERT(N >= 4 && (N & 1) == 0, "Sinc kernel must have an even number of points");
+    float* table = new float[(phases+1)*N];
+    for(int p=0; p<=phases; ++p){
+      float* c = table + p*N;
+      float sum = 0;
+      for(int j=0; j<N; ++j){
+	float t = j - BEFORE - (float)p/phases; // distance from the interpolated point
+	float w = 0.42f + 0.5f*cosf(2*M_PI*t/N) + 0.08f*cosf(4*M_PI*t/N);
+	float s = t == 0 ? 1.0f : sinf(M_PI*cutoff*t)/(M_PI*cutoff*t);
+	c[j] = s*w;
+	sum += c[j];
+      }
+      for(int j=0; j<N; ++j)
+	c[j] /= sum;
+    }
+    return new SincKernel<N>(table, phases);
+  }
+
+  static void destroy(SincKernel<N>* kernel){
+    delete[] kernel->table;
+    delete kernel;
+  }
+};
+
+#endif /* __Interpolator_h__ */
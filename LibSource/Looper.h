@@ -0,0 +1,284 @@
+#ifndef __Looper_h__
+#define __Looper_h__
+
+#include "FloatArray.h"
+#include "SampleBank.h"
+#include "Interpolator.h"
+
+/**
+ * Mono looper with varispeed playback and overdub.
+ * The first recording sets the loop length. The loop then plays with 4-point Hermite
+ * interpolation at any speed from -MAX_SPEED to MAX_SPEED, and overdubs are written
+ * at the same speed: every loop sample that the play position passes gets the input,
+ * interpolated to the time at which it was passed. Overdubs trail the play position by
+ * a few samples, so that they are heard on the next pass and not immediately.
+ * Starting and stopping playback and overdubs fade over one block, to avoid clicks.
+ *
+ * The loop memory is best placed in external SDRAM, either from the heap or a static array:
+ * @code
+ * static float loop[1<<20] EXTERNAL_RAM;
+ * looper = Looper::create(loop, 1<<20);
+ * @endcode
+ * A loop can also start from a sample in a SampleBank, which is copied into the loop memory.
+ */
+class Looper {
+public:
+  enum LooperState {
+    StoppedState,
+    RecordingState,
+    PlayingState,
+    OverdubbingState
+  };
+  static const int MAX_SPEED = 4;
+  static const int MIN_LENGTH = 16;
+private:
+  static const int LAG = 4; // distance from the play position to the overdub position
+  float* buffer;
+  int maxLength;
+  int length;
+  LooperState state;
+  int index; // integer part of the play position
+  float frac; // fractional part of the play position
+  float speed;
+  float feedback;
+  float level; // output gain, faded in and out
+  float dub; // overdub gain, faded in and out
+  float previous; // last input sample
+  bool ownsMemory;
+
+  inline int wrap(int i){
+    if(i < 0)
+      return i + length;
+    if(i >= length)
+      return i - length;
+    return i;
+  }
+
+  inline float interpolate(){
+    HermiteKernel hermite;
+    if(index > 0 && index+2 < length)
+      return hermite.interpolate(buffer + index, frac);
+    // the loop length is not a power of two, so wrap each point
+    float x[4] = { buffer[wrap(index-1)], buffer[index], buffer[wrap(index+1)], buffer[wrap(index+2)] };
+    return hermite.interpolate(x + 1, frac);
+  }
+
+  inline void write(int j, float x, float keep){
+    int i = wrap(j);
+    buffer[i] = buffer[i]*keep + dub*x;
+  }
+
+  void finishRecording(){
+    if(length < MIN_LENGTH){
+      length = 0;
+      state = StoppedState;
+    }
+    index = 0;
+    frac = 0;
+  }
+
+  void record(FloatArray input, FloatArray output){
+    int n = min(input.getSize(), maxLength - length);
+    input.subArray(0, n).copyTo(FloatArray(buffer + length, n));
+    length += n;
+    output.clear();
+    if(length == maxLength){
+      // the loop memory is full: play the loop from the next block
+      finishRecording();
+      state = PlayingState;
+    }
+  }
+
+public:
+  Looper(float* aBuffer, int aMaxLength)
+    : buffer(aBuffer), maxLength(aMaxLength), length(0), state(StoppedState),
+      index(0), frac(0), speed(1), feedback(1), level(0), dub(0), previous(0),
+      ownsMemory(false) {}
+
+  ~Looper(){
+    if(ownsMemory)
+      delete[] buffer;
+  }
+
+  LooperState getState(){
+    return state;
+  }
+
+  /** length of the loop in samples, 0 when there is no loop */
+  int getLength(){
+    return state == RecordingState ? 0 : length;
+  }
+
+  int getMaxLength(){
+    return maxLength;
+  }
+
+  /** the contents of the loop */
+  FloatArray getLoop(){
+    return FloatArray(buffer, getLength());
+  }
+
+  /** play position in samples from the start of the loop */
+  float getPosition(){
+    return index + frac;
+  }
+
+  void setPosition(float position){
+    if(length > 0){
+      position = fmodf(position, (float)length);
+      if(position < 0)
+	position += length;
+      index = min((int)position, length-1);
+      frac = position - index;
+    }
+  }
+
+  /** set the playback speed: 1 for normal, 0.5 for an octave down, negative for reverse */
+  void setSpeed(float value){
+    speed = max(-(float)MAX_SPEED, min((float)MAX_SPEED, value));
+  }
+
+  float getSpeed(){
+    return speed;
+  }
+
+  /** set how much of the loop is kept when overdubbing, from 0 to replace it to 1 to keep all of it */
+  void setFeedback(float value){
+    feedback = max(0.0f, min(1.0f, value));
+  }
+
+  /** start recording a new loop, replacing the current one */
+  void record(){
+    length = 0;
+    level = 0;
+    dub = 0;
+    state = RecordingState;
+  }
+
+  /** play the loop, ending a recording */
+  void play(){
+    if(state == RecordingState)
+      finishRecording();
+    if(length > 0)
+      state = PlayingState;
+  }
+
+  /** play the loop and add the input to it, ending a recording */
+  void overdub(){
+    if(state == RecordingState)
+      finishRecording();
+    if(length > 0)
+      state = OverdubbingState;
+  }
+
+  /** stop playing, keeping the loop */
+  void stop(){
+    if(state == RecordingState)
+      finishRecording();
+    state = StoppedState;
+  }
+
+  /** erase the loop */
+  void clear(){
+    length = 0;
+    level = 0;
+    dub = 0;
+    state = StoppedState;
+  }
+
+  /**
+   * Copy a channel of a sample into the loop memory and play it, so that it can be overdubbed.
+   * Samples longer than the loop memory are cut short.
+   */
+  void load(BankSample sample, int channel = 0){
+    int len = min(sample.getLength(), maxLength);
+    if(len < MIN_LENGTH)
+      return;
+    sample.read(channel, 0, FloatArray(buffer, len));
+    length = len;
+    index = 0;
+    frac = 0;
+    state = PlayingState;
+  }
+
+  /**
+   * Process a block of input, and write the loop to output without the input.
+   * The input and output arrays may be the same.
+   */
+  void process(FloatArray input, FloatArray output){
+    if(state == RecordingState){
+      record(input, output);
+      return;
+    }
+    int n = input.getSize();
+    float targetLevel = state == StoppedState ? 0 : 1;
+    float targetDub = state == OverdubbingState ? 1 : 0;
+    if(length == 0 || (level == 0 && targetLevel == 0)){
+      level = dub = 0;
+      output.clear();
+      return;
+    }
+    float dl = (targetLevel - level)/n;
+    float dd = (targetDub - dub)/n;
+    float rs = speed == 0 ? 0 : 1/speed;
+    int lag = speed < 0 ? -LAG : LAG;
+    for(int k=0; k<n; ++k){
+      float x = input[k];
+      level += dl;
+      dub += dd;
+      output[k] = interpolate()*level;
+      int i0 = index;
+      float f0 = frac;
+      frac += speed;
+      int steps = (int)frac;
+      if(frac < steps)
+	steps--;
+      index += steps;
+      frac -= steps;
+      if(dub > 0){
+	// write every sample that the play position passed, behind the play position
+	float keep = 1 - dub*(1 - feedback);
+	float dx = x - previous;
+	if(speed > 0){
+	  for(int j=i0+1; j<=index; ++j)
+	    write(j - lag, previous + dx*((j - i0) - f0)*rs, keep);
+	}else{
+	  int last = f0 > 0 ? i0 : i0-1;
+	  int first = frac > 0 ? index+1 : index;
+	  for(int j=last; j>=first; --j)
+	    write(j - lag, previous + dx*((j - i0) - f0)*rs, keep);
+	}
+      }
+      index = wrap(index);
+      previous = x;
+    }
+    // end exactly on the target, without rounding errors
+    level = targetLevel;
+    dub = targetDub;
+  }
+
+  /**
+   * Create a looper with loop memory allocated by the caller, for example in external RAM.
+   * @param size maximum loop length in samples
+   */
+  static Looper* create(float* buffer, int size){
+    return new Looper(buffer, size);
+  }
+
+  /**
+   * Create a looper with loop memory allocated on the heap.
+   * @param seconds maximum loop length
+   */
+  static Looper* create(float sampleRate, float seconds){
+    int size = (int)(sampleRate*seconds);
+    Looper* looper = new Looper(new float[size], size);
+    looper->ownsMemory = true;
+    return looper;
+  }
+
+  static void destroy(Looper* looper){
+    delete looper;
+  }
+};
+
+#endif /* __Looper_h__ */
@@ -4,30 +4,25 @@
 #include <stdint.h>
 #include "Oscillator.h"
 #include "basicmaths.h"
+#include "RandomGenerator.h"
 
 class WhiteNoiseOscillator : public Oscillator {
- public:
-  /* returns white noise in the range -0.5 to 0.5 */
+protected:
+  RandomGenerator generator;
+public:
+  /* each oscillator made without a seed gets a different one */
+  WhiteNoiseOscillator() {}
+  WhiteNoiseOscillator(uint32_t seed) : generator(seed) {}
+  /* returns white noise in the range -1 to 1 */
   virtual float getNextSample(){
-#if 0 // #ifdef ARM_CORTEX
-    // todo: fixme
-    union {
-      float f;
-      uint32_t i;
-    } x;
-    x.i = arm_rand32();
-    // brutally converting u32 to float by zeroing some
-    // exponent bits in IEEE single precision float
-    // x.i &= 0xbfffffff; // mask top exponent bit to get exponent values from 2^-1 to 2^-126 (-1 to 1)
-    x.i &= 0x9fffffff; // mask top two exponent bits to get exponent values from 2^-2 to 2^-126 (-0.5 to 0.5)
-    // mantissa holds a value from 1.0 to 1.999...
-    // https://en.wikipedia.org/wiki/Single-precision_floating-point_format
-    return x.f;
-#else
-    return (rand()/(RAND_MAX+1.0f)) * 2 - 1;
-#endif
+    return generator.getNextSample();
+  }
+  void getSamples(FloatArray output){
+    generator.fill(output);
+  }
+  void setSeed(uint32_t seed){
+    generator.setSeed(seed);
   }
-
   static WhiteNoiseOscillator* create(){
     return new WhiteNoiseOscillator();
   }
@@ -36,55 +31,41 @@ class WhiteNoiseOscillator : public Oscillator {
   }
 };
 
-#ifdef ARM_CORTEX
-#define CTZ(x) (__builtin_ctz(x))
-#else
-int inline CTZ(int num){
-  int i=0;
-  while (((num>>i)&1)==0 && i<sizeof(int)) i++;
-  return i;
-}
-#endif
-
+/**
+ * Oscillator that produces pink noise, with a -3dB per octave slope.
+ * White noise is filtered with Paul Kellet's economy filter: three one pole lowpass
+ * filters in parallel, within 0.5dB of the ideal slope above 10Hz. Block processing
+ * generates a block of white noise and filters it in place.
+ */
 class PinkNoiseOscillator : public WhiteNoiseOscillator {
 private:
-  enum {
-    NumPinkBins  = 16,
-    NumPinkBins1 = NumPinkBins-1
-  };
+  float b0, b1, b2;
 public:
-  PinkNoiseOscillator(){
-    m_count = 1;
-    m_pink  = 0;
-    for (int i=0; i<NumPinkBins; i++)
-    {
-      m_pinkStore[i] = 0.0f;
-    }
-  };
+  PinkNoiseOscillator() : b0(0), b1(0), b2(0) {}
+  PinkNoiseOscillator(uint32_t seed) : WhiteNoiseOscillator(seed), b0(0), b1(0), b2(0) {}
 
-  /* returns pink noise random number in the range -0.5 to 0.5 */
+  /* returns pink noise with an RMS level of about 0.2, within -1 to 1 */
   float getNextSample(){
-    float prevr;
-    float r;
-    unsigned long k = CTZ(m_count);
-    k = k & NumPinkBins1; 
-    // get previous value of this octave 
-    prevr = m_pinkStore[k]; 
-    while (true){
-      r = WhiteNoiseOscillator::getNextSample();
-      // store new value 
-      m_pinkStore[k] = r;
-      r -= prevr;
-      // update total 
-      m_pink += r; 
-      if (m_pink <-4.0f || m_pink > 4.0f) 
-	m_pink -= r;
-      else 
-	break;
+    float white = generator.getNextSample();
+    b0 = 0.99765f*b0 + white*0.0990460f;
+    b1 = 0.96300f*b1 + white*0.2965164f;
+    b2 = 0.57000f*b2 + white*1.0526913f;
+    return (b0 + b1 + b2 + white*0.1848f)*0.125f;
+  }
+  void getSamples(FloatArray output){
+    generator.fill(output);
+    float* out = output.getData();
+    float s0 = b0, s1 = b1, s2 = b2;
+    for(int i=0; i<output.getSize(); ++i){
+      float white = out[i];
+      s0 = 0.99765f*s0 + white*0.0990460f;
+      s1 = 0.96300f*s1 + white*0.2965164f;
+      s2 = 0.57000f*s2 + white*1.0526913f;
+      out[i] = (s0 + s1 + s2 + white*0.1848f)*0.125f;
     }
-    // update counter 
-    m_count++; 
-    return (WhiteNoiseOscillator::getNextSample() + m_pink)*0.125f; 
+    b0 = s0;
+    b1 = s1;
+    b2 = s2;
   }
   static PinkNoiseOscillator* create(){
     return new PinkNoiseOscillator();
@@ -92,10 +73,6 @@ public:
   static void destroy(PinkNoiseOscillator* osc){
     delete osc;
   }
-private:
-  unsigned long  m_count;
-  float          m_pink;
-  float          m_pinkStore[NumPinkBins];
 };
 
 /**
@@ -122,6 +99,10 @@ public:
     }
     return m_brown*0.0625f;
   }  
+  void getSamples(FloatArray output){
+    for(int i=0; i<output.getSize(); ++i)
+      output[i] = getNextSample();
+  }
   static BrownNoiseOscillator* create(){
     return new BrownNoiseOscillator();
   }
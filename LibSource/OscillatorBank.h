@@ -0,0 +1,190 @@
+#ifndef __OscillatorBank_h__
+#define __OscillatorBank_h__
+
+#include "FloatArray.h"
+#include "basicmaths.h"
+
+/**
+ * A bank of sine oscillators, for additive synthesis and FM.
+ * All partials are rendered and summed into one block of output, with the state of
+ * the partials stored as arrays (one value per partial) rather than as separate objects.
+ * Each partial is a quadrature oscillator: a unit complex number that is rotated by
+ * the phase increment of the partial every sample, which takes four multiplications
+ * and no calls to sinf(). The imaginary part gives the sine output, the real part
+ * the cosine (quadrature) output.
+ * Frequency and amplitude changes are ramped linearly over the next rendered block.
+ * Partials above the Nyquist frequency are faded out.
+ */
+class OscillatorBank {
+private:
+  int partials;
+  float multiplier;
+  FloatArray re; // oscillator state, the cosine of the phase
+  FloatArray im; // oscillator state, the sine of the phase
+  FloatArray increment; // phase increment in radians per sample
+  FloatArray targetIncrement;
+  FloatArray amplitude;
+  FloatArray targetAmplitude;
+
+  template<bool quadrature>
+  void render(int partial, float* out, float* quad, int size){
+    float x = re[partial];
+    float y = im[partial];
+    float a = amplitude[partial];
+    float w = targetIncrement[partial];
+    float a1 = w < M_PI ? targetAmplitude[partial] : 0;
+    float da = (a1 - a)/size;
+    if(a == 0)
+      increment[partial] = w; // no need to ramp the frequency of a silent partial
+    // rotation per sample
+    float c = cosf(increment[partial]);
+    float s = sinf(increment[partial]);
+    if(increment[partial] == w){
+      for(int n=0; n<size; ++n){
+	out[n] += a*y;
+	if(quadrature)
+	  quad[n] += a*x;
+	float t = x*c - y*s;
+	y = x*s + y*c;
+	x = t;
+	a += da;
+      }
+    }else{
+      // the rotation is itself rotated every sample, to ramp the frequency
+      float dw = (w - increment[partial])/size;
+      float dc = cosf(dw);
+      float ds = sinf(dw);
+      for(int n=0; n<size; ++n){
+	out[n] += a*y;
+	if(quadrature)
+	  quad[n] += a*x;
+	float t = x*c - y*s;
+	y = x*s + y*c;
+	x = t;
+	t = c*dc - s*ds;
+	s = c*ds + s*dc;
+	c = t;
+	a += da;
+      }
+      increment[partial] = w;
+    }
+    // correct the rounding errors that accumulate in the magnitude of the state
+    float g = 1.5f - 0.5f*(x*x + y*y);
+    re[partial] = x*g;
+    im[partial] = y*g;
+    amplitude[partial] = a1;
+  }
+
+  template<bool quadrature>
+  void render(FloatArray output, float* quad){
+    output.clear();
+    for(int i=0; i<partials; ++i){
+      if(amplitude[i] != 0 || targetAmplitude[i] != 0)
+	render<quadrature>(i, output.getData(), quad, output.getSize());
+      else
+	increment[i] = targetIncrement[i];
+    }
+  }
+
+public:
+  OscillatorBank(float sr, int numberOfPartials) : partials(numberOfPartials){
+    re = FloatArray::create(partials);
+    im = FloatArray::create(partials);
+    increment = FloatArray::create(partials);
+    targetIncrement = FloatArray::create(partials);
+    amplitude = FloatArray::create(partials);
+    targetAmplitude = FloatArray::create(partials);
+    increment.clear();
+    targetIncrement.clear();
+    amplitude.clear();
+    targetAmplitude.clear();
+    setSampleRate(sr);
+    reset();
+  }
+
+  ~OscillatorBank(){
+    FloatArray::destroy(re);
+    FloatArray::destroy(im);
+    FloatArray::destroy(increment);
+    FloatArray::destroy(targetIncrement);
+    FloatArray::destroy(amplitude);
+    FloatArray::destroy(targetAmplitude);
+  }
+
+  void setSampleRate(float sr){
+    multiplier = 2*M_PI/sr;
+  }
+
+  int getNumberOfPartials(){
+    return partials;
+  }
+
+  /** set the frequency in Hz of a partial, ramped over the next block */
+  void setFrequency(int partial, float freq){
+    targetIncrement[partial] = freq*multiplier;
+  }
+
+  float getFrequency(int partial){
+    return targetIncrement[partial]/multiplier;
+  }
+
+  /** set the amplitude of a partial, ramped over the next block */
+  void setAmplitude(int partial, float amp){
+    targetAmplitude[partial] = amp;
+  }
+
+  float getAmplitude(int partial){
+    return targetAmplitude[partial];
+  }
+
+  /** set the phase of a partial, in radians */
+  void setPhase(int partial, float phase){
+    re[partial] = cosf(phase);
+    im[partial] = sinf(phase);
+  }
+
+  /** set the frequencies of all partials to the harmonics of @param fundamental */
+  void setHarmonics(float fundamental){
+    for(int i=0; i<partials; ++i)
+      setFrequency(i, fundamental*(i+1));
+  }
+
+  /** set the frequency and amplitude of all partials at once, without ramping */
+  void setPartials(FloatArray frequencies, FloatArray amplitudes){
+    for(int i=0; i<partials; ++i){
+      setFrequency(i, frequencies[i]);
+      increment[i] = targetIncrement[i];
+      amplitude[i] = targetAmplitude[i] = amplitudes[i];
+    }
+  }
+
+  /** reset the phase of all partials to zero */
+  void reset(){
+    re.setAll(1);
+    im.clear();
+  }
+
+  /** render the sum of all partials into @param output */
+  void getSamples(FloatArray output){
+    render<false>(output, NULL);
+  }
+
+  /**
+   * render the sum of all partials into @param output,
+   * and the sum of their cosines into @param quadrature
+   */
+  void getSamples(FloatArray output, FloatArray quadrature){
+    quadrature.clear();
+    render<true>(output, quadrature.getData());
+  }
+
+  static OscillatorBank* create(float sr, int numberOfPartials){
+    return new OscillatorBank(sr, numberOfPartials);
+  }
+
+  static void destroy(OscillatorBank* bank){
+    delete bank;
+  }
+};
+
+#endif /* __OscillatorBank_h__ */
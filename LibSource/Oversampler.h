@@ -0,0 +1,378 @@
+#ifndef __Oversampler_h__
+#define __Oversampler_h__
+
+#include "FloatArray.h"
+#include "Patch.h"
+
+/*
+ * Half-band coefficients for polyphase allpass IIR filters, designed with the
+ * elliptic method described in "Digital Signal Processing Schemes for Efficient
+ * Interpolation and Decimation" by Valenzuela and Constantinides (as used in HIIR).
+ * Each stage of a chain only has to reject the images of the content that is
+ * left by the previous stage, so higher rate stages have a wider transition band
+ * and need fewer coefficients.
+ * Transition bandwidth is given relative to the higher sampling rate.
+ */
+// low quality: 70dB (60dB for the third stage)
+static const float HALFBAND_LOW_1[] = { // transition 0.1
+  0.079866426f, 0.283829345f, 0.545323651f, 0.834411891f
+};
+static const float HALFBAND_LOW_2[] = { // transition 0.3
+  0.124744526f, 0.562584953f
+};
+static const float HALFBAND_LOW_3[] = { // transition 0.4
+  0.341748648f
+};
+static const float HALFBAND_LOW_4[] = { // transition 0.45
+  0.335401198f
+};
+// medium quality: 100dB
+static const float HALFBAND_MEDIUM_1[] = { // transition 0.1
+  0.039151598f, 0.147377114f, 0.302646848f, 0.482468543f, 0.674615919f, 0.883005026f
+};
+static const float HALFBAND_MEDIUM_2[] = { // transition 0.3
+  0.062735753f, 0.263732334f, 0.665815091f
+};
+static const float HALFBAND_MEDIUM_3[] = { // transition 0.4
+  0.109918963f, 0.536060906f
+};
+static const float HALFBAND_MEDIUM_4[] = { // transition 0.45
+  0.106634541f, 0.529885501f
+};
+// high quality: 120dB, wider passband
+static const float HALFBAND_HIGH_1[] = { // transition 0.06
+  0.025845364f, 0.098613616f, 0.205929153f, 0.332389733f, 0.464261752f,
+  0.592394751f, 0.713040450f, 0.827380470f, 0.940819391f
+};
+static const float HALFBAND_HIGH_2[] = { // transition 0.28
+  0.039404966f, 0.160690898f, 0.378083147f, 0.735565023f
+};
+static const float HALFBAND_HIGH_3[] = { // transition 0.39
+  0.055012235f, 0.240825034f, 0.644579099f
+};
+static const float HALFBAND_HIGH_4[] = { // transition 0.445
+  0.106859562f, 0.530312323f
+};
+
+/**
+ * Polyphase half-band IIR filter.
+ * Implemented as two parallel chains of first order allpass sections,
+ * both running at the lower sampling rate: coefficients with an even index
+ * go in the first chain, those with an odd index in the second.
+ * Each sample at the low rate produces, or consumes, two samples at the high rate.
+ */
+class HalfBandFilter {
+private:
+  const float* coefficients;
+  float* x; // allpass input states
+  float* y; // allpass output states
+  int order;
+  inline void process(float& a, float& b){
+    int i = 0;
+    for(; i<order-1; i+=2){
+      float ta = (a - y[i])*coefficients[i] + x[i];
+      float tb = (b - y[i+1])*coefficients[i+1] + x[i+1];
+      x[i] = a;
+      x[i+1] = b;
+      y[i] = ta;
+      y[i+1] = tb;
+      a = ta;
+      b = tb;
+    }
+    if(i < order){
+      float ta = (a - y[i])*coefficients[i] + x[i];
+      x[i] = a;
+      y[i] = ta;
+      a = ta;
+    }
+  }
+public:
+  HalfBandFilter() : coefficients(NULL), x(NULL), y(NULL), order(0) {}
+
+  /**
+   * @param coefs the allpass coefficients
+   * @param n number of coefficients
+   * @param state array of at least 2*n values, used to store the filter state
+   */
+  HalfBandFilter(const float* coefs, int n, float* state)
+    : coefficients(coefs), x(state), y(state+n), order(n) {
+    reset();
+  }
+
+  void reset(){
+    for(int i=0; i<order; ++i)
+      x[i] = y[i] = 0.0f;
+  }
+
+  int getOrder(){
+    return order;
+  }
+
+  /**
+   * Interpolate by a factor of two.
+   * @param input array of **size** samples
+   * @param output array of 2 x **size** samples
+   */
+  void upsample(const float* input, float* output, int size){
+    while(size--){
+      float a = *input;
+      float b = *input++;
+      process(a, b);
+      *output++ = a;
+      *output++ = b;
+    }
+  }
+
+  /**
+   * Decimate by a factor of two.
+   * @param input array of 2 x **size** samples, left intact
+   * @param output array of **size** samples
+   */
+  void downsample(const float* input, float* output, int size){
+    while(size--){
+      float b = *input++;
+      float a = *input++;
+      process(a, b);
+      *output++ = 0.5f*(a + b);
+    }
+  }
+
+  /**
+   * Get the group delay at DC, in samples at the high sampling rate.
+   */
+  float getDelay(){
+    float delay = 0.0f;
+    for(int i=0; i<order; i+=2)
+      delay += 2*(1-coefficients[i])/(1+coefficients[i]);
+    return delay;
+  }
+
+  /**
+   * Get the number of state variables required for a filter with @param order coefficients
+   */
+  static int getStateSize(int order){
+    return 2*order;
+  }
+};
+
+/**
+ * Oversampling by factors of 2, 4, 8 or 16, with a cascade of polyphase
+ * half-band IIR filters.
+ * Each 2x stage runs at the lower of its two sampling rates, so the cost
+ * of the whole chain is a fraction of one filter running at the full rate.
+ * Inputs are never modified.
+ * Usage: upsample() a block, process it at the higher rate, then downsample() the result.
+ */
+class Oversampler {
+public:
+  enum Quality {
+    LOW_QUALITY,    // 70dB image rejection
+    MEDIUM_QUALITY, // 100dB image rejection
+    HIGH_QUALITY    // 120dB image rejection, passband up to 0.44 x the base sampling rate
+  };
+  static const int MAX_STAGES = 4;
+private:
+  HalfBandFilter* upfilters; // stages*channels
+  HalfBandFilter* downfilters; // stages*channels
+  float* state;
+  FloatArray scratch1; // blocksize*factor/2
+  FloatArray scratch2; // blocksize*factor/4
+  int factor;
+  int stages;
+  int channels;
+  int blocksize;
+  Quality quality;
+
+  static void getCoefficients(Quality q, int stage, const float** coefs, int* order){
+    switch(q){
+    case LOW_QUALITY:
+      switch(stage){
+      case 0: *coefs = HALFBAND_LOW_1; *order = sizeof(HALFBAND_LOW_1)/sizeof(float); break;
+      case 1: *coefs = HALFBAND_LOW_2; *order = sizeof(HALFBAND_LOW_2)/sizeof(float); break;
+      case 2: *coefs = HALFBAND_LOW_3; *order = sizeof(HALFBAND_LOW_3)/sizeof(float); break;
+      default: *coefs = HALFBAND_LOW_4; *order = sizeof(HALFBAND_LOW_4)/sizeof(float); break;
+      }
+      break;
+    case MEDIUM_QUALITY:
+      switch(stage){
+      case 0: *coefs = HALFBAND_MEDIUM_1; *order = sizeof(HALFBAND_MEDIUM_1)/sizeof(float); break;
+      case 1: *coefs = HALFBAND_MEDIUM_2; *order = sizeof(HALFBAND_MEDIUM_2)/sizeof(float); break;
+      case 2: *coefs = HALFBAND_MEDIUM_3; *order = sizeof(HALFBAND_MEDIUM_3)/sizeof(float); break;
+      default: *coefs = HALFBAND_MEDIUM_4; *order = sizeof(HALFBAND_MEDIUM_4)/sizeof(float); break;
+      }
+      break;
+    case HIGH_QUALITY:
+    default:
+      switch(stage){
+      case 0: *coefs = HALFBAND_HIGH_1; *order = sizeof(HALFBAND_HIGH_1)/sizeof(float); break;
+      case 1: *coefs = HALFBAND_HIGH_2; *order = sizeof(HALFBAND_HIGH_2)/sizeof(float); break;
+      case 2: *coefs = HALFBAND_HIGH_3; *order = sizeof(HALFBAND_HIGH_3)/sizeof(float); break;
+      default: *coefs = HALFBAND_HIGH_4; *order = sizeof(HALFBAND_HIGH_4)/sizeof(float); break;
+      }
+      break;
+    }
+  }
+
+  static int getStateSize(Quality q, int stages){
+    int size = 0;
+    for(int i=0; i<stages; ++i){
+      const float* coefs;
+      int order;
+      getCoefficients(q, i, &coefs, &order);
+      size += HalfBandFilter::getStateSize(order);
+    }
+    return size;
+  }
+
+public:
+  /**
+   * @param aFactor oversampling factor: 2, 4, 8 or 16
+   * @param q filter quality preset
+   * @param aBlockSize maximum number of samples per block, at the base sampling rate
+   * @param aChannels number of channels
+   * @param st array of 2*getStateSize(q, log2(factor))*channels floats
+   * @param s1 scratch array of blocksize*factor/2 floats
+   * @param s2 scratch array of blocksize*factor/4 floats (may be empty for factors below 4)
+   * @param up array of log2(factor)*channels filters
+   * @param down array of log2(factor)*channels filters
+   */
+  Oversampler(int aFactor, Quality q, int aBlockSize, int aChannels, float* st,
+	      FloatArray s1, FloatArray s2, HalfBandFilter* up, HalfBandFilter* down)
+    : upfilters(up), downfilters(down), state(st), scratch1(s1), scratch2(s2),
+      factor(aFactor), stages(log2i(aFactor)), channels(aChannels),
+      blocksize(aBlockSize), quality(q) {
+    ASSERT(factor == 2 || factor == 4 || factor == 8 || factor == 16, "Unsupported oversampling factor");
+    float* ptr = state;
+    for(int ch=0; ch<channels; ++ch){
+      for(int i=0; i<stages; ++i){
+	const float* coefs;
+	int order;
+	getCoefficients(quality, i, &coefs, &order);
+	upfilters[ch*stages+i] = HalfBandFilter(coefs, order, ptr);
+	ptr += HalfBandFilter::getStateSize(order);
+	downfilters[ch*stages+i] = HalfBandFilter(coefs, order, ptr);
+	ptr += HalfBandFilter::getStateSize(order);
+      }
+    }
+  }
+
+  int getFactor(){
+    return factor;
+  }
+
+  int getChannels(){
+    return channels;
+  }
+
+  Quality getQuality(){
+    return quality;
+  }
+
+  /**
+   * Get the latency of an upsample() / downsample() round trip,
+   * measured as the group delay at DC in samples at the base sampling rate.
+   * IIR half-band filters are not linear phase: the delay increases towards
+   * the edge of the passband.
+   */
+  float getLatency(){
+    float delay = 0.0f;
+    // the decimator reads odd samples into the first allpass chain, which saves one sample at the high rate
+    for(int i=0; i<stages; ++i)
+      delay += (2*upfilters[i].getDelay() - 1)/(2<<i);
+    return delay;
+  }
+
+  void reset(){
+    for(int i=0; i<stages*channels; ++i){
+      upfilters[i].reset();
+      downfilters[i].reset();
+    }
+  }
+
+  /**
+   * Interpolate a block of samples.
+   * @param input array of N samples at the base sampling rate
+   * @param output array of N x factor samples
+   * @param channel channel index, selects the filter state
+   */
+  void upsample(FloatArray input, FloatArray output, int channel=0){
+    int size = input.getSize();
+    ASSERT(size <= blocksize, "Block too large");
+    ASSERT(output.getSize() >= size*factor, "Output array too small");
+    ASSERT(channel < channels, "Invalid channel");
+    HalfBandFilter* filters = upfilters+channel*stages;
+    // alternate between the scratch buffer and the output, so that the last stage writes to output
+    const float* src = input;
+    for(int i=0; i<stages; ++i){
+      float* dst = ((stages-1-i) & 1) ? (float*)scratch1 : (float*)output;
+      filters[i].upsample(src, dst, size);
+      src = dst;
+      size *= 2;
+    }
+  }
+
+  /**
+   * Decimate a block of samples.
+   * @param input array of N x factor samples, left intact
+   * @param output array of N samples at the base sampling rate
+   * @param channel channel index, selects the filter state
+   */
+  void downsample(FloatArray input, FloatArray output, int channel=0){
+    int size = output.getSize();
+    ASSERT(size <= blocksize, "Block too large");
+    ASSERT(input.getSize() >= size*factor, "Input array too small");
+    ASSERT(channel < channels, "Invalid channel");
+    HalfBandFilter* filters = downfilters+channel*stages;
+    const float* src = input;
+    size *= factor;
+    for(int i=stages-1; i>=0; --i){
+      size /= 2;
+      float* dst = i == 0 ? (float*)output : (((stages-1-i) & 1) ? (float*)scratch2 : (float*)scratch1);
+      filters[i].downsample(src, dst, size);
+      src = dst;
+    }
+  }
+
+  /**
+   * Interpolate all channels.
+   * @param output buffer with factor times as many samples as @param input
+   */
+  void upsample(AudioBuffer& input, AudioBuffer& output){
+    int chs = min(channels, min(input.getChannels(), output.getChannels()));
+    for(int ch=0; ch<chs; ++ch)
+      upsample(input.getSamples(ch), output.getSamples(ch), ch);
+  }
+
+  /**
+   * Decimate all channels.
+   * @param input buffer with factor times as many samples as @param output
+   */
+  void downsample(AudioBuffer& input, AudioBuffer& output){
+    int chs = min(channels, min(input.getChannels(), output.getChannels()));
+    for(int ch=0; ch<chs; ++ch)
+      downsample(input.getSamples(ch), output.getSamples(ch), ch);
+  }
+
+  static Oversampler* create(int factor, Quality q, int blocksize, int channels=1){
+    int stages = log2i(factor);
+    int statesize = 2*getStateSize(q, stages)*channels;
+    FloatArray s2;
+    if(factor >= 4)
+      s2 = FloatArray::create(blocksize*factor/4);
+    return new Oversampler(factor, q, blocksize, channels, new float[statesize],
+			   FloatArray::create(blocksize*factor/2), s2,
+			   new HalfBandFilter[stages*channels],
+			   new HalfBandFilter[stages*channels]);
+  }
+
+  static void destroy(Oversampler* obj){
+    FloatArray::destroy(obj->scratch1);
+    FloatArray::destroy(obj->scratch2);
+    delete[] obj->state;
+    delete[] obj->upfilters;
+    delete[] obj->downfilters;
+    delete obj;
+  }
+};
+
+#endif /* __Oversampler_h__ */
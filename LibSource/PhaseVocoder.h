@@ -0,0 +1,213 @@
+#ifndef __PhaseVocoder_h__
+#define __PhaseVocoder_h__
+
+#include "ShortTimeFourierTransform.h"
+
+/**
+ * Phase vocoder for real-time pitch shifting and spectral freeze.
+ * Pitch is shifted in the frequency domain: each spectral peak, together with the bins
+ * in its region of influence, is moved to the bin nearest to its shifted frequency.
+ * Synthesis phases follow the shifted instantaneous frequency of each peak, and the bins
+ * around a peak keep their phase relative to the peak (identity phase locking), which
+ * avoids the phasiness of a plain phase vocoder.
+ * Transients are detected from the spectral flux: frames with a sharp rise in energy
+ * reset the synthesis phases to the analysis phases, keeping attacks sharp.
+ * When frozen, the last analysed frame is resynthesised indefinitely, with phases
+ * advancing at the measured frequencies: an infinite time stretch.
+ *
+ * Processing is divided into three steps per frame (polar analysis, phase propagation,
+ * polar to cartesian conversion) so that the load is spread over the audio blocks of a hop.
+ * Use a hop size of a quarter of the frame size or less.
+ * A 2048 point frame needs about 75kB of memory.
+ * All per bin arithmetic is in single precision, for the FPU of the Cortex-M4.
+ */
+class PhaseVocoder : public ShortTimeFourierTransform {
+protected:
+  int bins;
+  FloatArray magnitude; // scratch, in the STFT frame
+  FloatArray phase; // scratch, in the STFT frame
+  FloatArray lastMagnitude;
+  FloatArray lastPhase;
+  FloatArray frequency; // instantaneous frequency in radians per sample
+  FloatArray advance; // expected phase advance of each bin over a hop
+  FloatArray synthesisPhase;
+  uint16_t* peaks;
+  float shift;
+  float threshold;
+  bool freeze;
+  bool transient;
+
+  static float wrap(float x){
+    return x - (float)(2*M_PI)*floorf((x + (float)M_PI)*(float)(1/(2*M_PI)));
+  }
+
+  void analyse(){
+    spectrum.getMagnitudeValues(magnitude);
+    spectrum.getPhaseValues(phase);
+    // the first bin holds the real valued DC and Nyquist bins
+    magnitude[0] = fabsf(spectrum[0].re);
+    phase[0] = spectrum[0].re < 0 ? (float)M_PI : 0.0f;
+    if(freeze){
+      magnitude.copyFrom(lastMagnitude);
+      phase.copyFrom(lastPhase);
+      transient = false;
+      return;
+    }
+    float rise = 0;
+    float total = 0;
+    for(int k=0; k<bins; ++k){
+      rise += max(magnitude[k] - lastMagnitude[k], 0.0f);
+      total += magnitude[k];
+    }
+    transient = rise > threshold*total;
+    float scale = 1.0f/hopSize;
+    for(int k=0; k<bins; ++k){
+      float deviation = wrap(phase[k] - lastPhase[k] - advance[k]);
+      frequency[k] = (advance[k] + deviation)*scale;
+    }
+    lastMagnitude.copyFrom(magnitude);
+    lastPhase.copyFrom(phase);
+  }
+
+  void propagate(){
+    // find spectral peaks
+    int count = 0;
+    for(int k=1; k<bins-1; ++k){
+      if(magnitude[k] > magnitude[k-1] && magnitude[k] >= magnitude[k+1])
+	peaks[count++] = k;
+    }
+    // shifted magnitudes and phases are stored in polar form until the last step
+    spectrum.clear();
+    spectrum[0].re = magnitude[0];
+    spectrum[0].im = phase[0];
+    int lo = 1;
+    for(int p=0; p<count; ++p){
+      int peak = peaks[p];
+      int hi = p+1 < count ? (peak + peaks[p+1] + 1)/2 : bins;
+      int offset = (int)(peak*shift + 0.5f) - peak;
+      float peakPhase;
+      if(transient)
+	peakPhase = phase[peak];
+      else
+	peakPhase = wrap(synthesisPhase[peak] + hopSize*frequency[peak]*shift);
+      for(int i=lo; i<hi; ++i){
+	// phase locked to the peak
+	synthesisPhase[i] = wrap(peakPhase + phase[i] - phase[peak]);
+	int j = i + offset;
+	if(j > 0 && j < bins){
+	  if(magnitude[i] > spectrum[j].re)
+	    spectrum[j].im = synthesisPhase[i];
+	  spectrum[j].re += magnitude[i];
+	}
+      }
+      lo = hi;
+    }
+  }
+
+  void synthesise(){
+    spectrum.getRealValues(magnitude);
+    spectrum.getImaginaryValues(phase);
+    spectrum.setPolar(magnitude, phase);
+  }
+
+public:
+  /**
+   * @param aFrameSize FFT size, see FastFourierTransform::isSupportedSize()
+   * @param aHopSize number of samples between frames, at most a quarter of the frame size
+   */
+  PhaseVocoder(int aFrameSize, int aHopSize)
+    : ShortTimeFourierTransform(aFrameSize, aHopSize, Window::HannWindow),
+      bins(aFrameSize/2), shift(1.0f), threshold(0.5f), freeze(false), transient(false) {
+    steps = 3;
+    magnitude = frame.subArray(0, bins);
+    phase = frame.subArray(bins, bins);
+    lastMagnitude = FloatArray::create(bins);
+    lastPhase = FloatArray::create(bins);
+    frequency = FloatArray::create(bins);
+    advance = FloatArray::create(bins);
+    for(int k=0; k<bins; ++k)
+      advance[k] = 2*M_PI*k*hopSize/frameSize;
+    synthesisPhase = FloatArray::create(bins);
+    peaks = new uint16_t[bins/2];
+    reset();
+  }
+
+  ~PhaseVocoder(){
+    FloatArray::destroy(lastMagnitude);
+    FloatArray::destroy(lastPhase);
+    FloatArray::destroy(frequency);
+    FloatArray::destroy(advance);
+    FloatArray::destroy(synthesisPhase);
+    delete[] peaks;
+  }
+
+  void reset(){
+    ShortTimeFourierTransform::reset();
+    lastMagnitude.clear();
+    lastPhase.clear();
+    frequency.clear();
+    synthesisPhase.clear();
+  }
+
+  /**
+   * Set the pitch shift ratio, e.g. 2 for one octave up, 0.5 for one octave down.
+   */
+  void setPitchShift(float ratio){
+    shift = ratio;
+  }
+
+  float getPitchShift(){
+    return shift;
+  }
+
+  /**
+   * Hold the current spectrum: while frozen, the input is ignored.
+   */
+  void setFreeze(bool value){
+    freeze = value;
+  }
+
+  bool getFreeze(){
+    return freeze;
+  }
+
+  /**
+   * Set the transient detection threshold: the increase in magnitude since the previous frame,
+   * relative to the total magnitude of the frame, from 0 to 1. Higher values detect fewer transients.
+   * Defaults to 0.5
+   */
+  void setTransientThreshold(float value){
+    threshold = value;
+  }
+
+  /**
+   * @return true if the last frame that was analysed is a transient
+   */
+  bool isTransient(){
+    return transient;
+  }
+
+  void processStep(ComplexFloatArray frameSpectrum, int step){
+    switch(step){
+    case 0:
+      analyse();
+      break;
+    case 1:
+      propagate();
+      break;
+    case 2:
+      synthesise();
+      break;
+    }
+  }
+
+  static PhaseVocoder* create(int frameSize, int hopSize){
+    return new PhaseVocoder(frameSize, hopSize);
+  }
+
+  static void destroy(PhaseVocoder* obj){
+    delete obj;
+  }
+};
+
+#endif /* __PhaseVocoder_h__ */
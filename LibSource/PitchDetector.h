@@ -6,6 +6,8 @@
 #include "FastFourierTransform.h"
 #include "BiquadFilter.h"
 #include "Window.h"
+#include "CircularBuffer.h"
+#include "Oversampler.h"
 
 class FourierPitchDetector{
 private:
@@ -110,6 +112,230 @@ public:
   }
 };
 
+/**
+ * Pitch detector based on the McLeod Pitch Method.
+ * The normalised square difference function (NSDF) of a window of input is computed from
+ * its autocorrelation, obtained with a zero padded FFT. The period is the first key
+ * maximum of the NSDF that is close to the highest one, refined with parabolic
+ * interpolation. The height of that maximum, the clarity, is reported as confidence:
+ * close to 1 for a periodic signal, low for noise.
+ *
+ * The lowest detectable frequency is sampleRate/(decimation*windowSize/2). For low notes,
+ * the input can be decimated before analysis: with a 1024 sample window at 48kHz, a
+ * decimation of 4 extends the range down to 23Hz for the same cost.
+ * A new estimate is made every windowSize/2 decimated samples, and the work for each
+ * estimate is spread over the audio blocks in between.
+ */
+class McLeodPitchDetector {
+private:
+  FastFourierTransform fft;
+  Oversampler* decimator;
+  CircularFloatBuffer* history;
+  FloatArray decimated;
+  FloatArray samples; // the analysed window
+  FloatArray frame; // zero padded window, then autocorrelation, then NSDF
+  ComplexFloatArray spectrum;
+  float sampleRate;
+  int decimation;
+  int windowSize;
+  int hopSize;
+  int position;
+  int stage;
+  bool pending;
+  int minPeriod;
+  int maxPeriod;
+  float threshold;
+  float frequency;
+  float confidence;
+  static const int STAGES = 3;
+
+  void runStage(int s){
+    switch(s){
+    case 0:
+      history->read(samples, 0);
+      frame.clear();
+      samples.copyTo(frame.subArray(0, windowSize));
+      fft.fft(frame, spectrum);
+      break;
+    case 1: {
+      // power spectrum, the first bin holds DC and Nyquist
+      float dc = spectrum[0].re;
+      float nyquist = spectrum[0].im;
+      FloatArray power = frame.subArray(0, windowSize);
+      spectrum.getMagnitudeSquaredValues(power);
+      spectrum.setAll(0.0f);
+      for(int k=1; k<windowSize; ++k)
+	spectrum[k].re = power[k];
+      spectrum[0].re = dc*dc;
+      spectrum[0].im = nyquist*nyquist;
+      fft.ifft(spectrum, frame);
+      break;
+    }
+    case 2:
+      estimate();
+      break;
+    }
+  }
+
+  void estimate(){
+    // normalised square difference function, in place of the autocorrelation
+    int last = min(maxPeriod+1, windowSize/2);
+    float m = 2*frame[0];
+    for(int tau=0; tau<=last; ++tau){
+      if(tau > 0)
+	m -= samples[tau-1]*samples[tau-1] + samples[windowSize-tau]*samples[windowSize-tau];
+      frame[tau] = m > 0 ? 2*frame[tau]/m : 0;
+    }
+    // find the highest key maximum, between positive going and negative going zero crossings
+    float highest = 0;
+    int tau = 1;
+    while(tau < last && frame[tau] > 0)
+      tau++; // skip the lobe around zero lag
+    for(int t=max(tau, minPeriod); t<last; ++t){
+      if(frame[t] > frame[t-1] && frame[t] >= frame[t+1])
+	highest = max(highest, frame[t]);
+    }
+    // pick the first key maximum above the threshold
+    float limit = threshold*highest;
+    for(int t=max(tau, minPeriod); t<last; ++t){
+      if(frame[t] > 0 && frame[t] >= limit && frame[t] > frame[t-1] && frame[t] >= frame[t+1]){
+	float a = frame[t-1], b = frame[t], c = frame[t+1];
+	float d = a - 2*b + c;
+	float p = d == 0 ? 0 : 0.5f*(a - c)/d;
+	float period = t + p;
+	frequency = sampleRate/(decimation*period);
+	confidence = min(b - 0.25f*(a - c)*p, 1.0f);
+	return;
+      }
+    }
+    confidence = 0;
+  }
+
+  void schedule(int until){
+    while(pending && stage < STAGES && stage*hopSize/STAGES < until)
+      runStage(stage++);
+  }
+
+public:
+  /**
+   * @param sr sampling rate
+   * @param blocksize number of samples passed to process(), a multiple of the decimation
+   * @param aWindowSize number of samples analysed, after decimation
+   * @param aDecimation 1 for no decimation, or 2, 4, 8, 16
+   */
+  McLeodPitchDetector(float sr, int blocksize, int aWindowSize=1024, int aDecimation=1)
+    : decimator(NULL), sampleRate(sr), decimation(aDecimation), windowSize(aWindowSize),
+      hopSize(aWindowSize/2), threshold(0.9f), frequency(0), confidence(0) {
+    ASSERT(blocksize % decimation == 0, "Block size must be a multiple of the decimation");
+    fft.init(windowSize*2);
+    if(decimation > 1){
+      decimator = Oversampler::create(decimation, Oversampler::MEDIUM_QUALITY, blocksize/decimation);
+      decimated = FloatArray::create(blocksize/decimation);
+    }
+    history = CircularFloatBuffer::create(windowSize);
+    samples = FloatArray::create(windowSize);
+    frame = FloatArray::create(windowSize*2);
+    spectrum = ComplexFloatArray::create(windowSize);
+    setMinFrequency(sampleRate/(decimation*windowSize/2));
+    setMaxFrequency(sampleRate/(decimation*4));
+    reset();
+  }
+
+  ~McLeodPitchDetector(){
+    if(decimator != NULL){
+      Oversampler::destroy(decimator);
+      FloatArray::destroy(decimated);
+    }
+    CircularFloatBuffer::destroy(history);
+    FloatArray::destroy(samples);
+    FloatArray::destroy(frame);
+    ComplexFloatArray::destroy(spectrum);
+  }
+
+  void reset(){
+    history->clear();
+    history->reset();
+    position = 0;
+    stage = 0;
+    pending = false;
+    frequency = 0;
+    confidence = 0;
+  }
+
+  /**
+   * Set the lowest frequency to detect, in Hz.
+   * Limited by the window size and decimation.
+   */
+  void setMinFrequency(float freq){
+    maxPeriod = min((int)(sampleRate/(decimation*freq)) + 1, windowSize/2 - 1);
+  }
+
+  /**
+   * Set the highest frequency to detect, in Hz.
+   */
+  void setMaxFrequency(float freq){
+    minPeriod = max((int)(sampleRate/(decimation*freq)), 2);
+  }
+
+  /**
+   * Set the relative height of the NSDF maximum, compared to the highest maximum, at which
+   * a period is accepted. Lower values favour longer periods. Defaults to 0.9
+   */
+  void setThreshold(float value){
+    threshold = value;
+  }
+
+  /**
+   * Analyse a block of input.
+   */
+  void process(FloatArray input){
+    FloatArray in = input;
+    if(decimator != NULL){
+      FloatArray out = decimated.subArray(0, input.getSize()/decimation);
+      decimator->downsample(input, out);
+      in = out;
+    }
+    int size = in.getSize();
+    int pos = 0;
+    while(pos < size){
+      int len = min(size-pos, hopSize-position);
+      history->write(in.subArray(pos, len));
+      schedule(position+len);
+      position += len;
+      pos += len;
+      if(position == hopSize){
+	schedule(hopSize);
+	pending = true;
+	stage = 0;
+	position = 0;
+      }
+    }
+  }
+
+  /**
+   * Get the last detected frequency, in Hz.
+   */
+  float getFrequency(){
+    return frequency;
+  }
+
+  /**
+   * Get the confidence of the last estimate, from 0 to 1.
+   * Zero if no period was found in the last window.
+   */
+  float getConfidence(){
+    return confidence;
+  }
+
+  static McLeodPitchDetector* create(float sr, int blocksize, int windowSize=1024, int decimation=1){
+    return new McLeodPitchDetector(sr, blocksize, windowSize, decimation);
+  }
+
+  static void destroy(McLeodPitchDetector* obj){
+    delete obj;
+  }
+};
+
 class ZeroCrossingPitchDetector{
 private:
   BiquadFilter *filter;
@@ -118,15 +344,20 @@ private:
   FloatArray counts;
   FloatArray filterOutput;
   float samplingRate;
+  float lastValue;
+  int countsPointer;
+  float count;
   const static int POINTS_AVERAGE = 10;
 public:
   ZeroCrossingPitchDetector(float aSamplingRate, int blocksize, int aNumLowPassStages=1, int aNumHighPassStages=1) :
     samplingRate(aSamplingRate),
     numLowPassStages(aNumLowPassStages),
-    numHighPassStages(aNumHighPassStages) {
+    numHighPassStages(aNumHighPassStages),
+    lastValue(0), countsPointer(0), count(0) {
     // RAII constructor
     filterOutput = FloatArray::create(blocksize);
     counts = FloatArray::create(POINTS_AVERAGE); //number of zcc to be averaged
+    counts.clear();
     filter = BiquadFilter::create(numLowPassStages+numHighPassStages);
     setLowPassCutoff(0.03);
     setHighPassCutoff(0.001);
@@ -161,10 +392,6 @@ public:
   };
   void process(FloatArray input){
     ASSERT(input.getSize()<=filterOutput.getSize(), "wrong size");
-    static float lastValue=0;
-    static int countsPointer=0;
-    static float period=0;
-    static float count;
     filter->process(input, filterOutput);
     // filterOutput.copyTo(input);
     for(int n=0; n<input.getSize(); n++){
@@ -0,0 +1,353 @@
+#ifndef __PitchShifter_h__
+#define __PitchShifter_h__
+
+#include "FloatArray.h"
+#include "CircularBuffer.h"
+#include "Window.h"
+#include "PitchDetector.h"
+#include "Interpolator.h"
+
+/**
+ * Time domain pitch shifter with low latency, for live harmony.
+ * The output is a crossfade of Hann windowed grains, read from a short delay line of the
+ * input. Each new grain starts where its first samples best match the signal around the
+ * grain it takes over from (WSOLA), found by cross-correlation over a range of delays.
+ * The search is made on a 4x decimated signal, then refined at the full rate, so that it
+ * costs the same for every grain, and the cost per block is bounded.
+ *
+ * Grains are one period of the lowest pitch long, and the search covers one period, so
+ * that pitches down to that frequency are spliced in phase. Grains are read at the pitch
+ * ratio, with two grains overlapping. With the lowest pitch at 110Hz, the average delay
+ * is under 5ms at a ratio of 1, and under 10ms up to a ratio of 2.
+ *
+ * With formant preservation, grains are two pitch periods long and read at the original
+ * speed, and are repeated or skipped to change the pitch (PSOLA). The spectral envelope of
+ * each grain is unchanged, so a voice keeps its character. The period comes from a
+ * McLeodPitchDetector, and the average delay is half a period. Input without a clear pitch
+ * passes unchanged.
+ */
+class PitchShifter {
+public:
+  static const int MAX_GRAINS = 8;
+  static const int DECIMATION = 4;
+  static const int MIN_DELAY = 4; // samples between the write position and the newest sample read
+private:
+  struct Grain {
+    float position; // read index in the delay line
+    float speed;
+    float start; // read index where the grain started
+    float phase; // read index in the window table
+    float increment;
+    float gain;
+    int remaining; // samples until the end of the grain, 0 if unused
+  };
+  float sampleRate;
+  CircularFloatBuffer buffer;
+  Window window;
+  McLeodPitchDetector* detector;
+  Grain grains[MAX_GRAINS];
+  int last; // the most recently started grain, or -1
+  FloatArray segment; // scratch for the search: template and candidates
+  FloatArray decimated;
+  int grainSize;
+  int templateSize;
+  int maxPeriod;
+  float ratio;
+  bool formant;
+  float period; // detected pitch period in samples, 0 if unvoiced
+  float threshold; // minimum confidence of the pitch detector
+  float untilNext; // samples until the next grain starts
+
+  /* read the segment of the delay line that ends just before index @param end */
+  void read(FloatArray output, uint32_t end){
+    buffer.read(output, buffer.getWriteIndex() - end);
+  }
+
+  /* sum of each group of DECIMATION samples, a cheap low pass filter before decimating */
+  static void decimate(FloatArray input, FloatArray output){
+    for(int i=0; i<output.getSize(); ++i){
+      const float* p = input.getData() + i*DECIMATION;
+      output[i] = p[0] + p[1] + p[2] + p[3];
+    }
+  }
+
+  static float dot(const float* a, const float* b, int len){
+    float sum = 0;
+    for(int i=0; i<len; ++i)
+      sum += a[i]*b[i];
+    return sum;
+  }
+
+  /* normalised cross-correlation, without the energy of the template which is the same for all candidates */
+  static float score(float product, float energy){
+    return product/sqrtf(energy + 1e-12f);
+  }
+
+  /**
+   * Find the candidate segment that matches the segment ending at @param reference best.
+   * Candidates end from @param end - @param range to @param end.
+   * @return the index at the end of the best candidate
+   */
+  uint32_t search(uint32_t reference, uint32_t end, int range){
+    int len = templateSize;
+    FloatArray tmpl = segment.subArray(0, len);
+    FloatArray region = segment.subArray(len, len+range);
+    read(tmpl, reference);
+    read(region, end);
+    int dlen = len/DECIMATION;
+    int drange = (len+range)/DECIMATION;
+    FloatArray dtmpl = decimated.subArray(0, dlen);
+    FloatArray dregion = decimated.subArray(dlen, drange);
+    decimate(tmpl, dtmpl);
+    decimate(region, dregion);
+    // coarse search at every DECIMATION samples, with a running sum of the candidate energy
+    float energy = dot(dregion.getData(), dregion.getData(), dlen);
+    float best = score(dot(dtmpl.getData(), dregion.getData(), dlen), energy);
+    int coarse = 0;
+    for(int j=1; j+dlen<=drange; ++j){
+      energy += dregion[j+dlen-1]*dregion[j+dlen-1] - dregion[j-1]*dregion[j-1];
+      float s = score(dot(dtmpl.getData(), dregion.getData()+j, dlen), energy);
+      if(s > best){
+	best = s;
+	coarse = j;
+      }
+    }
+    // refine at the full rate, between the neighbouring coarse positions
+    int lo = max(0, (coarse-1)*DECIMATION + 1);
+    int hi = min(range, (coarse+1)*DECIMATION - 1);
+    int offset = coarse*DECIMATION;
+    best = -1e30f;
+    for(int m=lo; m<=hi; ++m){
+      const float* r = region.getData() + m;
+      float s = score(dot(tmpl.getData(), r, len), dot(r, r, len));
+      if(s > best){
+	best = s;
+	offset = m;
+      }
+    }
+    // the candidate at offset m ends at end - range + m
+    return end - range + offset;
+  }
+
+  /* absolute index of the sample at the position of a grain, relative to time @param now */
+  uint32_t getIndex(float position, uint32_t now){
+    return now - ((now - (uint32_t)position) & (buffer.getSize()-1));
+  }
+
+  /* start a grain at time @param now, returns the number of samples until the next one */
+  float start(uint32_t now){
+    int length, range;
+    float speed, gain, hop;
+    uint32_t end;
+    bool voiced = formant && period > 0;
+    if(voiced){
+      // PSOLA: grains of two periods, one output period apart, aligned with the start of the last grain
+      length = (int)(2*period);
+      hop = period/ratio;
+      speed = 1;
+      gain = hop/period;
+      range = (int)period;
+      end = now - MIN_DELAY;
+    }else{
+      // WSOLA: two overlapping grains, the new one aligned with the current position of the last
+      length = grainSize;
+      hop = grainSize/2;
+      speed = formant ? 1 : ratio;
+      gain = 1;
+      range = grainSize;
+      // grains that read faster than real time start further back
+      end = now - MIN_DELAY - (int)(max(0.0f, speed - 1)*length);
+    }
+    int index = -1;
+    for(int i=0; i<MAX_GRAINS; ++i){
+      if(grains[i].remaining == 0){
+	index = i;
+	break;
+      }
+    }
+    if(index < 0)
+      return hop; // all grains in use: skip this one
+    uint32_t position;
+    if(last >= 0 && grains[last].remaining > 0){
+      Grain& previous = grains[last];
+      uint32_t reference = getIndex(voiced ? previous.start : previous.position, now);
+      position = search(reference, end, range);
+    }else{
+      position = end - range/2;
+    }
+    Grain& g = grains[index];
+    g.position = g.start = (float)(position & (buffer.getSize()-1));
+    g.speed = speed;
+    g.phase = 0;
+    g.increment = (float)(window.getSize()-1)/length;
+    g.gain = gain;
+    g.remaining = length;
+    last = index;
+    return hop;
+  }
+
+  void render(Grain& g, float* output, int len){
+    int n = min(len, g.remaining);
+    const float* source = buffer.getData();
+    uint32_t mask = buffer.getSize()-1;
+    const float* win = window.getData();
+    HermiteKernel hermite;
+    LinearKernel linear;
+    float pos = g.position;
+    float ph = g.phase;
+    for(int k=0; k<n; ++k){
+      uint32_t i = (uint32_t)pos;
+      float s = hermite.read(source, mask, i, pos - i);
+      int j = (int)ph;
+      output[k] += s*g.gain*linear.interpolate(win + j, ph - j);
+      pos += g.speed;
+      ph += g.increment;
+    }
+    uint32_t whole = (uint32_t)pos;
+    g.position = (whole & mask) + (pos - whole);
+    g.phase = ph;
+    g.remaining -= n;
+  }
+
+public:
+  /**
+   * @param sr sampling rate
+   * @param blocksize maximum number of samples per block
+   * @param minFrequency lowest pitch that is shifted cleanly, in Hz
+   */
+  PitchShifter(float sr, int blocksize, float minFrequency)
+    : sampleRate(sr), detector(NULL), last(-1), ratio(1), formant(false),
+      period(0), threshold(0.8f), untilNext(0) {
+    maxPeriod = (int)(sr/minFrequency) + 1;
+    grainSize = max(8*DECIMATION, maxPeriod & ~(2*DECIMATION-1));
+    templateSize = grainSize/2;
+    // enough delay for a grain at twice the speed, or two periods, plus the search
+    int range = max(grainSize, maxPeriod);
+    int size = CircularFloatBuffer::getPowerOfTwo(blocksize + 4*grainSize + 2*maxPeriod + MIN_DELAY + 4);
+    buffer = CircularFloatBuffer(new float[size], size);
+    buffer.clear();
+    window = Window::create(Window::HannWindow, 1024);
+    segment = FloatArray::create(2*templateSize + range);
+    decimated = FloatArray::create((2*templateSize + range)/DECIMATION);
+    detector = McLeodPitchDetector::create(sr, blocksize, 512, DECIMATION);
+    detector->setMinFrequency(minFrequency);
+    detector->setMaxFrequency(1000);
+    reset();
+  }
+
+  ~PitchShifter(){
+    delete[] buffer.getData();
+    Window::destroy(window);
+    FloatArray::destroy(segment);
+    FloatArray::destroy(decimated);
+    McLeodPitchDetector::destroy(detector);
+  }
+
+  void reset(){
+    for(int i=0; i<MAX_GRAINS; ++i)
+      grains[i].remaining = 0;
+    last = -1;
+    untilNext = 0;
+    period = 0;
+  }
+
+  /**
+   * Set the pitch ratio: 2 for an octave up, 0.5 for an octave down.
+   * The change takes effect with the next grain.
+   * @param value from 0.25 to 2
+   */
+  void setRatio(float value){
+    ratio = max(0.25f, min(2.0f, value));
+  }
+
+  float getRatio(){
+    return ratio;
+  }
+
+  /** set the ratio in semitones */
+  void setSemitones(float semitones){
+    setRatio(exp2f(semitones*(1.0f/12)));
+  }
+
+  /** enable or disable formant preservation */
+  void setFormantPreservation(bool value){
+    formant = value;
+  }
+
+  bool getFormantPreservation(){
+    return formant;
+  }
+
+  /** set the minimum confidence of the pitch detector for formant preservation, from 0 to 1 */
+  void setVoicingThreshold(float value){
+    threshold = value;
+  }
+
+  /** get the pitch period used for formant preservation in samples, 0 if the input has no clear pitch */
+  float getPeriod(){
+    return period;
+  }
+
+  int getGrainSize(){
+    return grainSize;
+  }
+
+  /**
+   * Get the typical delay of the output in samples, at the current ratio.
+   * With formant preservation, this depends on the pitch period.
+   */
+  int getLatency(){
+    if(formant && period > 0)
+      return MIN_DELAY + (int)(period/2);
+    // the start of a grain is delayed by half the search range on average, and further
+    // for ratios above 1. The delay changes by (1-ratio)*grainSize over the grain.
+    float excess = max(0.0f, ratio - 1)*grainSize;
+    return MIN_DELAY + grainSize/2 + (int)(excess + (1 - ratio)*grainSize/2);
+  }
+
+  /**
+   * Process a block of samples. The input and output arrays may be the same.
+   */
+  void process(FloatArray input, FloatArray output){
+    int n = input.getSize();
+    if(formant){
+      detector->process(input);
+      float frequency = detector->getFrequency();
+      if(detector->getConfidence() >= threshold && frequency > 0)
+	period = min((float)maxPeriod, sampleRate/frequency);
+      else
+	period = 0;
+    }
+    uint32_t now = buffer.getWriteIndex();
+    buffer.write(input);
+    output.clear();
+    int k = 0;
+    while(true){
+      // render the grains up to the start of the next one
+      int end = min(n, (int)untilNext);
+      for(int i=0; i<MAX_GRAINS; ++i)
+	if(grains[i].remaining > 0)
+	  render(grains[i], output.getData()+k, end-k);
+      k = end;
+      if(k >= n)
+	break;
+      untilNext += start(now + k);
+    }
+    untilNext -= n;
+  }
+
+  /**
+   * @param blocksize maximum number of samples per block
+   * @param minFrequency lowest pitch that is shifted cleanly, in Hz. Sets the grain size and
+   * the delay: lower frequencies need longer grains.
+   */
+  static PitchShifter* create(float sr, int blocksize, float minFrequency = 110){
+    return new PitchShifter(sr, blocksize, minFrequency);
+  }
+
+  static void destroy(PitchShifter* obj){
+    delete obj;
+  }
+};
+
+#endif /* __PitchShifter_h__ */
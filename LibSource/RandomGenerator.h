@@ -0,0 +1,108 @@
+#ifndef __RandomGenerator_h__
+#define __RandomGenerator_h__
+
+#include <stdint.h>
+#include "FloatArray.h"
+
+/**
+ * Fast pseudo-random number generator, for noise and other audio rate randomness.
+ * Uses the xorshift algorithm on a 32 bit state, which is kept per instance so that
+ * generators can be seeded, and don't interfere with each other.
+ * Floats are made by putting the top 23 random bits in the mantissa of a float with
+ * a fixed exponent, which gives a uniform value from 1 to 2 without a division or an
+ * int to float conversion.
+ * Generators made without a seed each get a different one, so that they are uncorrelated.
+ */
+class RandomGenerator {
+private:
+  uint32_t state;
+
+  static float toFloat(uint32_t bits){
+    // mantissa from the top bits, exponent of 2^0: 1.0 to 1.999...
+    union {
+      uint32_t i;
+      float f;
+    } x;
+    x.i = (bits >> 9) | 0x3f800000;
+    return x.f;
+  }
+
+public:
+  RandomGenerator(){
+    setSeed(getUniqueSeed());
+  }
+
+  RandomGenerator(uint32_t seed){
+    setSeed(seed);
+  }
+
+  /**
+   * Get a different seed on every call, from a counter passed through a hash.
+   * Seeds from another xorshift generator would not do: consecutive outputs of the same
+   * xorshift sequence give generators that are delayed copies of each other.
+   */
+  static uint32_t getUniqueSeed(){
+    static uint32_t counter = 0;
+    // murmur3 finaliser of a Weyl sequence
+    uint32_t x = ++counter*0x9e3779b9;
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return x;
+  }
+
+  /** set the state of the generator; a seed of zero is replaced by the default seed */
+  void setSeed(uint32_t seed){
+    state = seed ? seed : 33641;
+  }
+
+  /** generate an unsigned 32 bit random number */
+  uint32_t getNextValue(){
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  /** generate a random number in the range [-1, 1) */
+  float getNextSample(){
+    return toFloat(getNextValue())*2 - 3;
+  }
+
+  /** generate a random number in the range [0, 1) */
+  float getNextFloat(){
+    return toFloat(getNextValue()) - 1;
+  }
+
+  /** fill @param output with random values in the range [-1, 1) */
+  void fill(FloatArray output){
+    float* out = output.getData();
+    uint32_t x = state;
+    for(int i=0; i<output.getSize(); ++i){
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      out[i] = toFloat(x)*2 - 3;
+    }
+    state = x;
+  }
+
+  /** fill @param output with random values in the range [@param min, @param max) */
+  void fill(FloatArray output, float min, float max){
+    float* out = output.getData();
+    float range = max - min;
+    float offset = min - range;
+    uint32_t x = state;
+    for(int i=0; i<output.getSize(); ++i){
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      out[i] = toFloat(x)*range + offset;
+    }
+    state = x;
+  }
+};
+
+#endif /* __RandomGenerator_h__ */
@@ -5,6 +5,7 @@
 #
 /**
    Implements 4x oversampling
+   @see Oversampler for selectable factors, and decimation that leaves the input intact
 */  
 class Resampler {
 private:
@@ -0,0 +1,341 @@
+#ifndef __SampleBank_h__
+#define __SampleBank_h__
+
+#include <string.h>
+#include "FloatArray.h"
+#include "SampleBankFormat.h"
+#include "Interpolator.h"
+
+#ifdef ARM_CORTEX
+/* start of the flash region reserved for a sample bank image, defined in the linker script */
+extern "C" const char _samplebank[];
+#define SAMPLEBANK_ADDRESS ((const void*)_samplebank)
+#endif
+
+/**
+ * A sample in a SampleBank. Samples are read in place, from the memory that holds the bank.
+ */
+class BankSample {
+private:
+  const SampleBankEntry* entry;
+  const uint8_t* data;
+public:
+  BankSample() : entry(NULL), data(NULL) {}
+
+  BankSample(const SampleBankEntry* aEntry, const uint8_t* aData)
+    : entry(aEntry), data(aData) {}
+
+  bool isValid(){
+    return entry != NULL;
+  }
+
+  const char* getName(){
+    return entry->name;
+  }
+
+  /** number of frames */
+  int getLength(){
+    return entry->length;
+  }
+
+  int getChannels(){
+    return entry->channels;
+  }
+
+  float getSampleRate(){
+    return entry->sampleRate;
+  }
+
+  bool isFloat(){
+    return entry->format == SAMPLEBANK_FLOAT32;
+  }
+
+  bool isLooped(){
+    return entry->loopEnd > entry->loopStart;
+  }
+
+  int getLoopStart(){
+    return entry->loopStart;
+  }
+
+  /** frame after the end of the loop, or the end of the sample if it has no loop */
+  int getLoopEnd(){
+    return isLooped() ? entry->loopEnd : entry->length;
+  }
+
+  /** a channel of a float sample, without copying. Empty for PCM16 samples. */
+  FloatArray getFloatChannel(int channel){
+    if(!isFloat())
+      return FloatArray();
+    return FloatArray((float*)data + channel*entry->length, entry->length);
+  }
+
+  /** a channel of a PCM16 sample. NULL for float samples. */
+  const int16_t* getShortChannel(int channel){
+    if(isFloat())
+      return NULL;
+    return (const int16_t*)data + channel*entry->length;
+  }
+
+  /** get a single value, or 0 outside of the sample */
+  float get(int channel, int index){
+    if(index < 0 || index >= (int)entry->length)
+      return 0.0f;
+    if(isFloat())
+      return ((const float*)data)[channel*entry->length + index];
+    return ((const int16_t*)data)[channel*entry->length + index]*(1.0f/32768);
+  }
+
+  /**
+   * Read a block of a channel, converted to float, starting at frame @param position.
+   * Frames outside of the sample are read as 0.
+   */
+  void read(int channel, int position, FloatArray output){
+    int len = output.getSize();
+    int start = max(0, min(len, -position));
+    int end = max(start, min(len, (int)entry->length - position));
+    for(int i=0; i<start; ++i)
+      output[i] = 0;
+    if(isFloat()){
+      const float* src = (const float*)data + channel*entry->length + position;
+      output.subArray(start, end-start).copyFrom((float*)src + start, end-start);
+    }else{
+      const int16_t* src = (const int16_t*)data + channel*entry->length + position;
+      for(int i=start; i<end; ++i)
+	output[i] = src[i]*(1.0f/32768);
+    }
+    for(int i=end; i<len; ++i)
+      output[i] = 0;
+  }
+};
+
+/**
+ * Reader for a sample bank image, such as one made with `make samples`.
+ * The image is read where it is, for example in memory mapped flash, so that samples
+ * don't have to be copied to RAM when a patch starts.
+ * The image format is defined in SampleBankFormat.h.
+ */
+class SampleBank {
+private:
+  const SampleBankHeader* header;
+  const SampleBankEntry* entries;
+public:
+  SampleBank() : header(NULL), entries(NULL) {}
+
+  /** @param address the start of the image, which must be aligned to 4 bytes */
+  SampleBank(const void* address)
+    : header((const SampleBankHeader*)address),
+      entries((const SampleBankEntry*)(header + 1)) {}
+
+  /** check that the image is a sample bank of a known version */
+  bool isValid(){
+    return header != NULL && header->magic == SAMPLEBANK_MAGIC &&
+      header->version == SAMPLEBANK_VERSION;
+  }
+
+  int getNumberOfSamples(){
+    return isValid() ? header->count : 0;
+  }
+
+  /** size of the image in bytes */
+  int getSize(){
+    return isValid() ? header->size : 0;
+  }
+
+  BankSample getSample(int index){
+    if(index < 0 || index >= getNumberOfSamples())
+      return BankSample();
+    return BankSample(entries + index, (const uint8_t*)header + entries[index].offset);
+  }
+
+  /** get a sample by name, or an invalid sample if there is none with that name */
+  BankSample getSample(const char* name){
+    return getSample(getIndex(name));
+  }
+
+  /** @return the index of the sample with this name, or -1 */
+  int getIndex(const char* name){
+    for(int i=0; i<getNumberOfSamples(); ++i)
+      if(strncmp(entries[i].name, name, SAMPLEBANK_NAME_LENGTH) == 0)
+	return i;
+    return -1;
+  }
+
+  static SampleBank create(const void* address){
+    return SampleBank(address);
+  }
+};
+
+/**
+ * Varispeed player for samples in a SampleBank, reading the bank in place with
+ * 4-point Hermite interpolation. Samples play once, or repeat between their loop points
+ * while looping is enabled.
+ */
+class SamplePlayer {
+private:
+  BankSample sample;
+  float sampleRate;
+  float speed; // playback speed set by the user
+  float increment; // frames per output sample
+  float gain;
+  int index; // integer part of the read position
+  float frac; // fractional part of the read position
+  bool playing;
+  bool looping;
+  int loopStart, loopEnd;
+
+  template<typename T>
+  inline float get(const T* data, int i, float scale){
+    if(looping){
+      if(i >= loopEnd)
+	i -= loopEnd - loopStart;
+      else if(i < loopStart && index >= loopStart)
+	i += loopEnd - loopStart;
+    }
+    if(i < 0 || i >= sample.getLength())
+      return 0.0f;
+    return data[i]*scale;
+  }
+
+  template<typename T>
+  inline float interpolate(const T* data, float scale){
+    float x[4];
+    int lo = looping && index >= loopStart ? loopStart : 0;
+    int hi = looping ? loopEnd : sample.getLength();
+    if(index > lo && index+2 < hi){
+      const T* p = data + index;
+      for(int j=0; j<4; ++j)
+	x[j] = p[j-1]*scale;
+    }else{
+      // at the ends of the sample or the loop
+      for(int j=0; j<4; ++j)
+	x[j] = get(data, index+j-1, scale);
+    }
+    return HermiteKernel().interpolate(x + 1, frac);
+  }
+
+  inline void advance(){
+    frac += increment;
+    int n = (int)frac;
+    if(frac < n)
+      n--;
+    index += n;
+    frac -= n;
+    // wrap only when the loop point is crossed, not when starting outside of the loop
+    if(looping && index >= loopEnd && index-n < loopEnd){
+      index -= loopEnd - loopStart;
+    }else if(looping && index < loopStart && index-n >= loopStart){
+      index += loopEnd - loopStart;
+    }else if(index >= sample.getLength() || index < 0){
+      playing = false;
+    }
+  }
+
+  template<typename T>
+  void render(const T* data, float scale, float* output, int len){
+    for(int i=0; i<len && playing; ++i){
+      output[i] += interpolate(data, scale)*gain;
+      advance();
+    }
+  }
+
+  void render(int channel, FloatArray output){
+    if(sample.isFloat())
+      render(sample.getFloatChannel(channel).getData(), 1.0f, output.getData(), output.getSize());
+    else
+      render(sample.getShortChannel(channel), 1.0f/32768, output.getData(), output.getSize());
+  }
+
+public:
+  SamplePlayer(float sr)
+    : sampleRate(sr), speed(1), increment(0), gain(1), index(0), frac(0),
+      playing(false), looping(false), loopStart(0), loopEnd(0) {}
+
+  void setSample(BankSample s){
+    sample = s;
+    playing = false;
+    setSpeed(speed);
+    setLooping(looping);
+  }
+
+  BankSample getSample(){
+    return sample;
+  }
+
+  /** set the playback speed: 1 for the original pitch, 2 for an octave up, negative for reverse */
+  void setSpeed(float value){
+    speed = value;
+    increment = sample.isValid() ? speed*sample.getSampleRate()/sampleRate : speed;
+  }
+
+  float getSpeed(){
+    return speed;
+  }
+
+  void setGain(float value){
+    gain = value;
+  }
+
+  /** loop between the loop points of the sample, or the whole sample if it has none */
+  void setLooping(bool value){
+    looping = value && sample.isValid();
+    if(looping){
+      loopStart = sample.getLoopStart();
+      loopEnd = sample.getLoopEnd();
+    }
+  }
+
+  bool isPlaying(){
+    return playing;
+  }
+
+  /** current read position in frames */
+  float getPosition(){
+    return index + frac;
+  }
+
+  /** start playing from @param position in frames, or from the end when playing in reverse */
+  void trigger(float position = 0){
+    if(!sample.isValid())
+      return;
+    if(increment < 0 && position == 0)
+      position = looping ? loopEnd - 1 : sample.getLength() - 1;
+    index = (int)position;
+    frac = position - index;
+    playing = true;
+  }
+
+  void stop(){
+    playing = false;
+  }
+
+  /** add the first channel of the sample to @param output */
+  void process(FloatArray output){
+    if(playing)
+      render(0, output);
+  }
+
+  /** add the sample to stereo output. Mono samples are added to both channels. */
+  void process(FloatArray left, FloatArray right){
+    if(!playing)
+      return;
+    int i = index;
+    float f = frac;
+    render(0, left);
+    // the second channel starts from the same position
+    index = i;
+    frac = f;
+    playing = true;
+    render(sample.getChannels() > 1 ? 1 : 0, right);
+  }
+
+  static SamplePlayer* create(float sr){
+    return new SamplePlayer(sr);
+  }
+
+  static void destroy(SamplePlayer* obj){
+    delete obj;
+  }
+};
+
+#endif /* __SampleBank_h__ */
@@ -0,0 +1,43 @@
+#ifndef __SampleBankFormat_h__
+#define __SampleBankFormat_h__
+
+#include <stdint.h>
+
+/*
+ * Sample bank image format, shared by the SampleBank reader and Tools/MakeSampleBank.c
+ *
+ * An image is a header, followed by one entry per sample and the sample data.
+ * Sample data is stored with each channel as one contiguous block of PCM16 or float
+ * values, so that a channel can be read in place. Data blocks start at multiples of 8
+ * bytes from the start of the image. All values are little endian.
+ */
+
+#define SAMPLEBANK_MAGIC        0x4b4e4253 /* "SBNK" */
+#define SAMPLEBANK_VERSION      1
+#define SAMPLEBANK_NAME_LENGTH  24
+#define SAMPLEBANK_ALIGNMENT    8
+
+typedef enum {
+  SAMPLEBANK_PCM16   = 1, /* signed 16 bit, full scale 32768 */
+  SAMPLEBANK_FLOAT32 = 2
+} SampleBankFormat;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;        /* size of the whole image in bytes */
+  uint32_t count;       /* number of samples */
+} SampleBankHeader;
+
+typedef struct {
+  char name[SAMPLEBANK_NAME_LENGTH]; /* zero terminated */
+  uint32_t offset;      /* position of the data of the first channel, in bytes from the start of the image */
+  uint32_t length;      /* number of frames */
+  uint16_t channels;
+  uint16_t format;      /* SampleBankFormat */
+  uint32_t sampleRate;
+  uint32_t loopStart;   /* first frame of the loop */
+  uint32_t loopEnd;     /* frame after the end of the loop, 0 if the sample has no loop */
+} SampleBankEntry;
+
+#endif // __SampleBankFormat_h__
@@ -3,6 +3,23 @@
 #include "ProgramVector.h"
 #include "ServiceCall.h"
 
+/*
+ * Block floating point: the input is shifted up to full scale before the transform, and
+ * the output after it. The shifts, and the fixed scaling of the transform itself, are
+ * accounted for in the block exponent of the spectrum.
+ * Both the CMSIS arm_rfft_q15 and the portable implementation below scale the forward
+ * transform by 1/fftSize, and the inverse transform by 1/fftSize relative to its input.
+ */
+
+static bool isSupportedSize(int len){
+  return len==32 || len ==64 || len==128 || len==256 || len==512 || len==1024 || len==2048 || len==4096;
+}
+
+/* Shift the samples to Q15, clamping the shift to the range of 16 bit values */
+static void denormalise(ShortArray output, int exponent){
+  output.shift(max(-16, min(16, exponent)));
+}
+
 #ifdef ARM_CORTEX
 ShortFastFourierTransform::ShortFastFourierTransform(){}
 
@@ -13,25 +30,28 @@ ShortFastFourierTransform::ShortFastFourierTransform(int len){
 ShortFastFourierTransform::~ShortFastFourierTransform(){}
 
 void ShortFastFourierTransform::init(int aSize){
+  ASSERT(isSupportedSize(aSize), "Unsupported FFT size");
   len = aSize;
-  ASSERT(len==32 || len ==64 || len==128 || len==256 || len==512 || len==1024 || len==2048 || len==4096, "Unsupported FFT size");
-  void* args[] = {(void*)&instance, (void*)&len};
-  // getProgramVector()->serviceCall(OWL_SERVICE_ARM_RFFT_FAST_INIT_Q15, args, 2);
   // Supported FFT Lengths are 32, 64, 128, 256, 512, 1024, 2048, 4096.
 }
 
-void ShortFastFourierTransform::fft(ShortArray in, ComplexShortArray out){
+int ShortFastFourierTransform::fft(ShortArray in, ComplexShortArray out){
   ASSERT(in.getSize() >= getSize(), "Input array too small");
-  ASSERT(out.getSize() >= getSize(), "Output array too small");
+  ASSERT(out.getSize() >= len, "Output array too small");
+  int shift = ComplexShortArray((ComplexShort*)in.getData(), len/2).normalise();
   arm_rfft_init_q15(&instance, len, 0, 1);
   arm_rfft_q15(&instance, (int16_t*)in.getData(), (int16_t*)out.getData());
+  shift += out.subArray(0, len).normalise();
+  return log2i(len) - shift;
 }
 
-void ShortFastFourierTransform::ifft(ComplexShortArray in, ShortArray out){
-  ASSERT(in.getSize() >= getSize(), "Input array too small");
+void ShortFastFourierTransform::ifft(ComplexShortArray in, ShortArray out, int exponent){
+  ASSERT(in.getSize() > len/2, "Input array too small");
   ASSERT(out.getSize() >= getSize(), "Output array too small");
+  int shift = in.subArray(0, len/2+1).normalise();
   arm_rfft_init_q15(&instance, len, 1, 1);
   arm_rfft_q15(&instance, (int16_t*)in.getData(), (int16_t*)out.getData());
+  denormalise(out.subArray(0, len), exponent - shift);
 }
 
 int ShortFastFourierTransform::getSize(){
@@ -40,46 +60,143 @@ int ShortFastFourierTransform::getSize(){
 
 #else /* ARM_CORTEX */
 
-ShortFastFourierTransform::ShortFastFourierTransform(){}
+/*
+ * The real FFT of size N is computed with a complex FFT of size N/2, as in
+ * FastFourierTransform, in Q15 arithmetic with 32 bit intermediate results.
+ * The radix-2 butterflies scale each stage by 1/2, which keeps all values in range
+ * as long as the magnitude of the complex input is at most one.
+ */
+
+static inline int16_t saturate(int32_t value){
+  return value > SHRT_MAX ? SHRT_MAX : (value < SHRT_MIN ? SHRT_MIN : value);
+}
 
-ShortFastFourierTransform::ShortFastFourierTransform(int aSize){
+ShortFastFourierTransform::ShortFastFourierTransform() : len(0) {}
+
+ShortFastFourierTransform::ShortFastFourierTransform(int aSize) : len(0) {
   init(aSize);
 }
 
 ShortFastFourierTransform::~ShortFastFourierTransform(){
-  assert(false, "TODO");
   ComplexShortArray::destroy(temp);
+  ComplexShortArray::destroy(twiddles);
 }
 
 void ShortFastFourierTransform::init(int aSize){
-  ASSERT(aSize==32 || aSize ==64 || aSize==128 || aSize==256 || aSize==512 || aSize==1024 || aSize==2048 || aSize==4096, "Unsupported FFT size");
-  cfgfft = kiss_fft_alloc(aSize, 0 , 0, 0);
-  cfgifft = kiss_fft_alloc(aSize, 1,0, 0);
-  temp = ComplexShortArray::create(getSize());
+  ASSERT(isSupportedSize(aSize), "Unsupported FFT size");
+  ComplexShortArray::destroy(temp);
+  ComplexShortArray::destroy(twiddles);
+  len = aSize;
+  temp = ComplexShortArray::create(len/2);
+  // twiddle factors exp(-2*pi*i*k/N), the complex FFT uses every other one
+  twiddles = ComplexShortArray::create(len/2);
+  for(unsigned int k=0; k<len/2; k++){
+    float phase = -2*M_PI*k/len;
+    twiddles[k].re = saturate(roundf(cosf(phase)*32768));
+    twiddles[k].im = saturate(roundf(sinf(phase)*32768));
+  }
 }
 
-void ShortFastFourierTransform::fft(ShortArray input, ComplexShortArray output){
-  ASSERT(input.getSize() >= getSize(), "Input array too small");
-  ASSERT(output.getSize() >= getSize(), "Output array too small");
-  for(int n=0; n<getSize(); n++){
-    temp[n].re=input[n];
-    temp[n].im=0;
+void ShortFastFourierTransform::cfft(ComplexShortArray data, bool inverse){
+  int size = len/2;
+  for(int i=1, j=0; i<size; i++){
+    int bit = size>>1;
+    for(; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if(i < j){
+      ComplexShort tmp = data[i];
+      data[i] = data[j];
+      data[j] = tmp;
+    }
+  }
+  for(int step=1; step<size; step <<= 1){
+    for(int m=0; m<step; m++){
+      int32_t wr = twiddles[m*size/step].re;
+      int32_t wi = inverse ? -twiddles[m*size/step].im : twiddles[m*size/step].im;
+      for(int i=m; i<size; i+=2*step){
+	int j = i+step;
+	int32_t tr = (wr*data[j].re - wi*data[j].im + 0x4000) >> 15;
+	int32_t ti = (wr*data[j].im + wi*data[j].re + 0x4000) >> 15;
+	int32_t ur = data[i].re;
+	int32_t ui = data[i].im;
+	data[i].re = (ur + tr + 1) >> 1;
+	data[i].im = (ui + ti + 1) >> 1;
+	data[j].re = (ur - tr + 1) >> 1;
+	data[j].im = (ui - ti + 1) >> 1;
+      }
+    }
   }
-  kiss_fft(cfgfft, (kiss_fft_cpx*)(float*)temp.getData(), (kiss_fft_cpx*)(float*)output);
 }
-  
-void ShortFastFourierTransform::ifft(ComplexShortArray input, ShortArray output){
+
+int ShortFastFourierTransform::fft(ShortArray input, ComplexShortArray output){
   ASSERT(input.getSize() >= getSize(), "Input array too small");
+  ASSERT(output.getSize() >= len, "Output array too small");
+  int half = len/2;
+  int shift = ComplexShortArray((ComplexShort*)input.getData(), half).normalise();
+  // even samples as real part, odd samples as imaginary part, halved to keep the magnitude below one
+  for(int n=0; n<half; n++){
+    temp[n].re = input[2*n] >> 1;
+    temp[n].im = input[2*n+1] >> 1;
+  }
+  cfft(temp, false);
+  output[0].re = saturate(temp[0].re + temp[0].im);
+  output[0].im = 0;
+  output[half].re = saturate(temp[0].re - temp[0].im);
+  output[half].im = 0;
+  for(int k=1; k<half; k++){
+    // even and odd spectra, scaled by 2
+    int32_t ere = temp[k].re + temp[half-k].re;
+    int32_t eim = temp[k].im - temp[half-k].im;
+    int32_t ore = temp[k].im + temp[half-k].im;
+    int32_t oim = temp[half-k].re - temp[k].re;
+    int32_t tre = (twiddles[k].re*ore - twiddles[k].im*oim + 0x4000) >> 15;
+    int32_t tim = (twiddles[k].re*oim + twiddles[k].im*ore + 0x4000) >> 15;
+    output[k].re = saturate((ere + tre + 1) >> 1);
+    output[k].im = saturate((eim + tim + 1) >> 1);
+    output[len-k].re = output[k].re;
+    output[len-k].im = -output[k].im;
+  }
+  shift += output.subArray(0, len).normalise();
+  return log2i(len) - shift;
+}
+
+void ShortFastFourierTransform::ifft(ComplexShortArray input, ShortArray output, int exponent){
+  ASSERT(input.getSize() > len/2, "Input array too small");
   ASSERT(output.getSize() >= getSize(), "Output array too small");
-  kiss_fft(cfgifft, (kiss_fft_cpx*)(float*)input, (kiss_fft_cpx*)(float*)temp.getData());
-  float scale=1.0f/getSize();
-  for(int n=0; n<getSize(); n++){
-    output[n]=temp[n].re*scale;
+  int half = len/2;
+  int shift = input.subArray(0, half+1).normalise();
+  // normalised bins can have a magnitude of up to sqrt(2), but the transform needs at most one
+  for(int k=0; k<=half; k++){
+    if((uint32_t)(input[k].re*input[k].re) + (uint32_t)(input[k].im*input[k].im) > (uint32_t)SHRT_MAX*SHRT_MAX){
+      ShortArray((int16_t*)input.getData(), (half+1)*2).shift(-1);
+      shift -= 1;
+      break;
+    }
+  }
+  for(int k=0; k<half; k++){
+    // even spectrum and odd spectrum, scaled by 2
+    int32_t ere = input[k].re + input[half-k].re;
+    int32_t eim = input[k].im - input[half-k].im;
+    int32_t dre = input[k].re - input[half-k].re;
+    int32_t dim = input[k].im + input[half-k].im;
+    // multiply by the conjugate twiddle factor
+    int32_t ore = (dre*twiddles[k].re + dim*twiddles[k].im + 0x4000) >> 15;
+    int32_t oim = (dim*twiddles[k].re - dre*twiddles[k].im + 0x4000) >> 15;
+    // halved to keep the magnitude below one
+    temp[k].re = saturate((ere - oim + 2) >> 2);
+    temp[k].im = saturate((eim + ore + 2) >> 2);
   }
+  cfft(temp, true);
+  for(int n=0; n<half; n++){
+    output[2*n] = temp[n].re;
+    output[2*n+1] = temp[n].im;
+  }
+  denormalise(output.subArray(0, len), exponent - shift + 1);
 }
-    
+
 int ShortFastFourierTransform::getSize(){
-  return temp.getSize();
+  return len;
 }
 
 #endif /* ifndef ARM_CORTEX */
@@ -4,22 +4,26 @@
 #include "ShortArray.h"
 #include "ComplexShortArray.h"
 
-#ifndef ARM_CORTEX
-#include "kiss_fft.h"
-#endif /* ARM_CORTEX */
-
 /**
  * This class performs direct and inverse ShortFast Fourier Transform.
- */ 
+ *
+ * Spectra are stored in block floating point: a ComplexShortArray together with a block
+ * exponent, shared by all the elements. The value of an element is its Q15 value times
+ * 2^exponent, and the spectrum has the same scale as the output of FastFourierTransform.
+ * The input is normalised before the transform and the output after it, so that quiet
+ * signals use the full 16 bit range instead of being shifted down by log2(N) bits.
+ * Use ComplexShortArray::toFloat() and ComplexShortArray::fromFloat() to convert
+ * between block floating point and float spectra.
+ */
 class ShortFastFourierTransform {
 private:
-#ifdef ARM_CORTEX
   unsigned int len;
+#ifdef ARM_CORTEX
   arm_rfft_instance_q15 instance;
 #else /* ARM_CORTEX */
-  kiss_fft_cfg cfgfft;
-  kiss_fft_cfg cfgifft;
   ComplexShortArray temp;
+  ComplexShortArray twiddles;
+  void cfft(ComplexShortArray data, bool inverse);
 #endif /* ARM_CORTEX */
 
 public:
@@ -49,24 +53,28 @@ public:
 
   /**
    * Perform the direct FFT.
+   * The output holds the complex bins 0 to fftSize/2, followed by their complex conjugates
+   * in reverse order, as in the CMSIS arm_rfft_q15.
    * @param[in] input The real-valued input array
-   * @param[out] output The complex-valued output array
+   * @param[out] output The complex-valued output array, of at least fftSize elements
+   * @return the block exponent of the output
    * @remarks Calling this method will mess up the content of the **input** array.
    * @note When built for ARM Cortex-M processor series, this method uses the optimized <a href="http://www.keil.com/pack/doc/CMSIS/General/html/index.html">CMSIS library</a>
   */
-  void fft(ShortArray input, ComplexShortArray output);
-  
+  int fft(ShortArray input, ComplexShortArray output);
+
   /**
    * Perform the inverse FFT.
-   * The output is rescaled by 1/fftSize.
-   * @param[in] input The complex-valued input array
+   * The output is rescaled by 1/fftSize, and saturated to the Q15 range.
+   * @param[in] input The complex-valued input array, with bins 0 to fftSize/2
    * @param[out] output The real-valued output array
+   * @param[in] exponent The block exponent of the input, as returned by fft()
    * @remarks Calling this method will mess up the content of the **input** array.
    * @note When built for ARM Cortex-M processor series, this method uses the optimized <a href="http://www.keil.com/pack/doc/CMSIS/General/html/index.html">CMSIS library</a>
-   * 
+   *
   */
-  void ifft(ComplexShortArray input, ShortArray output);
-    
+  void ifft(ComplexShortArray input, ShortArray output, int exponent);
+
   /**
    * Get the size of the FFT
    * @return The size of the FFT
@@ -0,0 +1,201 @@
+#ifndef __ShortTimeFourierTransform_h__
+#define __ShortTimeFourierTransform_h__
+
+#include <string.h>
+#include "FloatArray.h"
+#include "ComplexFloatArray.h"
+#include "FastFourierTransform.h"
+#include "CircularBuffer.h"
+#include "Window.h"
+
+/**
+ * Streaming short time Fourier transform with overlap-add resynthesis.
+ * Every hop, the last frameSize input samples are taken as a new frame. The work on
+ * each frame is split into stages: windowing and forward FFT, spectral processing, and
+ * inverse FFT with synthesis windowing. The stages of a frame are spread evenly over the
+ * audio blocks of the following hop, so that the processing load is the same for every
+ * block instead of peaking once per hop. The frame is then overlap-added to the output.
+ * Because the result of a frame is only available one hop later, the latency is
+ * frameSize + hopSize samples.
+ *
+ * Override processSpectrum() to modify the spectrum of each frame. Without it, the output
+ * is the input delayed by getLatency() samples. Heavier spectral processing can be divided
+ * into several steps, each scheduled separately: set the number of steps in the constructor
+ * and override processStep() instead.
+ * The same window is used for analysis and synthesis, and the synthesis window is
+ * normalised so that overlapping frames sum to unity gain for any hop size.
+ * Block size and hop size can be chosen independently.
+ */
+class ShortTimeFourierTransform {
+protected:
+  FastFourierTransform fft;
+  int frameSize;
+  int hopSize;
+  Window window;
+  FloatArray synthesis; // normalised synthesis window
+  FloatArray frame; // time domain frame, free for use as scratch by the processing steps
+  ComplexFloatArray spectrum;
+  FloatArray overlap;
+  CircularFloatBuffer* input;
+  int steps; // number of spectral processing steps
+  int position; // samples into the current hop
+  int stage; // next stage to run on the current frame
+  bool pending; // a frame is being processed
+
+  /**
+   * Scale the synthesis window so that the sum of the analysis times synthesis windows
+   * of all overlapping frames is one at every sample.
+   */
+  void normalise(){
+    for(int n=0; n<hopSize; ++n){
+      float sum = 0;
+      for(int i=n; i<frameSize; i+=hopSize)
+	sum += window[i]*window[i];
+      float scale = sum > 0 ? 1.0f/sum : 0.0f;
+      for(int i=n; i<frameSize; i+=hopSize)
+	synthesis[i] = window[i]*scale;
+    }
+  }
+
+  /**
+   * Get the number of stages per frame: analysis, processing steps and synthesis.
+   */
+  int getStages(){
+    return steps+2;
+  }
+
+  void runStage(int s){
+    if(s == 0){
+      frame.multiply(window);
+      fft.fft(frame, spectrum);
+    }else if(s <= steps){
+      processStep(spectrum, s-1);
+    }else{
+      fft.ifft(spectrum, frame);
+      frame.multiply(synthesis);
+    }
+  }
+
+  /**
+   * Run the stages that are due up to sample @param until of the current hop.
+   */
+  void schedule(int until){
+    int stages = getStages();
+    while(pending && stage < stages && stage*hopSize/stages < until)
+      runStage(stage++);
+  }
+
+  /**
+   * Complete a hop: output the frame that has been processed, and start on the next one.
+   */
+  void nextHop(){
+    schedule(hopSize);
+    memmove((float*)overlap, (float*)overlap+hopSize, (frameSize-hopSize)*sizeof(float));
+    overlap.subArray(frameSize-hopSize, hopSize).clear();
+    if(pending)
+      overlap.add(frame);
+    input->read(frame, 0);
+    pending = true;
+    stage = 0;
+    position = 0;
+  }
+
+public:
+  /**
+   * @param aFrameSize FFT size, see FastFourierTransform::isSupportedSize()
+   * @param aHopSize number of samples between frames, at most aFrameSize
+   * @param type analysis and synthesis window
+   */
+  ShortTimeFourierTransform(int aFrameSize, int aHopSize, Window::WindowType type = Window::HannWindow)
+    : frameSize(aFrameSize), hopSize(aHopSize), steps(1) {
+    ASSERT(hopSize > 0 && hopSize <= frameSize, "Invalid hop size");
+    fft.init(frameSize);
+    window = Window::create(type, frameSize);
+    synthesis = FloatArray::create(frameSize);
+    frame = FloatArray::create(frameSize);
+    spectrum = ComplexFloatArray::create(frameSize/2);
+    overlap = FloatArray::create(frameSize);
+    input = CircularFloatBuffer::create(frameSize);
+    normalise();
+    reset();
+  }
+
+  virtual ~ShortTimeFourierTransform(){
+    Window::destroy(window);
+    FloatArray::destroy(synthesis);
+    FloatArray::destroy(frame);
+    ComplexFloatArray::destroy(spectrum);
+    FloatArray::destroy(overlap);
+    CircularFloatBuffer::destroy(input);
+  }
+
+  virtual void reset(){
+    input->clear();
+    input->reset();
+    overlap.clear();
+    position = 0;
+    stage = 0;
+    pending = false;
+  }
+
+  int getFrameSize(){
+    return frameSize;
+  }
+
+  int getHopSize(){
+    return hopSize;
+  }
+
+  /**
+   * Get the delay from input to output, in samples.
+   */
+  int getLatency(){
+    return frameSize + hopSize;
+  }
+
+  /**
+   * Called once for each frame, with the packed spectrum as returned by FastFourierTransform::fft().
+   * Changes are resynthesised. The default implementation leaves the spectrum unchanged.
+   */
+  virtual void processSpectrum(ComplexFloatArray bins){}
+
+  /**
+   * Called for each processing step of a frame, in order.
+   * The default implementation calls processSpectrum() in a single step.
+   * @param step from 0 to the number of steps minus one
+   */
+  virtual void processStep(ComplexFloatArray bins, int step){
+    processSpectrum(bins);
+  }
+
+  /**
+   * Process a block of samples, of any size.
+   * @param in input samples
+   * @param out output samples, may be the same array as the input
+   */
+  void process(FloatArray in, FloatArray out){
+    ASSERT(out.getSize() >= in.getSize(), "Output array too small");
+    int size = in.getSize();
+    int pos = 0;
+    while(pos < size){
+      int len = min(size-pos, hopSize-position);
+      input->write(in.subArray(pos, len));
+      schedule(position+len);
+      overlap.subArray(position, len).copyTo(out.subArray(pos, len));
+      position += len;
+      pos += len;
+      if(position == hopSize)
+	nextHop();
+    }
+  }
+
+  static ShortTimeFourierTransform* create(int frameSize, int hopSize, Window::WindowType type = Window::HannWindow){
+    return new ShortTimeFourierTransform(frameSize, hopSize, type);
+  }
+
+  static void destroy(ShortTimeFourierTransform* obj){
+    delete obj;
+  }
+};
+
+#endif /* __ShortTimeFourierTransform_h__ */
@@ -0,0 +1,226 @@
+#ifndef __VoiceAllocator_h__
+#define __VoiceAllocator_h__
+
+#include <stdint.h>
+#include "FloatArray.h"
+#include "Patch.h"
+
+/**
+ * Polyphonic voice management for MIDI note events.
+ * Holds N voices of VoiceType in an array, allocates them to notes, and renders all
+ * voices that are playing into one output buffer. Voices are called directly, so
+ * VoiceType needs no virtual methods, but it must be default constructible and have:
+ *   void noteOn(uint8_t note, uint16_t velocity); // also used to retrigger a stolen voice
+ *   void noteOff();
+ *   bool isActive(); // false when the voice has finished its release
+ *   void render(FloatArray output); // add a block of samples to output
+ * The allocator keeps the note and state of each voice, so idle voices are skipped
+ * without calling them.
+ *
+ * Note events are queued with their sample offset from buttonChanged(), and applied at
+ * that offset within the next rendered block: voices are rendered in segments between
+ * consecutive events.
+ * When all voices are in use, a new note takes a voice according to the allocation
+ * policy: the next voice in turn, the voice with the oldest note, or the voice with
+ * the lowest note. Voices that are released are always taken before voices that are held.
+ */
+template<class VoiceType, int N>
+class VoiceAllocator {
+public:
+  typedef enum AllocationPolicy {
+    RoundRobinAllocation,
+    OldestAllocation,
+    LowestAllocation
+  } AllocationPolicy;
+private:
+  typedef enum VoiceState {
+    IdleVoice,
+    ReleasedVoice,
+    HeldVoice
+  } VoiceState;
+  struct NoteEvent {
+    uint8_t note;
+    uint16_t velocity; // zero for note off
+    uint16_t offset;
+  };
+  static const int MAX_EVENTS = 32;
+  VoiceType voices[N];
+  uint8_t notes[N];
+  uint8_t states[N];
+  uint32_t stamps[N]; // order in which voices were allocated
+  NoteEvent events[MAX_EVENTS];
+  int eventCount;
+  uint32_t counter;
+  int next;
+  AllocationPolicy policy;
+
+  int allocate(uint8_t note){
+    // a note that is already playing retriggers its voice
+    for(int i=0; i<N; ++i)
+      if(states[i] != IdleVoice && notes[i] == note)
+	return i;
+    int voice = -1;
+    if(policy == RoundRobinAllocation){
+      // the first idle voice in turn, then the first released voice in turn
+      for(int state=IdleVoice; state<HeldVoice && voice < 0; ++state){
+	for(int i=0; i<N && voice < 0; ++i){
+	  int j = (next+i) % N;
+	  if(states[j] == state)
+	    voice = j;
+	}
+      }
+      if(voice < 0)
+	voice = next;
+      next = (voice+1) % N;
+    }else{
+      voice = 0;
+      for(int i=1; i<N; ++i)
+	if(isPreferred(i, voice))
+	  voice = i;
+    }
+    return voice;
+  }
+
+  /* true if voice a should be taken before voice b */
+  bool isPreferred(int a, int b){
+    if(states[a] != states[b])
+      return states[a] < states[b];
+    if(policy == LowestAllocation && states[a] != IdleVoice)
+      return notes[a] < notes[b];
+    return stamps[a] < stamps[b];
+  }
+
+  void apply(NoteEvent& event){
+    if(event.velocity){
+      int voice = allocate(event.note);
+      notes[voice] = event.note;
+      states[voice] = HeldVoice;
+      stamps[voice] = counter++;
+      voices[voice].noteOn(event.note, event.velocity);
+    }else{
+      for(int i=0; i<N; ++i){
+	if(states[i] == HeldVoice && notes[i] == event.note){
+	  states[i] = ReleasedVoice;
+	  voices[i].noteOff();
+	}
+      }
+    }
+  }
+
+  void render(FloatArray output){
+    for(int i=0; i<N; ++i){
+      if(states[i] != IdleVoice){
+	voices[i].render(output);
+	if(states[i] == ReleasedVoice && !voices[i].isActive())
+	  states[i] = IdleVoice;
+      }
+    }
+  }
+
+public:
+  VoiceAllocator() : eventCount(0), counter(0), next(0), policy(RoundRobinAllocation) {
+    for(int i=0; i<N; ++i){
+      notes[i] = 0;
+      states[i] = IdleVoice;
+      stamps[i] = 0;
+    }
+  }
+
+  void setPolicy(AllocationPolicy value){
+    policy = value;
+  }
+
+  VoiceType& getVoice(int index){
+    return voices[index];
+  }
+
+  int getNumberOfVoices(){
+    return N;
+  }
+
+  /** number of voices that are held or releasing */
+  int getNumberOfActiveVoices(){
+    int count = 0;
+    for(int i=0; i<N; ++i)
+      count += states[i] != IdleVoice;
+    return count;
+  }
+
+  /** true if @param note is held by a voice */
+  bool isNoteOn(uint8_t note){
+    for(int i=0; i<N; ++i)
+      if(states[i] == HeldVoice && notes[i] == note)
+	return true;
+    return false;
+  }
+
+  /**
+   * Queue a note on, or a note off if @param velocity is zero,
+   * at @param samples into the next block.
+   */
+  void noteOn(uint8_t note, uint16_t velocity, uint16_t samples = 0){
+    if(eventCount == MAX_EVENTS){
+      // queue full: apply the oldest event early
+      apply(events[0]);
+      for(int i=1; i<eventCount; ++i)
+	events[i-1] = events[i];
+      eventCount--;
+    }
+    // keep events sorted by offset, in order of arrival for equal offsets
+    int i = eventCount++;
+    while(i > 0 && events[i-1].offset > samples){
+      events[i] = events[i-1];
+      i--;
+    }
+    events[i].note = note;
+    events[i].velocity = velocity;
+    events[i].offset = samples;
+  }
+
+  void noteOff(uint8_t note, uint16_t samples = 0){
+    noteOn(note, 0, samples);
+  }
+
+  /** release all held notes immediately */
+  void allNotesOff(){
+    for(int i=0; i<N; ++i){
+      if(states[i] == HeldVoice){
+	states[i] = ReleasedVoice;
+	voices[i].noteOff();
+      }
+    }
+  }
+
+  /**
+   * Handle a note event from Patch::buttonChanged().
+   * @return true if the button is a MIDI note
+   */
+  bool buttonChanged(PatchButtonId bid, uint16_t value, uint16_t samples){
+    if(bid < MIDI_NOTE_BUTTON)
+      return false;
+    noteOn(bid - MIDI_NOTE_BUTTON, value, samples);
+    return true;
+  }
+
+  /**
+   * Apply queued note events and render all active voices.
+   * @param output is cleared, and the voices added to it
+   */
+  void process(FloatArray output){
+    output.clear();
+    int start = 0;
+    for(int e=0; e<eventCount; ++e){
+      int offset = min((int)events[e].offset, (int)output.getSize());
+      if(offset > start){
+	render(output.subArray(start, offset-start));
+	start = offset;
+      }
+      apply(events[e]);
+    }
+    eventCount = 0;
+    if(start < (int)output.getSize())
+      render(output.subArray(start, output.getSize()-start));
+  }
+};
+
+#endif /* __VoiceAllocator_h__ */
@@ -36,13 +36,11 @@ VoltsPerOctave::VoltsPerOctave(float o, float m)
 
 void VoltsPerOctave::getFrequency(FloatArray samples, FloatArray output){
   ASSERT(output.getSize() >= samples.getSize(), "Output buffer too short");
-  // todo: block based implementation
-  // samples.subtract(offset, output);
-  // samples.multiply(multiplier, output);
-  // for(int i=0; i<samples.getSize(); ++i)
-  //   output[i] = voltsToHertz(output[i]);
-  for(int i=0; i<samples.getSize(); ++i)
-    output[i] = getFrequency(samples[i]);
+  // 440*2^((sample-offset)*multiplier+tune) = 2^(sample*multiplier + log2(440)+tune-offset*multiplier)
+  output = output.subArray(0, samples.getSize());
+  samples.multiply(multiplier, output);
+  output.add(8.78135971f + tune - offset*multiplier);
+  output.fastExp2();
 }
 
 void VoltsPerOctave::getFrequency(FloatArray samples){
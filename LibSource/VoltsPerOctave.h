@@ -36,7 +36,14 @@ public:
   float hertzToVolts(float hertz){
     return log2f(hertz/440.0f);
   }
+  /**
+   * Convert a block of samples to frequencies in Hz.
+   * The offset, multiplier, tune and 440Hz reference are combined into one multiply and
+   * add over the block, followed by FloatArray::fastExp2(). Frequencies are within 0.01
+   * cents of the exact conversion.
+   */
   void getFrequency(FloatArray samples, FloatArray output);
+  /** Convert a block of samples to frequencies in Hz, in place */
   void getFrequency(FloatArray samples);
 };
 
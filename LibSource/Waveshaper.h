@@ -0,0 +1,329 @@
+#ifndef __Waveshaper_h__
+#define __Waveshaper_h__
+
+#include "FloatArray.h"
+#include "message.h"
+#include "Oversampler.h"
+
+/**
+ * Waveshaper with antiderivative antialiasing (ADAA).
+ * Instead of applying the curve f(x) to each sample, first order ADAA outputs the mean
+ * value of f over the line between consecutive input samples:
+ *   y[n] = (F1(x[n]) - F1(x[n-1])) / (x[n] - x[n-1])
+ * where F1 is the antiderivative of f. Second order ADAA uses the second antiderivative F2
+ * over three samples. Each order suppresses aliasing by about 10dB, with a
+ * delay of half a sample (first order) or one sample (second order).
+ * See "Antiderivative Antialiasing for Memoryless Nonlinearities" by Bilbao et al, 2017.
+ *
+ * All curves are stored as tables: f at evenly spaced points with linear interpolation,
+ * and the exact values of F1 and F2 at the same points. Between table points the
+ * antiderivatives are evaluated as polynomials. Difference quotients within a segment are
+ * calculated without subtraction, and across segments relative to a nearby table point,
+ * which avoids the cancellation errors that ADAA otherwise suffers from in single precision.
+ * Outside the table range, the curve keeps the value at the end of the table.
+ *
+ * The waveshaper can run inside an Oversampler, for higher frequencies and drive levels:
+ * second order ADAA at 2x oversampling aliases about as little as 4x oversampling alone.
+ */
+class Waveshaper {
+public:
+  typedef enum WaveshaperCurve {
+    TanhCurve, // hyperbolic tangent
+    HardClipCurve, // clipped to [-1, 1]
+    TubeCurve // asymmetric: tanh for positive input, tanh(2x)/2 for negative input
+  } WaveshaperCurve;
+private:
+  FloatArray f;
+  FloatArray f1;
+  FloatArray f2;
+  float start; // input value of the first table point
+  float step; // input distance between table points
+  float scale; // 1/step
+  int last; // index of the last table point
+  int order;
+  float x1, x2; // previous inputs
+  Oversampler* oversampler;
+  FloatArray buffer;
+
+  /* table segment of x: from -1 before the table, to last after it */
+  inline int getSegment(float x){
+    float pos = (x - start)*scale;
+    if(pos < 0)
+      return -1;
+    if(pos >= last)
+      return last;
+    return (int)pos;
+  }
+  /* offset of x from the table point at the start of its segment */
+  inline float getOffset(float x, int segment){
+    return x - (start + (segment < 0 ? 0 : segment)*step);
+  }
+  inline float getSlope(int segment){
+    return segment < 0 || segment >= last ? 0.0f : (f[segment+1] - f[segment])*scale;
+  }
+  inline float curve(float x){
+    int j = getSegment(x);
+    int i = j < 0 ? 0 : j;
+    return f[i] + getSlope(j)*getOffset(x, j);
+  }
+  /* F1 and F2 at table point i, relative to F1 at point r and the tangent of F2 at point r */
+  inline void getTablePoint(int r, int i, float& d1, float& d2){
+    if(i == r){
+      d1 = d2 = 0;
+    }else if(i == r+1){
+      // integrate over one segment, to avoid cancellation
+      d1 = step*(f[r] + f[i])*0.5f;
+      d2 = step*step*(2*f[r] + f[i])*(1.0f/6);
+    }else if(i == r-1){
+      d1 = -step*(f[i] + f[r])*0.5f;
+      d2 = step*step*(2*f[r] + f[i])*(1.0f/6);
+    }else{
+      d1 = f1[i] - f1[r];
+      d2 = f2[i] - f2[r] - f1[r]*(i - r)*step;
+    }
+  }
+
+  /* F1(x) - F1 at point r */
+  inline float antiderivative(float x, int r){
+    int j = getSegment(x);
+    int i = j < 0 ? 0 : j;
+    float t = getOffset(x, j);
+    float d1, d2;
+    getTablePoint(r, i, d1, d2);
+    return d1 + t*(f[i] + t*0.5f*getSlope(j));
+  }
+
+  /* (F1(a) - F1(b))/(a - b) */
+  float difference1(float a, float b){
+    float hi = a > b ? a : b;
+    float lo = a > b ? b : a;
+    int jh = getSegment(hi);
+    int jl = getSegment(lo);
+    float th = getOffset(hi, jh);
+    if(jh == jl){
+      float tl = getOffset(lo, jl);
+      return f[jh < 0 ? 0 : jh] + getSlope(jh)*(th + tl)*0.5f;
+    }
+    // integrate from lo to the end of its segment, then to the start of the segment of hi
+    int right = jl+1;
+    float end = start + right*step;
+    float sum = (end - lo)*(curve(lo) + f[right])*0.5f;
+    float d1, d2;
+    getTablePoint(right, jh, d1, d2);
+    sum += d1;
+    sum += th*(f[jh] + th*0.5f*getSlope(jh));
+    return sum/(hi - lo);
+  }
+
+  /* (F2(a) - F2(b))/(a - b) - F1 at point r */
+  float difference2(float a, float b, int r){
+    float hi = a > b ? a : b;
+    float lo = a > b ? b : a;
+    int jh = getSegment(hi);
+    int jl = getSegment(lo);
+    float th = getOffset(hi, jh);
+    float tl = getOffset(lo, jl);
+    int il = jl < 0 ? 0 : jl;
+    float sl = getSlope(jl);
+    float d1l, d2l;
+    getTablePoint(r, il, d1l, d2l);
+    if(jh == jl)
+      return d1l + (th + tl)*0.5f*f[il] + (th*th + th*tl + tl*tl)*sl*(1.0f/6);
+    // F2 from lo to the end of its segment, in factored form
+    int right = jl+1;
+    float end = jl < 0 ? 0 : step;
+    float sum = (end - tl)*(d1l + (end + tl)*0.5f*f[il] + (end*end + end*tl + tl*tl)*sl*(1.0f/6));
+    // then to the start of the segment of hi
+    float d1r, d2r, d1h, d2h;
+    getTablePoint(r, right, d1r, d2r);
+    getTablePoint(r, jh, d1h, d2h);
+    if(jh == right+1){
+      float d1, d2;
+      getTablePoint(right, jh, d1, d2);
+      sum += d2 + d1r*step;
+    }else{
+      sum += d2h - d2r;
+    }
+    sum += th*(d1h + th*(0.5f*f[jh] + th*getSlope(jh)*(1.0f/6)));
+    return sum/(hi - lo);
+  }
+
+  inline float shape(float x){
+    float y;
+    int j;
+    switch(order){
+    case 0:
+      y = curve(x);
+      break;
+    case 1:
+      y = difference1(x, x1);
+      break;
+    default:
+      j = getSegment(x);
+      if(j == getSegment(x1) && j == getSegment(x2)){
+	// all three points on one straight line of the curve: the result is the value at their mean
+	float t = (x + x1 + x2)*(1.0f/3);
+	y = f[j < 0 ? 0 : j] + getSlope(j)*getOffset(t, j);
+      }else if(fabsf(x - x2) > 0.001f){
+	// relative to the table point below x[n-1], so that large values of F1 cancel out
+	int r = getSegment(x1);
+	r = r < 0 ? 0 : r;
+	y = 2*(difference2(x, x1, r) - difference2(x1, x2, r))/(x - x2);
+      }else{
+	// x[n] and x[n-2] are too close: expand around their mean
+	float mean = (x + x2)*0.5f;
+	float delta = mean - x1;
+	if(fabsf(delta) > 0.001f){
+	  int r = getSegment(x1);
+	  r = r < 0 ? 0 : r;
+	  y = 2*(antiderivative(mean, r) - difference2(mean, x1, r))/delta;
+	}else{
+	  y = curve((mean + x1)*0.5f);
+	}
+      }
+      break;
+    }
+    x2 = x1;
+    x1 = x;
+    return y;
+  }
+
+  void shape(FloatArray input, FloatArray output){
+    for(int n=0; n<input.getSize(); ++n)
+      output[n] = shape(input[n]);
+  }
+
+public:
+  /**
+   * @param points array of **size** values of the curve, for inputs evenly spaced from
+   * **minimum** to **maximum**
+   * @param aOrder antialiasing order: 0 for none, 1 or 2
+   */
+  Waveshaper(float* points, int size, float minimum, float maximum, int aOrder)
+    : start(minimum), step((maximum-minimum)/(size-1)), scale((size-1)/(maximum-minimum)),
+      last(size-1), order(aOrder), x1(0), x2(0), oversampler(NULL) {
+    ASSERT(size > 1 && maximum > minimum, "Invalid waveshaper table");
+    f = FloatArray::create(size);
+    f1 = FloatArray::create(size);
+    f2 = FloatArray::create(size);
+    f.copyFrom(points, size);
+    // integrate the piecewise linear curve exactly, from zero at the point closest to 0
+    int mid = (int)(-start*scale + 0.5f);
+    mid = mid < 0 ? 0 : (mid > last ? last : mid);
+    double h = step;
+    double a1 = 0, a2 = 0;
+    f1[mid] = f2[mid] = 0;
+    for(int i=mid; i<last; ++i){
+      a2 += h*a1 + h*h*(2*f[i] + f[i+1])/6;
+      a1 += h*(f[i] + f[i+1])/2;
+      f1[i+1] = a1;
+      f2[i+1] = a2;
+    }
+    a1 = a2 = 0;
+    for(int i=mid; i>0; --i){
+      a1 -= h*(f[i-1] + f[i])/2;
+      a2 -= h*a1 + h*h*(2*f[i-1] + f[i])/6;
+      f1[i-1] = a1;
+      f2[i-1] = a2;
+    }
+  }
+
+  ~Waveshaper(){
+    FloatArray::destroy(f);
+    FloatArray::destroy(f1);
+    FloatArray::destroy(f2);
+    if(oversampler)
+      Oversampler::destroy(oversampler);
+    FloatArray::destroy(buffer);
+  }
+
+  int getOrder(){
+    return order;
+  }
+
+  void reset(){
+    x1 = x2 = 0;
+    if(oversampler)
+      oversampler->reset();
+  }
+
+  /**
+   * Run the waveshaper at a multiple of the sampling rate.
+   * @param factor oversampling factor: 1 for none, 2, 4, 8 or 16
+   * @param blocksize maximum number of samples per block, at the base sampling rate
+   */
+  void setOversampling(int factor, int blocksize, Oversampler::Quality quality = Oversampler::MEDIUM_QUALITY){
+    if(oversampler)
+      Oversampler::destroy(oversampler);
+    FloatArray::destroy(buffer);
+    oversampler = NULL;
+    buffer = FloatArray();
+    if(factor > 1){
+      oversampler = Oversampler::create(factor, quality, blocksize);
+      buffer = FloatArray::create(blocksize*factor);
+    }
+  }
+
+  /** get the value of the curve, without antialiasing or oversampling */
+  float getCurve(float x){
+    return curve(x);
+  }
+
+  /** process a single sample, without oversampling */
+  float process(float x){
+    return shape(x);
+  }
+
+  /** process a block of samples, which may be in place */
+  void process(FloatArray input, FloatArray output){
+    if(oversampler){
+      int factor = oversampler->getFactor();
+      FloatArray up = buffer.subArray(0, input.getSize()*factor);
+      oversampler->upsample(input, up);
+      shape(up, up);
+      oversampler->downsample(up, output.subArray(0, input.getSize()));
+    }else{
+      shape(input, output);
+    }
+  }
+
+  /**
+   * Create a waveshaper with a built in curve.
+   * @param order antialiasing order: 0 for none, 1 or 2
+   */
+  static Waveshaper* create(WaveshaperCurve curve, int order = 1){
+    if(curve == HardClipCurve){
+      // exact with table points at the corners
+      float points[] = {-1, -1, 0, 1, 1};
+      return new Waveshaper(points, 5, -2, 2, order);
+    }
+    // tanh is flat to within 2e-7 beyond +/-8
+    const int size = 1025;
+    float* points = new float[size];
+    for(int i=0; i<size; ++i){
+      float x = -8 + 16.0f*i/(size-1);
+      if(curve == TubeCurve && x < 0)
+	points[i] = tanhf(2*x)*0.5f;
+      else
+	points[i] = tanhf(x);
+    }
+    Waveshaper* shaper = new Waveshaper(points, size, -8, 8, order);
+    delete[] points;
+    return shaper;
+  }
+
+  /**
+   * Create a waveshaper from a lookup table.
+   * @param table values of the curve for inputs evenly spaced from -1 to 1
+   * @param order antialiasing order: 0 for none, 1 or 2
+   */
+  static Waveshaper* create(FloatArray table, int order = 1){
+    return new Waveshaper(table.getData(), table.getSize(), -1, 1, order);
+  }
+
+  static void destroy(Waveshaper* shaper){
+    delete shaper;
+  }
+};
+
+#endif /* __Waveshaper_h__ */
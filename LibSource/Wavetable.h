@@ -0,0 +1,159 @@
+#ifndef __Wavetable_h__
+#define __Wavetable_h__
+
+#include "FloatArray.h"
+#include "ComplexFloatArray.h"
+#include "FastFourierTransform.h"
+#include "Interpolator.h"
+#include "message.h"
+
+/**
+ * A set of single cycle waveforms, each stored as band limited mipmaps: one table per octave.
+ * Level l is band limited in the frequency domain to the harmonics up to size/2^(l+2), and
+ * can be played without aliasing up to sampleRate*2^(l+1)/size. The last level only has
+ * the fundamental.
+ * Level 0 has the full table size, and every following level is half the size of the one
+ * before, down to 256 samples: tables are oversampled by at least two for interpolation,
+ * and the small tables of the higher levels much more.
+ * A 2048 sample table keeps 512 harmonics, enough for the full audio bandwidth from 40Hz
+ * at 48kHz sample rate, and its mipmaps take 5376 samples.
+ */
+class Wavetable {
+private:
+  int size;
+  int levels;
+  int waveforms;
+  FloatArray data;
+  int* offsets; // first sample of each level, from the start of a waveform
+
+public:
+  /**
+   * Create an empty wavetable.
+   * @param tableSize size of the largest table, a power of two
+   * @param numberOfWaveforms number of waveforms, for morphing
+   */
+  Wavetable(int tableSize, int numberOfWaveforms = 1)
+    : size(tableSize), levels(log2i(tableSize)-1), waveforms(numberOfWaveforms) {
+    ASSERT(size >= 4 && (size & (size-1)) == 0, "Table size must be a power of two");
+    offsets = new int[levels+1];
+    offsets[0] = 0;
+    for(int l=0; l<levels; ++l)
+      offsets[l+1] = offsets[l] + max(size>>l, min(size, 256));
+    data = FloatArray::create(waveforms*offsets[levels]);
+    data.clear();
+  }
+
+  ~Wavetable(){
+    FloatArray::destroy(data);
+    delete[] offsets;
+  }
+
+  /**
+   * Set a waveform from its packed spectrum, as returned by FastFourierTransform::fft().
+   * @param index the waveform to set
+   * @param spectrum spectrum of a table of the full size, with at least size/2 elements
+   */
+  void setSpectrum(int index, ComplexFloatArray spectrum){
+    ASSERT(index < waveforms && spectrum.getSize() >= size/2, "Invalid waveform");
+    FastFourierTransform fft;
+    ComplexFloatArray bins = ComplexFloatArray::create(size/2);
+    for(int l=0; l<levels; ++l){
+      FloatArray table = getTable(index, l);
+      int len = table.getSize();
+      int harmonics = max(1, size>>(l+2));
+      bins.clear();
+      bins.subArray(0, harmonics+1).copyFrom(spectrum.subArray(0, harmonics+1));
+      bins[0].im = 0;
+      fft.init(len);
+      fft.ifft(bins, table);
+      table.multiply((float)len/size);
+    }
+    ComplexFloatArray::destroy(bins);
+  }
+
+  /**
+   * Set a waveform from a single cycle.
+   * @param index the waveform to set
+   * @param cycle one period of the waveform, of any size: a cycle that is not of the
+   * full table size is resampled to it with cubic interpolation
+   */
+  void setWaveform(int index, FloatArray cycle){
+    ASSERT(cycle.getSize() >= 4, "Cycle too short");
+    FastFourierTransform fft(size);
+    ComplexFloatArray spectrum = ComplexFloatArray::create(size/2);
+    FloatArray input = FloatArray::create(size);
+    if(cycle.getSize() == size)
+      input.copyFrom(cycle);
+    else
+      resample(cycle, input);
+    fft.fft(input, spectrum);
+    setSpectrum(index, spectrum);
+    FloatArray::destroy(input);
+    ComplexFloatArray::destroy(spectrum);
+  }
+
+  /**
+   * Get the table of a waveform at a mipmap level.
+   */
+  FloatArray getTable(int index, int level){
+    return data.subArray(index*offsets[levels] + offsets[level], offsets[level+1] - offsets[level]);
+  }
+
+  int getSize(){
+    return size;
+  }
+
+  /**
+   * Resample a single cycle of any size to @param output, wrapping around at the ends.
+   */
+  static void resample(FloatArray cycle, FloatArray output){
+    HermiteKernel hermite;
+    int len = cycle.getSize();
+    for(int i=0; i<output.getSize(); ++i){
+      float position = (float)i*len/output.getSize();
+      int j = (int)position;
+      float x[4];
+      for(int k=0; k<4; ++k)
+	x[k] = cycle[(j + k - 1 + len) % len];
+      output[i] = hermite.interpolate(x + 1, position - j);
+    }
+  }
+
+  int getNumberOfLevels(){
+    return levels;
+  }
+
+  int getNumberOfWaveforms(){
+    return waveforms;
+  }
+
+  /**
+   * Create a wavetable from consecutive single cycle waveforms.
+   * @param cycles one or more periods of @param tableSize samples each
+   */
+  static Wavetable* create(FloatArray cycles, int tableSize){
+    Wavetable* table = new Wavetable(tableSize, cycles.getSize()/tableSize);
+    for(int i=0; i<table->getNumberOfWaveforms(); ++i)
+      table->setWaveform(i, cycles.subArray(i*tableSize, tableSize));
+    return table;
+  }
+
+  /**
+   * Create a wavetable with a sine wave, built directly from its spectrum.
+   */
+  static Wavetable* createSine(int tableSize){
+    Wavetable* table = new Wavetable(tableSize);
+    ComplexFloatArray spectrum = ComplexFloatArray::create(tableSize/2);
+    spectrum.clear();
+    spectrum[1].im = -tableSize/2;
+    table->setSpectrum(0, spectrum);
+    ComplexFloatArray::destroy(spectrum);
+    return table;
+  }
+
+  static void destroy(Wavetable* table){
+    delete table;
+  }
+};
+
+#endif /* __Wavetable_h__ */
@@ -1,50 +1,253 @@
 #include "WavetableOscillator.h"
+#include "Interpolator.h"
 #include "basicmaths.h"
 #include <stdint.h>
 
+// samples per pass of the block reads, with the scratch arrays on the stack
+#define WAVETABLE_CHUNK 32
+// mipmap levels of the largest table, of 2^24 samples, for frequency modulated blocks
+#define WAVETABLE_MAX_LEVELS 23
+
+/* the power of two table size that holds a cycle of @param size samples */
+static int getTableSize(int size){
+  int len = 4;
+  while(len < size)
+    len <<= 1;
+  return len;
+}
+
 WavetableOscillator* WavetableOscillator::create(float sr, int size) {
-  FloatArray wave = FloatArray::create(size);
-  for(int i=0; i<size; ++i)
-    wave[i] = sin(2*M_PI*i/(size-1));    
-  return new WavetableOscillator(sr, wave);
+  WavetableOscillator* osc = new WavetableOscillator(sr, Wavetable::createSine(size));
+  osc->ownsWavetable = true;
+  return osc;
+}
+
+WavetableOscillator* WavetableOscillator::create(float sr, Wavetable* wavetable) {
+  return new WavetableOscillator(sr, wavetable);
 }
 
 void WavetableOscillator::destroy(WavetableOscillator* osc){
-  FloatArray::destroy(osc->wave);
   delete osc;
 }
 
-WavetableOscillator::WavetableOscillator(float sr, const FloatArray wavetable): 
+WavetableOscillator::WavetableOscillator(float sr, const FloatArray wave):
   multiplier(1.0/sr),
-  wave(wavetable),
-  acc(0.0), inc(0.1)
-{}
+  wavetable(new Wavetable(getTableSize(wave.getSize()))),
+  ownsWavetable(true),
+  phase(0), increment(0), morph(0.0),
+  interpolation(LinearInterpolation) {
+  wavetable->setWaveform(0, wave);
+}
+
+WavetableOscillator::WavetableOscillator(float sr, Wavetable* table):
+  multiplier(1.0/sr),
+  wavetable(table),
+  ownsWavetable(false),
+  phase(0), increment(0), morph(0.0),
+  interpolation(LinearInterpolation) {}
+
+WavetableOscillator::~WavetableOscillator(){
+  if(ownsWavetable)
+    Wavetable::destroy(wavetable);
+}
 
 void WavetableOscillator::setSampleRate(float value){
   multiplier = 1.0/value;
 }
 
+uint32_t WavetableOscillator::getIncrement(float freq){
+  // cycles per sample, in 0.32 fixed point
+  return max(0.0f, min(0.5f, freq*multiplier))*4294967296.0f;
+}
+
 void WavetableOscillator::setFrequency(float freq){
-  //    inc = max(0.0, min(0.5, freq*multiplier));
-  inc = freq*multiplier;  
+  increment = getIncrement(freq);
+}
+
+void WavetableOscillator::setMorph(float value){
+  morph = max(0.0f, min(1.0f, value));
+}
+
+void WavetableOscillator::setInterpolation(InterpolationType value){
+  interpolation = value;
+}
+
+void WavetableOscillator::reset(){
+  phase = 0;
+}
+
+float WavetableOscillator::getSample(int waveform, int level, uint32_t phase){
+  FloatArray table = wavetable->getTable(waveform, level);
+  int bits = log2i(table.getSize());
+  uint32_t mask = table.getSize()-1;
+  uint32_t index = phase >> (32-bits);
+  float frac = (phase << bits)*(1.0f/4294967296.0f);
+  if(interpolation == LinearInterpolation)
+    return LinearKernel().read(table.getData(), mask, index, frac);
+  return HermiteKernel().read(table.getData(), mask, index, frac);
+}
+
+void WavetableOscillator::getLevel(uint32_t increment, int& level, float& blend){
+  // the mipmap level is the octave of increment*size, with the position within
+  // the octave, linear in the increment, used to crossfade to the next level
+  int levels = wavetable->getNumberOfLevels();
+  level = 0;
+  blend = 0;
+  if(increment > 0){
+    int zeros = __builtin_clz(increment);
+    level = log2i(wavetable->getSize()) - 1 - zeros;
+    blend = (increment << (zeros+1))*(1.0f/4294967296.0f);
+    if(level < 0){
+      level = 0;
+      blend = 0;
+    }else if(level >= levels-1){
+      level = levels-1;
+      blend = 0;
+    }
+  }
+}
+
+float WavetableOscillator::getSample(uint32_t phase, uint32_t increment){
+  int level;
+  float blend;
+  getLevel(increment, level, blend);
+  float position = morph*(wavetable->getNumberOfWaveforms()-1);
+  int waveform = (int)position;
+  float fraction = position - waveform;
+  float sample = getSample(waveform, level, phase);
+  if(blend > 0)
+    sample += blend*(getSample(waveform, level+1, phase) - sample);
+  if(fraction > 0){
+    float next = getSample(waveform+1, level, phase);
+    if(blend > 0)
+      next += blend*(getSample(waveform+1, level+1, phase) - next);
+    sample += fraction*(next - sample);
+  }
+  return sample;
 }
 
 float WavetableOscillator::getSample(float phase){
-  uint32_t size = wave.getSize();
-  uint32_t index = phase*(size-1);
-  index = min(index, size-1);
-  return wave[index];
+  return getSample((uint32_t)(int64_t)(phase*4294967296.0f), (uint32_t)0);
 }
 
 float WavetableOscillator::getNextSample(){
-  float s = getSample(acc);
-  acc += inc;
-  if(acc > 1.0)
-    acc -= 1.0;
+  float s = getSample(phase, increment);
+  phase += increment;
   return s;
 }
 
-void WavetableOscillator::getSamples(FloatArray samples){
-  for(int i=0; i<samples.getSize();++i)
-    samples[i] = getNextSample();
+template<class Kernel>
+void WavetableOscillator::getSamples(const Kernel& kernel, int waveform, int level, uint32_t phase,
+				     FloatArray output, FloatArray indices, FloatArray fractions){
+  FloatArray table = wavetable->getTable(waveform, level);
+  int bits = log2i(table.getSize());
+  for(int i=0; i<output.getSize(); ++i){
+    indices[i] = phase >> (32-bits);
+    fractions[i] = (phase << bits)*(1.0f/4294967296.0f);
+    phase += increment;
+  }
+  kernel.read(table, indices, fractions, output);
+}
+
+template<class Kernel>
+void WavetableOscillator::getSamples(const Kernel& kernel, FloatArray output){
+  // the levels and waveforms are the same for the whole block: each table is read in one
+  // pass, then the tables are crossfaded in the same order as in getSample()
+  int level;
+  float blend;
+  getLevel(increment, level, blend);
+  float position = morph*(wavetable->getNumberOfWaveforms()-1);
+  int waveform = (int)position;
+  float fraction = position - waveform;
+  float idx[WAVETABLE_CHUNK], frac[WAVETABLE_CHUNK], tmp[WAVETABLE_CHUNK], nxt[WAVETABLE_CHUNK];
+  for(int k=0; k<output.getSize(); k+=WAVETABLE_CHUNK){
+    int n = min(WAVETABLE_CHUNK, output.getSize()-k);
+    FloatArray indices(idx, n), fractions(frac, n), other(tmp, n), next(nxt, n);
+    FloatArray sample = output.subArray(k, n);
+    getSamples(kernel, waveform, level, phase, sample, indices, fractions);
+    if(blend > 0){
+      getSamples(kernel, waveform, level+1, phase, other, indices, fractions);
+      for(int i=0; i<n; ++i)
+	sample[i] += blend*(other[i] - sample[i]);
+    }
+    if(fraction > 0){
+      getSamples(kernel, waveform+1, level, phase, next, indices, fractions);
+      if(blend > 0){
+	getSamples(kernel, waveform+1, level+1, phase, other, indices, fractions);
+	for(int i=0; i<n; ++i)
+	  next[i] += blend*(other[i] - next[i]);
+      }
+      for(int i=0; i<n; ++i)
+	sample[i] += fraction*(next[i] - sample[i]);
+    }
+    phase += increment*n;
+  }
+}
+
+void WavetableOscillator::getSamples(FloatArray output){
+  if(interpolation == LinearInterpolation)
+    getSamples(LinearKernel(), output);
+  else
+    getSamples(HermiteKernel(), output);
+}
+
+static inline uint32_t getIndex(uint32_t phase, int bits){
+  return phase >> (32-bits);
+}
+
+static inline float getFraction(uint32_t phase, int bits){
+  return (phase << bits)*(1.0f/4294967296.0f);
+}
+
+template<class Kernel>
+void WavetableOscillator::getSamples(const Kernel& kernel, FloatArray output, FloatArray frequency){
+  // the waveforms are the same for the whole block, and their tables are looked up once:
+  // only the levels and the blend follow the frequency of each sample
+  int levels = wavetable->getNumberOfLevels();
+  ASSERT(levels <= WAVETABLE_MAX_LEVELS, "Wavetable too large");
+  float position = morph*(wavetable->getNumberOfWaveforms()-1);
+  int waveform = (int)position;
+  float fraction = position - waveform;
+  const float* tables[2][WAVETABLE_MAX_LEVELS];
+  uint32_t masks[WAVETABLE_MAX_LEVELS];
+  int bits[WAVETABLE_MAX_LEVELS];
+  for(int l=0; l<levels; ++l){
+    FloatArray table = wavetable->getTable(waveform, l);
+    tables[0][l] = table.getData();
+    tables[1][l] = fraction > 0 ? wavetable->getTable(waveform+1, l).getData() : NULL;
+    masks[l] = table.getSize()-1;
+    bits[l] = log2i(table.getSize());
+  }
+  float* out = output.getData();
+  for(int i=0; i<output.getSize(); ++i){
+    uint32_t inc = getIncrement(frequency[i]);
+    int level;
+    float blend;
+    getLevel(inc, level, blend);
+    uint32_t index = getIndex(phase, bits[level]);
+    float frac = getFraction(phase, bits[level]);
+    float sample = kernel.read(tables[0][level], masks[level], index, frac);
+    float next = 0;
+    if(fraction > 0)
+      next = kernel.read(tables[1][level], masks[level], index, frac);
+    if(blend > 0){
+      int upper = level+1;
+      index = getIndex(phase, bits[upper]);
+      frac = getFraction(phase, bits[upper]);
+      sample += blend*(kernel.read(tables[0][upper], masks[upper], index, frac) - sample);
+      if(fraction > 0)
+	next += blend*(kernel.read(tables[1][upper], masks[upper], index, frac) - next);
+    }
+    if(fraction > 0)
+      sample += fraction*(next - sample);
+    out[i] = sample;
+    phase += inc;
+  }
+}
+
+void WavetableOscillator::getSamples(FloatArray output, FloatArray frequency){
+  if(interpolation == LinearInterpolation)
+    getSamples(LinearKernel(), output, frequency);
+  else
+    getSamples(HermiteKernel(), output, frequency);
 }
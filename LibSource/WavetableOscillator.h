@@ -3,21 +3,73 @@
 
 #include "FloatArray.h"
 #include "Oscillator.h"
+#include "Wavetable.h"
 
+/**
+ * Band limited wavetable oscillator.
+ * Plays the mipmap levels of a Wavetable, crossfading between the two levels that
+ * are closest to the current frequency without aliasing. Tables are read with linear
+ * or cubic (Hermite) interpolation from Interpolator.h, and the oscillator can morph
+ * between the waveforms of the wavetable. At a fixed frequency, blocks are read one
+ * table at a time. The phase is a 32 bit fixed point value that wraps around on overflow.
+ */
 class WavetableOscillator : public Oscillator {
+public:
+  typedef enum InterpolationType {
+    LinearInterpolation,
+    CubicInterpolation
+  } InterpolationType;
 private:
   float multiplier;
-  FloatArray wave;
-  float acc;
-  float inc;
+  Wavetable* wavetable;
+  bool ownsWavetable;
+  uint32_t phase;
+  uint32_t increment;
+  float morph;
+  InterpolationType interpolation;
+  uint32_t getIncrement(float freq);
+  void getLevel(uint32_t increment, int& level, float& blend);
+  float getSample(uint32_t phase, uint32_t increment);
+  float getSample(int waveform, int level, uint32_t phase);
+  template<class Kernel>
+  void getSamples(const Kernel& kernel, int waveform, int level, uint32_t phase, FloatArray output,
+		  FloatArray indices, FloatArray fractions);
+  template<class Kernel>
+  void getSamples(const Kernel& kernel, FloatArray output);
+  template<class Kernel>
+  void getSamples(const Kernel& kernel, FloatArray output, FloatArray frequency);
 public:
+  /**
+   * Create an oscillator playing a single cycle waveform of any size.
+   * The waveform is copied to a new Wavetable, resampled to the next power of two
+   * if its size is not one.
+   */
   WavetableOscillator(float sr, const FloatArray wavetable);
+  /**
+   * Create an oscillator playing a Wavetable, which may be shared with other oscillators.
+   */
+  WavetableOscillator(float sr, Wavetable* wavetable);
+  ~WavetableOscillator();
   void setSampleRate(float value);
   void setFrequency(float freq);
+  /** set the waveform to play: from 0 for the first waveform to 1 for the last */
+  void setMorph(float value);
+  void setInterpolation(InterpolationType value);
+  void reset();
+  /** get a sample of the full bandwidth waveform, at @param phase from 0 to 1 */
   float getSample(float phase);
   float getNextSample();
-  void getSamples(FloatArray samples);
+  /* put a block of output samples into @param output */
+  void getSamples(FloatArray output);
+  /* put a block of output samples into @param output,
+     with frequency in Hz determined by samples in @param frequency */
+  void getSamples(FloatArray output, FloatArray frequency);
+  Wavetable* getWavetable(){
+    return wavetable;
+  }
+  /** create an oscillator with a sine wavetable of @param size samples */
   static WavetableOscillator* create(float sr, int size);
+  static WavetableOscillator* create(float sr, Wavetable* wavetable);
   static void destroy(WavetableOscillator* osc);
 };
 
@@ -78,11 +78,44 @@
      return (31 - __builtin_clz (x));
    }
 
+   /**
+    * atan2 from an 11th order minimax polynomial for atan on [0, 1], within 2e-6 radians.
+    * Single precision only, for block processing on the Cortex-M4 FPU.
+    */
+   static inline float polynomial_atan2f(float y, float x){
+     float ax = fabsf(x);
+     float ay = fabsf(y);
+     float mx = max(ax, ay);
+     if(mx == 0.0f)
+       return 0.0f;
+     float a = min(ax, ay)/mx;
+     float s = a*a;
+     float r = a*(0.99997726f + s*(-0.33262347f + s*(0.19354346f + s*(-0.11643287f + s*(0.05265332f + s*-0.01172120f)))));
+     if(ay > ax)
+       r = (float)(M_PI/2) - r;
+     if(x < 0)
+       r = (float)M_PI - r;
+     return y < 0 ? -r : r;
+   }
+
 #ifdef __cplusplus
 }
 #endif
 
 
+/* Place static arrays in a specific memory region, for example:
+ * static float buffer[1<<18] EXTERNAL_RAM; // external SDRAM, slower but large
+ * static float state[64] CCM_RAM; // core coupled memory, fastest, not usable for DMA
+ * Both sections are NOLOAD: contents are not initialised.
+ */
+#ifdef ARM_CORTEX
+#define EXTERNAL_RAM __attribute__ ((section (".extdata")))
+#define CCM_RAM __attribute__ ((section (".ccmdata")))
+#else
+#define EXTERNAL_RAM
+#define CCM_RAM
+#endif
+
 #define malloc(x) pvPortMalloc(x)
 #define calloc(x, y) pvPortMalloc(x*y)
 #define free(x) vPortFree(x)
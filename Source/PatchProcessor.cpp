@@ -5,6 +5,7 @@
 #include <string.h>
 #include "ProgramVector.h"
 #include "SmoothValue.h"
+#include "FastFourierTransform.h"
 
 PatchProcessor::PatchProcessor() 
   : patch(NULL), bufferCount(0), parameterCount(0) {
@@ -29,6 +30,8 @@ void PatchProcessor::clear(){
   parameterCount = 0;
   delete patch;
   patch = NULL;
+  // empty the cache of FFT tables, transforms that are still in use keep theirs
+  FastFourierPlan::clear();
   index = -1;
   // memset(parameterNames, 0, sizeof(parameterNames));
 }
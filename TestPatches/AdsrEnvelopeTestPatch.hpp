@@ -0,0 +1,113 @@
+#include "TestPatch.hpp"
+#include "Envelope.h"
+
+class AdsrEnvelopeTestPatch : public TestPatch {
+public:
+  AdsrEnvelopeTestPatch(){
+    const float sr = 48000;
+    FloatArray output = FloatArray::create(getBlockSize());
+    {
+      TEST("linear");
+      AdsrEnvelope env(sr);
+      env.setAttack(0.01); // 480 samples
+      env.setDecay(0.01); // 240 samples to sustain
+      env.setSustain(0.5);
+      env.setRelease(0.01); // 240 samples from sustain
+      env.gate(true, 20);
+      env.getEnvelope(output);
+      CHECK_EQUAL(output[19], 0.0f);
+      CHECK_CLOSE(output[20], 1.0/480, 0.00001);
+      CHECK_CLOSE(output[20+99], 100.0/480, 0.00001);
+      for(int i=0; i<3; ++i)
+	env.getEnvelope(output);
+      // attack ends at sample 499, decay at 739
+      CHECK_CLOSE(output[499-384], 1.0, 0.00001);
+      CHECK_CLOSE(output[500-384], 1.0-1.0/480, 0.00001);
+      env.getEnvelope(output);
+      env.getEnvelope(output);
+      CHECK_EQUAL(output[739-640], 0.5f);
+      CHECK_EQUAL(output.getMinValue(), 0.5f);
+      env.gate(false);
+      env.getEnvelope(output);
+      CHECK(!env.isIdle());
+      // release ends at sample 768+239
+      env.getEnvelope(output);
+      CHECK(output[1006-896] > 0);
+      CHECK_EQUAL(output[1007-896], 0.0f);
+      CHECK_EQUAL(output[1008-896], 0.0f);
+      CHECK(env.isIdle());
+    }
+    {
+      TEST("exponential");
+      AdsrEnvelope env(sr);
+      env.setCurve(AdsrEnvelope::kExponential);
+      env.setAttack(0.01);
+      env.setDecay(0.01);
+      env.setSustain(0.0);
+      env.setRelease(0.01);
+      env.trigger();
+      FloatArray envelope = FloatArray::create(1024);
+      env.getEnvelope(envelope);
+      // attack reaches full scale in the set time, with a convex curve
+      CHECK_EQUAL(envelope.getMaxIndex(), 479);
+      CHECK_EQUAL(envelope[479], 1.0f);
+      CHECK(envelope[239] > 0.6);
+      // decay falls fast, then slowly
+      CHECK(envelope[479+120] < 0.25);
+      CHECK(envelope[479+120] > 0);
+      // triggered: reaches sustain, then releases without a gate off
+      CHECK(env.isIdle());
+      FloatArray::destroy(envelope);
+    }
+    {
+      TEST("block and single samples");
+      AdsrEnvelope::EnvelopeCurve curves[] = {AdsrEnvelope::kLinear, AdsrEnvelope::kExponential};
+      for(int c=0; c<2; ++c){
+	AdsrEnvelope block(sr);
+	AdsrEnvelope single(sr);
+	AdsrEnvelope* envs[] = {&block, &single};
+	for(int i=0; i<2; ++i){
+	  envs[i]->setCurve(curves[c]);
+	  envs[i]->setAttack(0.005);
+	  envs[i]->setDecay(0.02);
+	  envs[i]->setSustain(0.3);
+	  envs[i]->setRelease(0.004);
+	}
+	// gate changes at sample offsets, including during attack and release,
+	// with at most one change per block
+	int times[] = {5, 200, 300, 1030, 1200, 1900};
+	float maxerr = 0;
+	int t = 0;
+	for(int b=0; b<20; ++b){
+	  int start = b*output.getSize();
+	  for(int e=0; e<6; ++e)
+	    if(times[e] >= start && times[e] < start+output.getSize())
+	      block.gate(e%2 == 0, times[e]-start);
+	  block.getEnvelope(output);
+	  for(int i=0; i<output.getSize(); ++i){
+	    for(int e=0; e<6; ++e)
+	      if(times[e] == t)
+		single.gate(e%2 == 0);
+	    float error = fabsf(output[i] - single.getNextSample());
+	    maxerr = max(maxerr, error);
+	    t++;
+	  }
+	}
+	CHECK(maxerr < 0.00001);
+	CHECK(block.isIdle());
+      }
+    }
+    {
+      TEST("attenuate");
+      AdsrEnvelope env(sr);
+      env.setAttack(0.01);
+      env.gate(true);
+      output.setAll(2);
+      env.attenuate(output);
+      CHECK_CLOSE(output[0], 2.0/480, 0.00001);
+      CHECK_CLOSE(output[99], 200.0/480, 0.00001);
+      CHECK_CLOSE(env.getLevel(), 128.0/480, 0.00001);
+    }
+    FloatArray::destroy(output);
+  }
+};
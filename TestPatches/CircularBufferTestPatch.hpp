@@ -0,0 +1,111 @@
+#include "TestPatch.hpp"
+#include "DelayLine.h"
+
+class CircularBufferTestPatch : public TestPatch {
+public:
+  CircularBufferTestPatch(){
+    {
+      TEST("create");
+      CircularFloatBuffer* buffer = CircularFloatBuffer::create(1000);
+      CHECK_EQUAL((int)buffer->getSize(), 1024);
+      CHECK_EQUAL(buffer->read(0), 0.0f);
+      CHECK_EQUAL(buffer->read(1023), 0.0f);
+      CircularFloatBuffer::destroy(buffer);
+    }
+    {
+      TEST("block write and read");
+      CircularFloatBuffer* buffer = CircularFloatBuffer::create(64);
+      FloatArray block = FloatArray::create(24);
+      FloatArray output = FloatArray::create(24);
+      int count = 0;
+      bool correct = true;
+      for(int n=0; n<20; ++n){ // wraps around several times
+	for(int i=0; i<block.getSize(); ++i)
+	  block[i] = count++;
+	buffer->write(block);
+	// read back the same block
+	buffer->read(output, 0);
+	for(int i=0; i<output.getSize(); ++i)
+	  correct &= output[i] == block[i];
+	// and a block delayed by 30 samples
+	if(count > 54){
+	  buffer->read(output, 30);
+	  for(int i=0; i<output.getSize(); ++i)
+	    correct &= output[i] == block[i] - 30;
+	}
+	// single sample reads
+	correct &= buffer->read(0) == count-1;
+	if(count > 40)
+	  correct &= buffer->read(40) == count-41;
+      }
+      CHECK(correct);
+      CHECK_EQUAL((int)buffer->getWriteIndex(), count);
+      FloatArray::destroy(block);
+      FloatArray::destroy(output);
+      CircularFloatBuffer::destroy(buffer);
+    }
+    {
+      TEST("Q15 storage");
+      CircularShortBuffer* buffer = CircularShortBuffer::create(128);
+      FloatArray block = FloatArray::create(100);
+      FloatArray output = FloatArray::create(100);
+      for(int n=0; n<5; ++n){
+	for(int i=0; i<block.getSize(); ++i)
+	  block[i] = sinf(0.1*(n*100+i))*0.9;
+	buffer->write(block);
+	buffer->read(output, 0);
+	float maxerr = 0;
+	for(int i=0; i<output.getSize(); ++i)
+	  maxerr = max(maxerr, fabsf(output[i]-block[i]));
+	CHECK(maxerr < 0.0001);
+	CHECK_CLOSE(buffer->readFloat(0), block[99], 0.0001);
+      }
+      FloatArray::destroy(block);
+      FloatArray::destroy(output);
+      CircularShortBuffer::destroy(buffer);
+    }
+    {
+      TEST("fractional delay");
+      const int blocksize = getBlockSize();
+      const float f = 0.01; // cycles per sample
+      FloatDelayLine* delay = FloatDelayLine::create(1024);
+      FloatArray input = FloatArray::create(blocksize);
+      FloatArray delays = FloatArray::create(blocksize);
+      FloatArray linear = FloatArray::create(blocksize);
+      FloatArray hermite = FloatArray::create(blocksize);
+      FloatArray allpass = FloatArray::create(blocksize);
+      float linerr = 0, hermerr = 0, aperr = 0;
+      for(int n=0; n<8; ++n){
+	for(int i=0; i<blocksize; ++i){
+	  int t = n*blocksize+i;
+	  input[i] = sinf(2*M_PI*f*t);
+	  delays[i] = 100 + 5*sinf(2*M_PI*t/2000.0f); // slowly modulated
+	}
+	delay->write(input);
+	delay->readLinear(linear, delays);
+	delay->readHermite(hermite, delays);
+	delay->readAllpass(allpass, delays);
+	if(n > 1){
+	  for(int i=0; i<blocksize; ++i){
+	    float expected = sinf(2*M_PI*f*(n*blocksize+i-delays[i]));
+	    linerr = max(linerr, fabsf(linear[i]-expected));
+	    hermerr = max(hermerr, fabsf(hermite[i]-expected));
+	    aperr = max(aperr, fabsf(allpass[i]-expected));
+	  }
+	}
+      }
+      CHECK(linerr < 0.001);
+      CHECK(hermerr < 0.00001);
+      CHECK(aperr < 0.001);
+      // single sample taps match the block taps for the most recent sample
+      CHECK_CLOSE(delay->readLinear(delays[blocksize-1]), linear[blocksize-1], 0.000001);
+      CHECK_CLOSE(delay->readHermite(delays[blocksize-1]), hermite[blocksize-1], 0.000001);
+      FloatArray::destroy(input);
+      FloatArray::destroy(delays);
+      FloatArray::destroy(linear);
+      FloatArray::destroy(hermite);
+      FloatArray::destroy(allpass);
+      FloatDelayLine::destroy(delay);
+    }
+  }
+};
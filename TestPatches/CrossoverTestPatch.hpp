@@ -0,0 +1,83 @@
+#include "TestPatch.hpp"
+#include "Crossover.h"
+
+class CrossoverTestPatch : public TestPatch {
+public:
+  CrossoverTestPatch(){
+    const float sr = 48000;
+    int blocksize = getBlockSize();
+    {
+      TEST("reconstruction");
+      const int bands = 4;
+      const int blocks = 16;
+      Crossover* crossover = Crossover::create(bands, sr);
+      crossover->setFrequency(0, 200);
+      crossover->setFrequency(1, 1200);
+      crossover->setFrequency(2, 6000);
+      // reference: input through the allpass responses of all crossover points
+      LinkwitzRileySection reference[bands-1];
+      float refstate[2*(bands-1)] = {};
+      for(int i=0; i<bands-1; ++i)
+	reference[i].setFrequency(crossover->getFrequency(i)/sr);
+      AudioBuffer* buffer = AudioBuffer::create(bands, blocksize);
+      FloatArray input = FloatArray::create(blocksize);
+      FloatArray expected = FloatArray::create(blocksize);
+      FloatArray sum = FloatArray::create(blocksize);
+      FloatArray output = FloatArray::create(blocksize*blocks);
+      float maxerr = 0;
+      for(int b=0; b<blocks; ++b){
+	input.noise();
+	input.copyTo(expected);
+	for(int i=0; i<bands-1; ++i)
+	  reference[i].allpass(expected, refstate+2*i, blocksize);
+	crossover->process(input, *buffer);
+	crossover->combine(*buffer, sum);
+	for(int i=0; i<blocksize; ++i)
+	  maxerr = max(maxerr, fabsf(sum[i]-expected[i]));
+      }
+      CHECK(maxerr < 0.0001);
+      // flat magnitude response of the sum
+      float freqs[] = {50, 200, 700, 1200, 3000, 6000, 12000};
+      for(int f=0; f<7; ++f){
+	crossover->reset();
+	for(int b=0; b<blocks; ++b){
+	  for(int i=0; i<blocksize; ++i)
+	    input[i] = sinf(2*M_PI*freqs[f]/sr*(b*blocksize+i));
+	  crossover->process(input, *buffer);
+	  crossover->combine(*buffer, output.subArray(b*blocksize, blocksize));
+	}
+	CHECK_CLOSE(getAmplitude(output.subArray(blocksize*4, blocksize*(blocks-4)), freqs[f]/sr), 1.0, 0.01);
+      }
+      delete buffer;
+      FloatArray::destroy(input);
+      FloatArray::destroy(expected);
+      FloatArray::destroy(sum);
+      FloatArray::destroy(output);
+      Crossover::destroy(crossover);
+    }
+    {
+      TEST("band split");
+      const int blocks = 32;
+      Crossover* crossover = Crossover::create(2, sr);
+      crossover->setFrequency(0, 1000);
+      AudioBuffer* buffer = AudioBuffer::create(2, blocksize*blocks);
+      FloatArray input = FloatArray::create(blocksize*blocks);
+      float freqs[] = {100, 1000, 10000};
+      float low[] = {1.0, 0.5, 0.0};
+      for(int f=0; f<3; ++f){
+	crossover->reset();
+	for(int i=0; i<input.getSize(); ++i)
+	  input[i] = sinf(2*M_PI*freqs[f]/sr*i);
+	crossover->process(input, *buffer);
+	FloatArray lo = buffer->getSamples(0).subArray(blocksize*8, blocksize*(blocks-8));
+	FloatArray hi = buffer->getSamples(1).subArray(blocksize*8, blocksize*(blocks-8));
+	// LR4 is -6dB at the crossover frequency
+	CHECK_CLOSE(getAmplitude(lo, freqs[f]/sr), low[f], 0.01);
+	CHECK_CLOSE(getAmplitude(hi, freqs[f]/sr), 1.0-low[f], 0.01);
+      }
+      delete buffer;
+      FloatArray::destroy(input);
+      Crossover::destroy(crossover);
+    }
+  }
+};
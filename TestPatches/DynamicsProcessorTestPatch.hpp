@@ -0,0 +1,167 @@
+#include "TestPatch.hpp"
+#include "DynamicsProcessor.h"
+#include "RandomGenerator.h"
+
+class DynamicsProcessorTestPatch : public TestPatch {
+public:
+  DynamicsProcessorTestPatch(){
+    const float sr = 48000;
+    const int blocksize = getBlockSize();
+    {
+      TEST("sliding maximum");
+      RandomGenerator random;
+      SlidingMaximum* hold = SlidingMaximum::create(64);
+      const int size = 2000;
+      FloatArray x = FloatArray::create(size);
+      FloatArray y = FloatArray::create(size);
+      random.fill(x);
+      int windows[] = {1, 5, 37, 64};
+      for(int w=0; w<4; ++w){
+	hold->reset();
+	hold->setWindow(windows[w]);
+	hold->process(x, y);
+	bool equal = true;
+	for(int i=0; i<size; ++i){
+	  float expected = x[i];
+	  for(int j=max(0, i-windows[w]+1); j<i; ++j)
+	    expected = max(expected, x[j]);
+	  equal &= y[i] == expected;
+	}
+	CHECK(equal);
+      }
+      FloatArray::destroy(x);
+      FloatArray::destroy(y);
+      SlidingMaximum::destroy(hold);
+    }
+    // reduction of a ratio of 1000, for a signal 20dB over the threshold
+    const float limited = powf(10, -20*0.999/20);
+    AudioBuffer* buffer = AudioBuffer::create(2, blocksize);
+    FloatArray left = buffer->getSamples(0);
+    FloatArray right = buffer->getSamples(1);
+    {
+      TEST("static curve");
+      DynamicsProcessor* comp = DynamicsProcessor::create(1, sr, blocksize);
+      comp->setThreshold(-20);
+      comp->setRatio(4);
+      comp->setAttack(0.001);
+      comp->setRelease(0.001);
+      // 0.1 is -20dB, 1.0 is 0dB: 20dB over the threshold, 15dB reduction
+      float levels[] = {0.05, 0.1, 1.0};
+      float reductions[] = {0, 0, 15};
+      for(int i=0; i<3; ++i){
+	for(int b=0; b<20; ++b){
+	  left.setAll(levels[i]);
+	  comp->process(*buffer);
+	}
+	CHECK_CLOSE(comp->getGainReduction(), reductions[i], 0.01);
+	CHECK_CLOSE(left[blocksize-1], levels[i]*powf(10, -reductions[i]/20), 0.0001);
+      }
+      // soft knee: 3dB over the threshold with a 6dB knee
+      comp->setKnee(6);
+      for(int b=0; b<20; ++b){
+	left.setAll(powf(10, -17.0f/20));
+	comp->process(*buffer);
+      }
+      CHECK_CLOSE(comp->getGainReduction(), 0.75*6*6/12, 0.01);
+      DynamicsProcessor::destroy(comp);
+    }
+    {
+      TEST("lookahead limiter");
+      DynamicsProcessor* limiter = DynamicsProcessor::create(2, sr, blocksize, 0.01);
+      limiter->setThreshold(-6);
+      limiter->setRatio(1000);
+      limiter->setLookahead(0.005);
+      limiter->setRelease(0.05);
+      CHECK_EQUAL(limiter->getLatency(), 240);
+      RandomGenerator random;
+      const int blocks = 100;
+      FloatArray input = FloatArray::create(blocksize*blocks);
+      FloatArray output = FloatArray::create(blocksize*blocks);
+      random.fill(input, -0.1, 0.1);
+      // sudden peaks up to +6dB
+      for(int i=1000; i<input.getSize(); i+=1500)
+	input[i] = 2;
+      for(int i=5000; i<5100; ++i)
+	input[i] = 1.5*sinf(i*0.3);
+      for(int b=0; b<blocks; ++b){
+	input.subArray(b*blocksize, blocksize).copyTo(left);
+	input.subArray(b*blocksize, blocksize).copyTo(right);
+	limiter->process(*buffer);
+	left.copyTo(output.subArray(b*blocksize, blocksize));
+      }
+      // -6dB, plus 1/1000 of the 12dB overshoot
+      float limit = powf(10, (-6 + 0.012)/20);
+      CHECK(output.getMaxValue() <= limit*1.0001);
+      CHECK(output.getMinValue() >= -limit*1.0001);
+      // quiet signal passes unchanged, delayed
+      CHECK_CLOSE(output[240+500], input[500], 0.000001);
+      CHECK(limiter->getGainReduction() > 0);
+      FloatArray::destroy(input);
+      FloatArray::destroy(output);
+      DynamicsProcessor::destroy(limiter);
+    }
+    {
+      TEST("sidechain");
+      DynamicsProcessor* ducker = DynamicsProcessor::create(1, sr, blocksize);
+      AudioBuffer* sidechain = AudioBuffer::create(1, blocksize);
+      ducker->setThreshold(-20);
+      ducker->setRatio(1000);
+      ducker->setAttack(0);
+      for(int b=0; b<10; ++b){
+	left.setAll(0.5);
+	sidechain->getSamples(0).setAll(1);
+	ducker->process(*buffer, *sidechain);
+      }
+      CHECK_CLOSE(left[0], 0.5*limited, 0.0001);
+      delete sidechain;
+      DynamicsProcessor::destroy(ducker);
+    }
+    {
+      TEST("stereo link");
+      DynamicsProcessor* comp = DynamicsProcessor::create(2, sr, blocksize);
+      comp->setThreshold(-20);
+      comp->setRatio(1000);
+      comp->setAttack(0);
+      for(int b=0; b<10; ++b){
+	left.setAll(1);
+	right.setAll(0.01);
+	comp->process(*buffer);
+      }
+      CHECK_CLOSE(left[0], limited, 0.0001);
+      CHECK_CLOSE(right[0], 0.01*limited, 0.00001);
+      comp->setStereoLink(false);
+      for(int b=0; b<10; ++b){
+	left.setAll(1);
+	right.setAll(0.01);
+	comp->process(*buffer);
+      }
+      CHECK_CLOSE(left[0], limited, 0.0001);
+      CHECK_CLOSE(right[0], 0.01, 0.0001);
+      DynamicsProcessor::destroy(comp);
+    }
+    {
+      TEST("gate");
+      DynamicsProcessor* gate = DynamicsProcessor::create(1, sr, blocksize);
+      gate->setMode(DynamicsProcessor::ExpanderMode);
+      gate->setDetector(DynamicsProcessor::RmsDetector);
+      gate->setThreshold(-40);
+      gate->setRatio(100);
+      gate->setRange(60);
+      gate->setAttack(0);
+      gate->setRelease(0.01);
+      for(int b=0; b<100; ++b){
+	left.setAll(0.001);
+	gate->process(*buffer);
+      }
+      CHECK_CLOSE(gate->getGainReduction(), 60, 0.01);
+      CHECK_CLOSE(left[0], 0.000001, 0.0000001);
+      for(int b=0; b<100; ++b){
+	left.setAll(0.1);
+	gate->process(*buffer);
+      }
+      CHECK_CLOSE(left[0], 0.1, 0.0001);
+      DynamicsProcessor::destroy(gate);
+    }
+    delete buffer;
+  }
+};
@@ -10,7 +10,7 @@ public:
     {
       TEST("FastExp");
       float maxPerc = 0;
-      float threshold = 0.02; // maximum relative error accepted
+      float threshold = 0.6; // maximum relative error accepted, in percent, with the 6 bit table
       int errs = 0;
       int tests = 0;
       for(int n = -90; n < 90; n++){
@@ -28,6 +28,25 @@ public:
       debugMessage("threshold / errors %:", threshold, 100.0f*errs/tests);
       debugMessage("max error %:", maxPerc);
     }
+    {
+      TEST("FloatArray::fastExp");
+      float maxPerc = 0;
+      float threshold = 0.001; // maximum relative error accepted
+      FloatArray x = FloatArray::create(1000);
+      FloatArray y = FloatArray::create(1000);
+      for(int n = 0; n < x.getSize(); n++)
+        x[n] = rand()/(float)RAND_MAX * 175 - 87;
+      x.fastExp(y);
+      for(int n = 0; n < x.getSize(); n++){
+        float exact = expf(x[n]);
+        float perc = fabsf(y[n] - exact)/exact * 100;
+        maxPerc = maxPerc > perc ? maxPerc : perc;
+      }
+      CHECK(maxPerc<threshold);
+      debugMessage("max error %:", maxPerc);
+      FloatArray::destroy(x);
+      FloatArray::destroy(y);
+    }
   }
 };
 
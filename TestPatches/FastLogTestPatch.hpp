@@ -10,7 +10,7 @@ public:
     {
       TEST("FastLog");
       float maxPerc = 0;
-      float threshold = 0.00025; // maximum relative error accepted
+      float threshold = 1.0; // maximum relative error accepted, in percent, with the 6 bit table
       int errs = 0;
       int tests = 0;
       for(int n = 10; n <= 10000; n++){
@@ -28,6 +28,42 @@ public:
       debugMessage("threshold / errors %:", threshold, 100.0f*errs/tests);
       debugMessage("max error %:", maxPerc);
     }
+    {
+      TEST("FloatArray::fastLog");
+      float maxErr = 0;
+      float threshold = 0.000002; // maximum absolute error accepted
+      FloatArray x = FloatArray::create(1000);
+      FloatArray y = FloatArray::create(1000);
+      for(int n = 0; n < x.getSize(); n++)
+        x[n] = expf(rand()/(float)RAND_MAX * 40 - 20);
+      x.fastLog(y);
+      for(int n = 0; n < x.getSize(); n++){
+        float err = fabsf(y[n] - logf(x[n]));
+        maxErr = maxErr > err ? maxErr : err;
+      }
+      CHECK(maxErr<threshold);
+      debugMessage("max error:", maxErr);
+      FloatArray::destroy(x);
+      FloatArray::destroy(y);
+    }
+    {
+      TEST("FloatArray::gainToDb");
+      float maxErr = 0;
+      float threshold = 0.00002; // maximum absolute error in dB accepted
+      FloatArray x = FloatArray::create(1000);
+      FloatArray y = FloatArray::create(1000);
+      for(int n = 0; n < x.getSize(); n++)
+        x[n] = (rand()/(float)RAND_MAX * 2 - 1) * 4;
+      x.gainToDb(y);
+      for(int n = 0; n < x.getSize(); n++){
+        float err = fabsf(y[n] - 20*log10f(fabsf(x[n])));
+        maxErr = maxErr > err ? maxErr : err;
+      }
+      CHECK(maxErr<threshold);
+      debugMessage("max error dB:", maxErr);
+      FloatArray::destroy(x);
+      FloatArray::destroy(y);
+    }
   }
 };
 
@@ -10,7 +10,7 @@ public:
     {
       TEST("FastPow");
       float maxPerc = 0;
-      float threshold = 0.04; // maximum relative error accepted
+      float threshold = 0.6; // maximum relative error accepted, in percent, with the 6 bit table
       int errs = 0;
       int tests = 0;
       for(int n = -1000; n < 1000; n++){
@@ -30,6 +30,47 @@ public:
       debugMessage("threshold / errors %:", threshold, 100.0f*errs/tests);
       debugMessage("max error %:", maxPerc);
     }
+    {
+      TEST("FloatArray::fastPow");
+      float maxPerc = 0;
+      float threshold = 0.002; // maximum relative error accepted
+      FloatArray x = FloatArray::create(100);
+      FloatArray y = FloatArray::create(100);
+      for(int n = -1000; n < 1000; n += 10){
+        float exponent = n*10/1000.f;
+        for(int i = 0; i < x.getSize(); i++)
+          x[i] = rand()/(float)RAND_MAX * 10;
+        x.fastPow(exponent, y);
+        for(int i = 0; i < x.getSize(); i++){
+          float exact = powf(x[i], exponent);
+          float perc = fabsf(y[i] - exact)/exact * 100;
+          maxPerc = maxPerc > perc ? maxPerc : perc;
+        }
+      }
+      CHECK(maxPerc<threshold);
+      debugMessage("max error %:", maxPerc);
+      FloatArray::destroy(x);
+      FloatArray::destroy(y);
+    }
+    {
+      TEST("FloatArray::dbToGain");
+      float maxPerc = 0;
+      float threshold = 0.0005; // maximum relative error accepted
+      FloatArray x = FloatArray::create(1000);
+      FloatArray y = FloatArray::create(1000);
+      for(int n = 0; n < x.getSize(); n++)
+        x[n] = rand()/(float)RAND_MAX * 240 - 120;
+      x.dbToGain(y);
+      for(int n = 0; n < x.getSize(); n++){
+        float exact = powf(10, x[n]/20);
+        float perc = fabsf(y[n] - exact)/exact * 100;
+        maxPerc = maxPerc > perc ? maxPerc : perc;
+      }
+      CHECK(maxPerc<threshold);
+      debugMessage("max error %:", maxPerc);
+      FloatArray::destroy(x);
+      FloatArray::destroy(y);
+    }
   }
 };
 
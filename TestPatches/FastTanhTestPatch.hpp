@@ -0,0 +1,69 @@
+#include "TestPatch.hpp"
+
+#ifdef atan2f
+#undef atan2f
+#endif
+
+class FastTanhTestPatch : public TestPatch {
+public:
+  FastTanhTestPatch(){
+    FloatArray x = FloatArray::create(1000);
+    FloatArray y = FloatArray::create(1000);
+    {
+      TEST("FloatArray::fastTanh");
+      float maxErr = 0;
+      float threshold = 0.000003; // maximum absolute error accepted
+      for(int n = 0; n < x.getSize(); n++)
+        x[n] = rand()/(float)RAND_MAX * 20 - 10;
+      x.fastTanh(y);
+      for(int n = 0; n < x.getSize(); n++){
+        float err = fabsf(y[n] - tanhf(x[n]));
+        maxErr = maxErr > err ? maxErr : err;
+      }
+      CHECK(maxErr<threshold);
+      debugMessage("max error:", maxErr);
+      x[0] = 100;
+      x[1] = -100;
+      x.fastTanh();
+      CHECK_EQUAL(x[0], 1.0f);
+      CHECK_EQUAL(x[1], -1.0f);
+    }
+    {
+      TEST("FloatArray::softclip");
+      for(int n = 0; n < x.getSize(); n++)
+        x[n] = n*4.0f/x.getSize() - 2;
+      x.softclip(y);
+      CHECK_EQUAL(y.getMaxValue(), 1.0f);
+      CHECK_EQUAL(y.getMinValue(), -1.0f);
+      CHECK_CLOSE(y[x.getSize()/2 + x.getSize()/8], 0.5*1.5 - 0.5*0.125, 0.00001);
+      bool monotonic = true;
+      for(int n = 1; n < x.getSize(); n++)
+        monotonic &= y[n] >= y[n-1];
+      CHECK(monotonic);
+    }
+    {
+      TEST("FloatArray::fastAtan2");
+      float maxErr = 0;
+      float threshold = 0.000002; // maximum absolute error in radians accepted
+      FloatArray angles = FloatArray::create(1000);
+      for(int n = 0; n < x.getSize(); n++){
+        x[n] = rand()/(float)RAND_MAX * 2 - 1;
+        y[n] = rand()/(float)RAND_MAX * 2 - 1;
+      }
+      x[0] = 0;
+      y[0] = 0;
+      x[1] = -1;
+      y[1] = 0;
+      y.fastAtan2(x, angles);
+      for(int n = 0; n < x.getSize(); n++){
+        float err = fabsf(angles[n] - atan2f(y[n], x[n]));
+        maxErr = maxErr > err ? maxErr : err;
+      }
+      CHECK(maxErr<threshold);
+      debugMessage("max error:", maxErr);
+      FloatArray::destroy(angles);
+    }
+    FloatArray::destroy(x);
+    FloatArray::destroy(y);
+  }
+};
@@ -0,0 +1,164 @@
+#include "TestPatch.hpp"
+#include "FdnReverb.h"
+
+class FdnReverbTestPatch : public TestPatch {
+public:
+  /* level in dB of left and right output over a window */
+  float getLevel(FloatArray left, FloatArray right, int offset, int length){
+    float l = left.subArray(offset, length).getPower();
+    float r = right.subArray(offset, length).getPower();
+    return 10*log10f((l + r)/length);
+  }
+  /* impulse response, processed in blocks */
+  void getImpulseResponse(FdnReverb* reverb, FloatArray left, FloatArray right, int blocksize){
+    FloatArray input = FloatArray::create(blocksize);
+    for(int i=0; i<left.getSize(); i+=blocksize){
+      input.clear();
+      if(i == 0)
+	input[0] = 1;
+      reverb->process(input, left.subArray(i, blocksize), right.subArray(i, blocksize));
+    }
+    FloatArray::destroy(input);
+  }
+  FdnReverbTestPatch(){
+    const float sr = 48000;
+    const int blocksize = 64;
+    FloatArray left = FloatArray::create(1<<17);
+    FloatArray right = FloatArray::create(1<<17);
+    {
+      TEST("decay time");
+      for(int lines=8; lines<=16; lines*=2){
+	FdnReverb* reverb = FdnReverb::create(lines, sr, blocksize);
+	reverb->setDecay(0.5);
+	reverb->setDamping(1);
+	getImpulseResponse(reverb, left, right, blocksize);
+	CHECK_EQUAL(left[0], 0.0f);
+	// 60dB down over 0.5 seconds
+	float early = getLevel(left, right, sr*0.2, sr*0.1);
+	float late = getLevel(left, right, sr*0.7, sr*0.1);
+	CHECK_CLOSE(early - late, 60, 3);
+	FdnReverb::destroy(reverb);
+      }
+    }
+    {
+      TEST("damping");
+      FdnReverb* reverb = FdnReverb::create(16, sr, blocksize);
+      reverb->setDecay(1);
+      reverb->setDamping(0.25);
+      getImpulseResponse(reverb, left, right, blocksize);
+      // high frequencies decay faster: compare the level of the first difference
+      FloatArray diff = FloatArray::create(left.getSize());
+      for(int i=1; i<left.getSize(); ++i)
+	diff[i] = left[i] - left[i-1];
+      float early = getLevel(diff, diff, sr*0.2, sr*0.1) - getLevel(left, left, sr*0.2, sr*0.1);
+      float late = getLevel(diff, diff, sr*0.7, sr*0.1) - getLevel(left, left, sr*0.7, sr*0.1);
+      CHECK(late < early - 6);
+      FloatArray::destroy(diff);
+      FdnReverb::destroy(reverb);
+    }
+    {
+      TEST("lossless");
+      // with infinite decay, the orthogonal matrices keep the energy constant
+      FdnReverb::MixingMatrix matrices[] = {FdnReverb::HadamardMatrix, FdnReverb::HouseholderMatrix};
+      for(int m=0; m<2; ++m){
+	FdnReverb* reverb = FdnReverb::create(16, sr, blocksize, 1, matrices[m]);
+	reverb->setDecay(100000);
+	reverb->setDamping(1);
+	getImpulseResponse(reverb, left, right, blocksize);
+	float early = getLevel(left, right, sr*0.2, sr*0.5);
+	float late = getLevel(left, right, sr*1.4, sr*0.5);
+	CHECK_CLOSE(early, late, 1);
+	FdnReverb::destroy(reverb);
+      }
+    }
+    {
+      TEST("block size");
+      // long blocks are split into chunks shorter than the shortest delay
+      FdnReverb* a = FdnReverb::create(8, sr, blocksize);
+      FdnReverb* b = FdnReverb::create(8, sr, 2048);
+      getImpulseResponse(a, left, right, blocksize);
+      FloatArray l = FloatArray::create(left.getSize());
+      FloatArray r = FloatArray::create(left.getSize());
+      getImpulseResponse(b, l, r, 2048);
+      l.subtract(left);
+      r.subtract(right);
+      CHECK(l.getRms() < 0.00001);
+      CHECK(r.getRms() < 0.00001);
+      FloatArray::destroy(l);
+      FloatArray::destroy(r);
+      FdnReverb::destroy(a);
+      FdnReverb::destroy(b);
+    }
+    {
+      TEST("memory placement");
+      int delaysize = FdnReverb::getDelayMemorySize(16, sr, 2);
+      int statesize = FdnReverb::getStateMemorySize(16, blocksize);
+      CHECK_EQUAL(delaysize, 16*8192);
+      CHECK_EQUAL(delaysize, FDN_DELAY_MEMORY_SIZE(16, 48000, 2));
+      CHECK_EQUAL(statesize, FDN_STATE_MEMORY_SIZE(16, 64));
+      CHECK_EQUAL(FdnReverb::getDelayMemorySize(8, 96000, 1), FDN_DELAY_MEMORY_SIZE(8, 96000, 1));
+      CHECK_EQUAL(FdnReverb::getDelayMemorySize(16, 44100, 3), FDN_DELAY_MEMORY_SIZE(16, 44100, 3));
+      // static memory sized at compile time
+      static float staticdelays[FDN_DELAY_MEMORY_SIZE(8, 48000, 1)] EXTERNAL_RAM;
+      static float staticstate[FDN_STATE_MEMORY_SIZE(8, 128)] CCM_RAM;
+      FdnReverb* c = FdnReverb::create(8, sr, blocksize, 1, staticdelays, staticstate);
+      CHECK_EQUAL(c->getNumberOfLines(), 8);
+      FdnReverb::destroy(c);
+      float* delays = new float[delaysize];
+      float* state = new float[statesize];
+      FdnReverb* a = FdnReverb::create(16, sr, blocksize, 2, delays, state);
+      FdnReverb* b = FdnReverb::create(16, sr, blocksize, 2);
+      a->setSize(2);
+      b->setSize(2);
+      getImpulseResponse(b, left, right, blocksize);
+      FloatArray l = FloatArray::create(left.getSize());
+      FloatArray r = FloatArray::create(left.getSize());
+      getImpulseResponse(a, l, r, blocksize);
+      l.subtract(left);
+      CHECK_EQUAL(l.getRms(), 0.0f);
+      FloatArray::destroy(l);
+      FloatArray::destroy(r);
+      FdnReverb::destroy(a);
+      FdnReverb::destroy(b);
+      delete[] delays;
+      delete[] state;
+    }
+    {
+      TEST("parameter changes");
+      // a steady sine through the reverb, with parameters changed abruptly halfway
+      FdnReverb* reverb = FdnReverb::create(16, sr, blocksize, 2);
+      reverb->setDecay(1);
+      FloatArray input = FloatArray::create(blocksize);
+      float steady = 0, changed = 0;
+      float last = 0;
+      for(int i=0; i<left.getSize(); i+=blocksize){
+	for(int j=0; j<blocksize; ++j)
+	  input[j] = sinf(2*M_PI*100*(i+j)/sr);
+	if(i == sr){
+	  reverb->setSize(2);
+	  reverb->setDecay(4);
+	  reverb->setDamping(0.1);
+	  reverb->setModulation(10, 1);
+	}
+	FloatArray l = left.subArray(i, blocksize);
+	reverb->process(input, l, right.subArray(i, blocksize));
+	for(int j=0; j<blocksize; ++j){
+	  // largest step between samples, relative to the level
+	  float step = fabsf(l[j] - last);
+	  last = l[j];
+	  if(i >= sr/2 && i < sr)
+	    steady = max(steady, step);
+	  else if(i >= sr)
+	    changed = max(changed, step);
+	}
+      }
+      float level = left.subArray(sr/2, sr/2).getRms();
+      float level2 = left.subArray(sr, sr).getRms();
+      CHECK(changed/level2 < 2*steady/level);
+      FloatArray::destroy(input);
+      FdnReverb::destroy(reverb);
+    }
+    FloatArray::destroy(left);
+    FloatArray::destroy(right);
+  }
+};
@@ -0,0 +1,69 @@
+#include "TestPatch.hpp"
+#include "FastFourierTransform.h"
+#include "FilterbankAnalyzer.h"
+#include "Window.h"
+
+class FilterbankAnalyzerTestPatch : public TestPatch {
+public:
+  FilterbankAnalyzerTestPatch(){
+    const float sr = 48000;
+    const int fftSize = 1024;
+    FilterbankAnalyzer::FilterbankType types[] = {FilterbankAnalyzer::ConstantQFilterbank, FilterbankAnalyzer::MelFilterbank};
+    for(int t=0; t<2; ++t){
+      FilterbankAnalyzer* analyzer = FilterbankAnalyzer::create(sr, fftSize, 48, 50, 16000, types[t]);
+      FloatArray bands = FloatArray::create(48);
+      {
+	TEST("band frequencies");
+	CHECK_EQUAL(analyzer->getNumberOfBands(), 48);
+	bool increasing = true;
+	for(int b=1; b<48; ++b)
+	  increasing &= analyzer->getFrequency(b) > analyzer->getFrequency(b-1);
+	CHECK(increasing);
+	CHECK(analyzer->getFrequency(0) > 50);
+	CHECK(analyzer->getFrequency(47) < 16000);
+	if(types[t] == FilterbankAnalyzer::ConstantQFilterbank){
+	  // constant ratio between centre frequencies
+	  float ratio = analyzer->getFrequency(1)/analyzer->getFrequency(0);
+	  CHECK_CLOSE(analyzer->getFrequency(40)/analyzer->getFrequency(39), ratio, 0.001);
+	}
+      }
+      {
+	TEST("kernel size");
+	// at most two weights per bin, and two per band for bands narrower than a bin
+	CHECK(analyzer->getKernelSize() <= 2*(fftSize/2+1) + 2*48);
+      }
+      {
+	TEST("flat spectrum");
+	FloatArray flat = FloatArray::create(fftSize/2+1);
+	flat.setAll(0.5);
+	analyzer->process(flat, bands);
+	CHECK_CLOSE(bands.getMinValue(), 0.5, 0.0001);
+	CHECK_CLOSE(bands.getMaxValue(), 0.5, 0.0001);
+	FloatArray::destroy(flat);
+      }
+      {
+	TEST("sine");
+	FastFourierTransform fft(fftSize);
+	FloatArray x = FloatArray::create(fftSize);
+	ComplexFloatArray spectrum = ComplexFloatArray::create(fftSize/2);
+	Window window = Window::create(Window::HannWindow, fftSize);
+	bool peaks = true;
+	for(int b=12; b<48; b+=5){
+	  float freq = analyzer->getFrequency(b);
+	  for(int n=0; n<fftSize; ++n)
+	    x[n] = sinf(2*M_PI*freq*n/sr);
+	  x.multiply(window);
+	  fft.fft(x, spectrum);
+	  analyzer->process(spectrum, bands);
+	  peaks &= bands.getMaxIndex() == b;
+	}
+	CHECK(peaks);
+	FloatArray::destroy(x);
+	ComplexFloatArray::destroy(spectrum);
+	Window::destroy(window);
+      }
+      FloatArray::destroy(bands);
+      FilterbankAnalyzer::destroy(analyzer);
+    }
+  }
+};
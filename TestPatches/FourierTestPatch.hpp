@@ -0,0 +1,175 @@
+#include "TestPatch.hpp"
+#include "FastFourierTransform.h"
+
+class FourierTestPatch : public TestPatch {
+public:
+  FourierTestPatch(){
+    const int sizes[] = {32, 64, 128, 256, 512, 1024, 2048, 4096, // CMSIS on ARM
+			 12, 30, 480, 960, 1000, 1536, 8192};
+    const int count = sizeof(sizes)/sizeof(int);
+    {
+      TEST("supported sizes");
+      for(int i=0; i<count; ++i)
+	CHECK(FastFourierTransform::isSupportedSize(sizes[i]));
+      CHECK(!FastFourierTransform::isSupportedSize(2));
+      CHECK(!FastFourierTransform::isSupportedSize(31));
+      CHECK(!FastFourierTransform::isSupportedSize(14));
+    }
+    {
+      TEST("packed real spectrum");
+      for(int s=0; s<count; ++s){
+	int size = sizes[s];
+	FastFourierTransform* fft = new FastFourierTransform(size);
+	CHECK_EQUAL(fft->getSize(), size);
+	FloatArray input = FloatArray::create(size);
+	FloatArray copy = FloatArray::create(size);
+	ComplexFloatArray output = ComplexFloatArray::create(size/2);
+	input.noise();
+	input.copyTo(copy);
+	fft->fft(copy, output);
+	// compare a few bins with the DFT
+	int bins[] = {0, 1, 2, size/4-1, size/4, size/2-1, size/2};
+	float maxerr = 0;
+	for(int b=0; b<7; ++b){
+	  int k = bins[b];
+	  double re = 0, im = 0;
+	  for(int n=0; n<size; ++n){
+	    re += input[n]*cos(2*M_PI*k*n/size);
+	    im -= input[n]*sin(2*M_PI*k*n/size);
+	  }
+	  if(k == 0){
+	    maxerr = max(maxerr, fabsf(output[0].re - re));
+	  }else if(k == size/2){
+	    // Nyquist is packed into the imaginary part of the DC bin
+	    maxerr = max(maxerr, fabsf(output[0].im - re));
+	  }else{
+	    maxerr = max(maxerr, fabsf(output[k].re - re));
+	    maxerr = max(maxerr, fabsf(output[k].im - im));
+	  }
+	}
+	CHECK(maxerr < 0.0001*size);
+	FloatArray::destroy(input);
+	FloatArray::destroy(copy);
+	ComplexFloatArray::destroy(output);
+	delete fft;
+      }
+    }
+    {
+      TEST("inverse");
+      for(int s=0; s<count; ++s){
+	int size = sizes[s];
+	FastFourierTransform fft(size);
+	FloatArray input = FloatArray::create(size);
+	FloatArray output = FloatArray::create(size);
+	ComplexFloatArray spectrum = ComplexFloatArray::create(size/2);
+	input.noise();
+	input.copyTo(output);
+	fft.fft(output, spectrum);
+	fft.ifft(spectrum, output);
+	float maxerr = 0;
+	for(int i=0; i<size; ++i)
+	  maxerr = max(maxerr, fabsf(output[i]-input[i]));
+	CHECK(maxerr < 0.00001);
+	FloatArray::destroy(input);
+	FloatArray::destroy(output);
+	ComplexFloatArray::destroy(spectrum);
+      }
+    }
+    {
+      TEST("scratch");
+      const int size = 960;
+      ComplexFloatArray scratch = ComplexFloatArray::create(size/2);
+      FastFourierTransform fft;
+      fft.init(size, scratch);
+      CHECK_EQUAL(fft.getSize(), size);
+      FloatArray input = FloatArray::create(size);
+      FloatArray output = FloatArray::create(size);
+      ComplexFloatArray spectrum = ComplexFloatArray::create(size/2);
+      input.noise();
+      input.copyTo(output);
+      fft.fft(output, spectrum);
+      fft.ifft(spectrum, output);
+      float maxerr = 0;
+      for(int i=0; i<size; ++i)
+	maxerr = max(maxerr, fabsf(output[i]-input[i]));
+      CHECK(maxerr < 0.00001);
+      // re-initialise to a different size
+      fft.init(1000);
+      CHECK_EQUAL(fft.getSize(), 1000);
+      FloatArray::destroy(input);
+      FloatArray::destroy(output);
+      ComplexFloatArray::destroy(spectrum);
+      ComplexFloatArray::destroy(scratch);
+    }
+    {
+      TEST("shared plans");
+      CHECK_EQUAL(FastFourierPlan::getCount(), 0);
+      FastFourierTransform* a = new FastFourierTransform(1024);
+      FastFourierTransform* b = new FastFourierTransform(1024);
+      FastFourierTransform* c = new FastFourierTransform(480);
+      CHECK_EQUAL(FastFourierPlan::getCount(), 2);
+      FloatArray input = FloatArray::create(1024);
+      FloatArray copy = FloatArray::create(1024);
+      ComplexFloatArray x = ComplexFloatArray::create(512);
+      ComplexFloatArray y = ComplexFloatArray::create(512);
+      input.noise();
+      input.copyTo(copy);
+      a->fft(copy, x);
+      input.copyTo(copy);
+      b->fft(copy, y);
+      bool equal = true;
+      for(int i=0; i<512; ++i)
+	equal &= x[i].re == y[i].re && x[i].im == y[i].im;
+      CHECK(equal);
+      delete a;
+      CHECK_EQUAL(FastFourierPlan::getCount(), 2);
+      delete b;
+      CHECK_EQUAL(FastFourierPlan::getCount(), 1);
+      c->init(1024);
+      CHECK_EQUAL(FastFourierPlan::getCount(), 1);
+      delete c;
+      CHECK_EQUAL(FastFourierPlan::getCount(), 0);
+      // clear() empties the cache, but a transform that is still in use keeps its plan
+      c = new FastFourierTransform(1024);
+      input.copyTo(copy);
+      c->fft(copy, y);
+      CHECK_EQUAL(FastFourierPlan::getCount(), 1);
+      FastFourierPlan::clear();
+      CHECK_EQUAL(FastFourierPlan::getCount(), 0);
+      a = new FastFourierTransform(1024);
+      CHECK_EQUAL(FastFourierPlan::getCount(), 1);
+      input.copyTo(copy);
+      c->fft(copy, x);
+      equal = true;
+      for(int i=0; i<512; ++i)
+	equal &= x[i].re == y[i].re && x[i].im == y[i].im;
+      CHECK(equal);
+      delete c;
+      CHECK_EQUAL(FastFourierPlan::getCount(), 1);
+      delete a;
+      CHECK_EQUAL(FastFourierPlan::getCount(), 0);
+      FloatArray::destroy(input);
+      FloatArray::destroy(copy);
+      ComplexFloatArray::destroy(x);
+      ComplexFloatArray::destroy(y);
+    }
+    {
+      TEST("sine");
+      const int size = 512;
+      FastFourierTransform fft(size);
+      FloatArray input = FloatArray::create(size);
+      ComplexFloatArray spectrum = ComplexFloatArray::create(size/2);
+      FloatArray magnitudes = FloatArray::create(size/2);
+      for(int i=0; i<size; ++i)
+	input[i] = cosf(2*M_PI*10*i/size);
+      fft.fft(input, spectrum);
+      spectrum.getMagnitudeValues(magnitudes);
+      CHECK_EQUAL(magnitudes.getMaxIndex(), 10);
+      CHECK_CLOSE(spectrum[10].re, size/2, 0.01);
+      CHECK_CLOSE(spectrum[10].im, 0, 0.01);
+      FloatArray::destroy(input);
+      ComplexFloatArray::destroy(spectrum);
+      FloatArray::destroy(magnitudes);
+    }
+  }
+};
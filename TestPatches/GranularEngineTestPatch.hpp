@@ -0,0 +1,138 @@
+#include "TestPatch.hpp"
+#include "GranularEngine.h"
+
+class GranularEngineTestPatch : public TestPatch {
+public:
+  GranularEngineTestPatch(){
+    const float sr = 48000;
+    const int blocksize = getBlockSize();
+    FloatArray left = FloatArray::create(blocksize);
+    FloatArray right = FloatArray::create(blocksize);
+    FloatArray input = FloatArray::create(blocksize);
+    {
+      TEST("single grain");
+      GranularEngine* granular = GranularEngine::create(sr, 1, 8);
+      input.setAll(1);
+      for(int i=0; i<40; ++i)
+	granular->record(input);
+      granular->setGrainSize(1024/sr);
+      granular->setDensity(sr/2048);
+      granular->setPosition(0.1);
+      // the first grain starts at the first sample, and ends after 1024 samples
+      float sumL = 0, sumR = 0;
+      for(int i=0; i<16; ++i){
+	granular->process(left, right);
+	if(i == 0){
+	  CHECK_EQUAL(left[0], 0.0f);
+	}
+	if(i == 4){
+	  CHECK_CLOSE(left[0], sqrtf(0.5), 0.001); // middle of the window, panned center
+	}
+	if(i == 8){
+	  CHECK_EQUAL(left.getMaxValue(), 0.0f);
+	  CHECK_EQUAL(granular->getActiveGrains(), 0);
+	}
+	if(i < 8){
+	  sumL += left.getMean()*blocksize;
+	  sumR += right.getMean()*blocksize;
+	}
+      }
+      // sum of a Hann window is half its length
+      CHECK_CLOSE(sumL, sqrtf(0.5)*512, 1);
+      CHECK_CLOSE(sumR, sumL, 0.001);
+      GranularEngine::destroy(granular);
+    }
+    {
+      TEST("position and speed");
+      GranularEngine* granular = GranularEngine::create(sr, 1, 8);
+      // ramp input: the recorded value is the write index
+      for(int i=0; i<400; ++i){
+	for(int j=0; j<blocksize; ++j)
+	  input[j] = i*blocksize + j;
+	granular->record(input);
+      }
+      granular->setGrainSize(0.01);
+      granular->setDensity(1);
+      granular->setPosition(0.1);
+      granular->setSpeed(2);
+      granular->setAmplitude(1/sqrtf(0.5));
+      granular->process(left, right);
+      // divide out the window to get the source position
+      float w = 0.5f*(1 - cosf(2*M_PI*50/480));
+      float start = 400*blocksize - 4800;
+      CHECK_CLOSE(left[50]/w, start + 2*50, 5);
+      GranularEngine::destroy(granular);
+    }
+    {
+      TEST("speed in a large buffer");
+      // read positions above 2^20 keep the exact speed
+      GranularEngine* granular = GranularEngine::create(sr, (1<<21)/sr, 8);
+      int blocks = (3<<19)/blocksize;
+      int start = blocks*blocksize - 4800;
+      for(int i=0; i<blocks; ++i){
+	// a ramp from the start of the grain, small where the grain reads
+	for(int j=0; j<blocksize; ++j)
+	  input[j] = i*blocksize + j - start;
+	granular->record(input);
+      }
+      granular->setGrainSize(0.02);
+      granular->setDensity(1);
+      granular->setPosition(0.1);
+      granular->setSpeed(1.03);
+      granular->setAmplitude(1/sqrtf(0.5));
+      FloatArray output = FloatArray::create(960);
+      FloatArray other = FloatArray::create(960);
+      for(int i=0; i<960; i+=blocksize)
+	granular->process(output.subArray(i, min(blocksize, 960-i)), other.subArray(i, min(blocksize, 960-i)));
+      float w200 = 0.5f*(1 - cosf(2*M_PI*200/960));
+      float w700 = 0.5f*(1 - cosf(2*M_PI*700/960));
+      CHECK_CLOSE((output[700]/w700 - output[200]/w200)/500, 1.03f, 0.002);
+      FloatArray::destroy(output);
+      FloatArray::destroy(other);
+      GranularEngine::destroy(granular);
+    }
+    {
+      TEST("density");
+      GranularEngine* granular = GranularEngine::create(sr, 1, 64);
+      granular->setGrainSize(0.001); // 48 samples
+      granular->setDensity(100);
+      granular->setTimingJitter(0.5);
+      input.setAll(1);
+      int grains = 0;
+      for(int i=0; i<sr/blocksize; ++i){
+	granular->record(input);
+	granular->process(left, right);
+	// count grain onsets: output rises from zero
+	for(int j=1; j<blocksize; ++j)
+	  if(left[j-1] == 0 && left[j] > 0)
+	    grains++;
+      }
+      CHECK(abs(grains - 100) < 15);
+      GranularEngine::destroy(granular);
+    }
+    {
+      TEST("pool limit");
+      GranularEngine* granular = GranularEngine::create(sr, 2, 16);
+      granular->setGrainSize(0.5);
+      granular->setDensity(1000);
+      granular->setPositionJitter(0.5);
+      granular->setPitchJitter(12);
+      granular->setSpread(1);
+      input.setAll(0.5);
+      int most = 0;
+      for(int i=0; i<200; ++i){
+	granular->record(input);
+	granular->process(left, right);
+	most = max(most, granular->getActiveGrains());
+      }
+      CHECK_EQUAL(most, 16);
+      CHECK(left.getMaxValue() <= 16*0.5);
+      granular->reset();
+      CHECK_EQUAL(granular->getActiveGrains(), 0);
+      GranularEngine::destroy(granular);
+    }
+    FloatArray::destroy(left);
+    FloatArray::destroy(right);
+    FloatArray::destroy(input);
+  }
+};
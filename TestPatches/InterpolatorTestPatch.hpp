@@ -0,0 +1,170 @@
+#include "TestPatch.hpp"
+#include "Interpolator.h"
+#include "DelayLine.h"
+#include "WavetableOscillator.h"
+
+class InterpolatorTestPatch : public TestPatch {
+public:
+  /* largest error reading a sine of @param cycles per sample at fractional positions */
+  template<class Kernel>
+  float getError(const Kernel& kernel, FloatArray table, float cycles){
+    for(int i=0; i<table.getSize(); ++i)
+      table[i] = sinf(2*M_PI*cycles*i);
+    float error = 0;
+    for(int i=0; i<200; ++i){
+      float position = 100 + i*0.37f;
+      int index = (int)position;
+      float value = kernel.read(table.getData(), table.getSize()-1, index, position - index);
+      error = max(error, fabsf(value - sinf(2*M_PI*cycles*position)));
+    }
+    return error;
+  }
+
+  InterpolatorTestPatch(){
+    FloatArray table = FloatArray::create(256);
+    {
+      TEST("kernels");
+      LinearKernel linear;
+      HermiteKernel hermite;
+      LagrangeKernel lagrange;
+      // a cubic is reproduced exactly by Lagrange, a straight line by all kernels
+      for(int i=0; i<table.getSize(); ++i){
+	float x = i*0.1f;
+	table[i] = 0.02f*x*x*x - 0.3f*x*x + x;
+      }
+      float x = 10.25f;
+      CHECK_CLOSE(lagrange.read(table.getData(), 255, 102, 0.5f), 0.02f*x*x*x - 0.3f*x*x + x, 1e-4);
+      for(int i=0; i<table.getSize(); ++i)
+	table[i] = i*0.5f - 3;
+      CHECK_CLOSE(linear.read(table.getData(), 255, 10, 0.3f), 2.15f, 1e-5);
+      CHECK_CLOSE(hermite.read(table.getData(), 255, 10, 0.3f), 2.15f, 1e-5);
+      CHECK_CLOSE(lagrange.read(table.getData(), 255, 10, 0.3f), 2.15f, 1e-5);
+      // all kernels pass the samples through at a fraction of 0
+      CHECK_EQUAL(hermite.read(table.getData(), 255, 20, 0), table[20]);
+      CHECK_EQUAL(lagrange.read(table.getData(), 255, 20, 0), table[20]);
+      // reads wrap around at the ends of the table
+      float wrapped[4] = { table[254], table[255], table[0], table[1] };
+      CHECK_CLOSE(hermite.read(table.getData(), 255, 255, 0.5f), hermite.interpolate(wrapped + 1, 0.5f), 1e-6);
+      CHECK_CLOSE(hermite.read(table.getData(), 255, 0, 0), table[0], 1e-6);
+    }
+    {
+      TEST("sinc");
+      SincKernel<8>* sinc = SincKernel<8>::create();
+      SincKernel<16>* sinc16 = SincKernel<16>::create(256);
+      for(int i=0; i<table.getSize(); ++i)
+	table[i] = i % 3 - 1.0f;
+      CHECK_CLOSE(sinc->read(table.getData(), 255, 40, 0), table[40], 1e-6);
+      CHECK_CLOSE(sinc16->read(table.getData(), 255, 41, 0), table[41], 1e-6);
+      // sinc is the most accurate at high frequencies, then Lagrange and Hermite, then linear
+      float high = 0.2f;
+      float e16 = getError(*sinc16, table, high);
+      float e8 = getError(*sinc, table, high);
+      float lagrange = getError(LagrangeKernel(), table, high);
+      float hermite = getError(HermiteKernel(), table, high);
+      float linear = getError(LinearKernel(), table, high);
+      CHECK(e16 < 0.005f);
+      CHECK(e8 < 0.02f);
+      CHECK(e8 < lagrange && e8 < hermite);
+      CHECK(lagrange < linear && hermite < linear);
+      CHECK(getError(*sinc16, table, 0.02f) < 0.001f);
+      SincKernel<8>::destroy(sinc);
+      SincKernel<16>::destroy(sinc16);
+    }
+    {
+      TEST("block reads");
+      HermiteKernel hermite;
+      FloatArray indices = FloatArray::create(getBlockSize());
+      FloatArray fractions = FloatArray::create(getBlockSize());
+      FloatArray positions = FloatArray::create(getBlockSize());
+      FloatArray output = FloatArray::create(getBlockSize());
+      FloatArray expected = FloatArray::create(getBlockSize());
+      for(int i=0; i<table.getSize(); ++i)
+	table[i] = sinf(i*0.3f);
+      for(int i=0; i<getBlockSize(); ++i){
+	positions[i] = 200 + i*1.7f - 50*(i&1); // past the end of the table, and back
+	indices[i] = (int)positions[i];
+	fractions[i] = positions[i] - indices[i];
+	expected[i] = hermite.read(table.getData(), 255, (uint32_t)indices[i], fractions[i]);
+      }
+      hermite.read(table, indices, fractions, output);
+      for(int i=0; i<getBlockSize(); ++i)
+	CHECK_CLOSE(output[i], expected[i], 1e-6);
+      output.clear();
+      hermite.read(table, positions, output);
+      for(int i=0; i<getBlockSize(); ++i)
+	CHECK_CLOSE(output[i], expected[i], 1e-6);
+      // negative positions wrap to the end of the table
+      positions.setAll(-0.5f);
+      hermite.read(table, positions, output.subArray(0, 1));
+      CHECK_CLOSE(output[0], hermite.read(table.getData(), 255, 255, 0.5f), 1e-6);
+      FloatArray::destroy(indices);
+      FloatArray::destroy(fractions);
+      FloatArray::destroy(positions);
+      FloatArray::destroy(output);
+      FloatArray::destroy(expected);
+    }
+    {
+      TEST("delay line");
+      FloatDelayLine* delay = FloatDelayLine::create(1024);
+      SincKernel<8>* sinc = SincKernel<8>::create();
+      FloatArray input = FloatArray::create(getBlockSize());
+      FloatArray output = FloatArray::create(getBlockSize());
+      FloatArray delays = FloatArray::create(getBlockSize());
+      float w = 2*M_PI*0.1f;
+      for(int i=0; i<input.getSize(); ++i)
+	input[i] = sinf(w*i);
+      delay->write(input);
+      delays.setAll(10.4f);
+      delay->readInterpolated(*sinc, output, delays);
+      float error = 0;
+      for(int i=20; i<output.getSize(); ++i)
+	error = max(error, fabsf(output[i] - sinf(w*(i - 10.4f))));
+      CHECK(error < 0.005f);
+      // the built in taps are the same as the kernels
+      CHECK_EQUAL(delay->readInterpolated(HermiteKernel(), 7.3f), delay->readHermite(7.3f));
+      CHECK_EQUAL(delay->readInterpolated(LinearKernel(), 7.3f), delay->readLinear(7.3f));
+      CHECK_CLOSE(delay->readInterpolated(*sinc, 12.0f), input[input.getSize()-13], 1e-6);
+      FloatArray::destroy(input);
+      FloatArray::destroy(output);
+      FloatArray::destroy(delays);
+      SincKernel<8>::destroy(sinc);
+      FloatDelayLine::destroy(delay);
+    }
+    {
+      TEST("wavetable blocks");
+      // block reads give the same samples as reading one sample at a time
+      FloatArray cycles = FloatArray::create(2*512);
+      for(int i=0; i<512; ++i){
+	cycles[i] = sinf(2*M_PI*i/512);
+	cycles[512+i] = i < 256 ? 0.5f : -0.5f;
+      }
+      Wavetable* wavetable = Wavetable::create(cycles, 512);
+      WavetableOscillator* block = WavetableOscillator::create(48000, wavetable);
+      WavetableOscillator* single = WavetableOscillator::create(48000, wavetable);
+      FloatArray output = FloatArray::create(getBlockSize()+5);
+      for(int type=0; type<2; ++type){
+	block->setInterpolation((WavetableOscillator::InterpolationType)type);
+	single->setInterpolation((WavetableOscillator::InterpolationType)type);
+	block->setMorph(0.3);
+	single->setMorph(0.3);
+	block->setFrequency(1234);
+	single->setFrequency(1234);
+	for(int b=0; b<3; ++b){
+	  block->getSamples(output);
+	  float error = 0;
+	  for(int i=0; i<output.getSize(); ++i){
+	    float expected = single->getNextSample();
+	    error = max(error, fabsf(output[i] - expected));
+	  }
+	  CHECK(error < 1e-6);
+	}
+      }
+      FloatArray::destroy(output);
+      WavetableOscillator::destroy(block);
+      WavetableOscillator::destroy(single);
+      Wavetable::destroy(wavetable);
+      FloatArray::destroy(cycles);
+    }
+    FloatArray::destroy(table);
+  }
+};
@@ -0,0 +1,107 @@
+#include "TestPatch.hpp"
+#include "OscillatorBank.h"
+
+class OscillatorBankTestPatch : public TestPatch {
+public:
+  OscillatorBankTestPatch(){
+    const float sr = 48000;
+    const int blocks = 400;
+    FloatArray output = FloatArray::create(getBlockSize());
+    FloatArray quadrature = FloatArray::create(getBlockSize());
+    {
+      TEST("sine and cosine");
+      OscillatorBank* bank = OscillatorBank::create(sr, 1);
+      bank->setFrequency(0, 440);
+      bank->setAmplitude(0, 0.5);
+      bank->getSamples(output, quadrature); // ramps up the amplitude
+      float error = 0;
+      int n = getBlockSize();
+      for(int b=0; b<blocks; ++b){
+	bank->getSamples(output, quadrature);
+	for(int i=0; i<output.getSize(); ++i){
+	  float phase = 2*M_PI*440*(double)(n++)/sr;
+	  error = max(error, fabsf(output[i] - 0.5f*sinf(phase)));
+	  error = max(error, fabsf(quadrature[i] - 0.5f*cosf(phase)));
+	}
+      }
+      CHECK(error < 0.0005);
+      OscillatorBank::destroy(bank);
+    }
+    {
+      TEST("harmonics");
+      const int partials = 32;
+      OscillatorBank* bank = OscillatorBank::create(sr, partials);
+      FloatArray frequencies = FloatArray::create(partials);
+      FloatArray amplitudes = FloatArray::create(partials);
+      for(int k=0; k<partials; ++k){
+	frequencies[k] = 110*(k+1);
+	amplitudes[k] = 1.0f/(k+1);
+      }
+      bank->setPartials(frequencies, amplitudes);
+      CHECK_CLOSE(bank->getFrequency(3), 440, 0.01);
+      float error = 0;
+      int n = 0;
+      for(int b=0; b<blocks; ++b){
+	bank->getSamples(output);
+	for(int i=0; i<output.getSize(); ++i){
+	  float expected = 0;
+	  for(int k=0; k<partials; ++k)
+	    expected += amplitudes[k]*sinf(2*M_PI*frequencies[k]*(double)n/sr);
+	  error = max(error, fabsf(output[i] - expected));
+	  n++;
+	}
+      }
+      CHECK(error < 0.005);
+      FloatArray::destroy(frequencies);
+      FloatArray::destroy(amplitudes);
+      OscillatorBank::destroy(bank);
+    }
+    {
+      TEST("ramps");
+      OscillatorBank* bank = OscillatorBank::create(sr, 1);
+      bank->setFrequency(0, 1000);
+      bank->setAmplitude(0, 1);
+      bank->getSamples(output);
+      float error = 0;
+      for(int i=0; i<output.getSize(); ++i){
+	// amplitude ramps up from zero over the block
+	float expected = (float)i/output.getSize()*sinf(2*M_PI*1000*i/sr);
+	error = max(error, fabsf(output[i] - expected));
+      }
+      CHECK(error < 0.0001);
+      // linear frequency sweep from 1kHz to 2kHz over one block, then constant
+      bank->setFrequency(0, 2000);
+      bank->getSamples(output);
+      bank->getSamples(quadrature);
+      double w0 = 2*M_PI*1000/sr;
+      double dw = 2*M_PI*1000/sr/output.getSize();
+      int n = output.getSize();
+      error = 0;
+      for(int i=0; i<output.getSize(); ++i){
+	double phase = w0*(n+i) + dw*i*(i-1)/2;
+	error = max(error, fabsf(output[i] - (float)sin(phase)));
+      }
+      double end = w0*2*n + dw*n*(n-1)/2;
+      for(int i=0; i<quadrature.getSize(); ++i){
+	double phase = end + 2*w0*i;
+	error = max(error, fabsf(quadrature[i] - (float)sin(phase)));
+      }
+      CHECK(error < 0.0005);
+      OscillatorBank::destroy(bank);
+    }
+    {
+      TEST("nyquist");
+      OscillatorBank* bank = OscillatorBank::create(sr, 2);
+      bank->setFrequency(0, 30000);
+      bank->setAmplitude(0, 1);
+      bank->setFrequency(1, 100);
+      bank->setAmplitude(1, 0);
+      bank->getSamples(output);
+      CHECK_EQUAL(output.getMaxValue(), 0.0f);
+      CHECK_EQUAL(output.getMinValue(), 0.0f);
+      OscillatorBank::destroy(bank);
+    }
+    FloatArray::destroy(output);
+    FloatArray::destroy(quadrature);
+  }
+};
@@ -0,0 +1,106 @@
+#include "TestPatch.hpp"
+#include "Oversampler.h"
+
+class OversamplerTestPatch : public TestPatch {
+public:
+  OversamplerTestPatch(){
+    int blocksize = getBlockSize();
+    {
+      TEST("DC gain");
+      for(int factor=2; factor<=16; factor*=2){
+	Oversampler* os = Oversampler::create(factor, Oversampler::MEDIUM_QUALITY, blocksize);
+	FloatArray in = FloatArray::create(blocksize);
+	FloatArray up = FloatArray::create(blocksize*factor);
+	FloatArray out = FloatArray::create(blocksize);
+	in.setAll(0.5);
+	for(int i=0; i<8; ++i){
+	  os->upsample(in, up);
+	  os->downsample(up, out);
+	}
+	CHECK_CLOSE(up.getMean(), 0.5, 0.0001);
+	CHECK_CLOSE(out.getMean(), 0.5, 0.0001);
+	// input is left intact
+	CHECK_EQUAL(in.getMinValue(), 0.5f);
+	CHECK_EQUAL(in.getMaxValue(), 0.5f);
+	FloatArray::destroy(in);
+	FloatArray::destroy(up);
+	FloatArray::destroy(out);
+	Oversampler::destroy(os);
+      }
+    }
+    {
+      TEST("latency");
+      Oversampler* os = Oversampler::create(8, Oversampler::HIGH_QUALITY, blocksize);
+      const int blocks = 16;
+      FloatArray in = FloatArray::create(blocksize*blocks);
+      FloatArray out = FloatArray::create(blocksize*blocks);
+      FloatArray up = FloatArray::create(blocksize*8);
+      float f = 1.0/200;
+      for(int i=0; i<in.getSize(); ++i)
+	in[i] = sinf(2*M_PI*f*i);
+      for(int i=0; i<blocks; ++i){
+	os->upsample(in.subArray(i*blocksize, blocksize), up);
+	os->downsample(up, out.subArray(i*blocksize, blocksize));
+      }
+      float latency = os->getLatency();
+      CHECK(latency > 1 && latency < 8);
+      float maxerr = 0;
+      for(int i=blocksize*4; i<out.getSize(); ++i){
+	float expected = sinf(2*M_PI*f*(i-latency));
+	maxerr = max(maxerr, fabsf(out[i]-expected));
+      }
+      CHECK(maxerr < 0.001);
+      FloatArray::destroy(in);
+      FloatArray::destroy(out);
+      FloatArray::destroy(up);
+      Oversampler::destroy(os);
+    }
+    {
+      TEST("image rejection");
+      Oversampler::Quality qs[] = {Oversampler::LOW_QUALITY, Oversampler::MEDIUM_QUALITY, Oversampler::HIGH_QUALITY};
+      float limits[] = {0.001, 0.00002, 0.000002}; // -60dB, -94dB, -114dB
+      for(int q=0; q<3; ++q){
+	const int factor = 4;
+	const int blocks = 32;
+	Oversampler* os = Oversampler::create(factor, qs[q], blocksize);
+	FloatArray in = FloatArray::create(blocksize);
+	FloatArray up = FloatArray::create(blocksize*factor*blocks);
+	float f = 0.3; // relative to the base sampling rate
+	for(int i=0; i<blocks; ++i){
+	  for(int j=0; j<blocksize; ++j)
+	    in[j] = sinf(2*M_PI*f*(i*blocksize+j));
+	  os->upsample(in, up.subArray(i*blocksize*factor, blocksize*factor));
+	}
+	FloatArray tail = up.subArray(blocksize*factor, blocksize*factor*(blocks-1));
+	CHECK_CLOSE(getAmplitude(tail, f/factor), 1.0, 0.01);
+	// first image, at the base sampling rate minus f
+	float image = getAmplitude(tail, (1-f)/factor);
+	CHECK(image < limits[q]);
+	FloatArray::destroy(in);
+	FloatArray::destroy(up);
+	Oversampler::destroy(os);
+      }
+    }
+    {
+      TEST("multichannel");
+      Oversampler* os = Oversampler::create(2, Oversampler::LOW_QUALITY, blocksize, 2);
+      FloatArray left = FloatArray::create(blocksize);
+      FloatArray right = FloatArray::create(blocksize);
+      FloatArray up = FloatArray::create(blocksize*2);
+      for(int i=0; i<8; ++i){
+	left.setAll(0.25);
+	right.setAll(-0.5);
+	os->upsample(left, up, 0);
+	os->downsample(up, left, 0);
+	os->upsample(right, up, 1);
+	os->downsample(up, right, 1);
+      }
+      CHECK_CLOSE(left.getMean(), 0.25, 0.0001);
+      CHECK_CLOSE(right.getMean(), -0.5, 0.0001);
+      FloatArray::destroy(left);
+      FloatArray::destroy(right);
+      FloatArray::destroy(up);
+      Oversampler::destroy(os);
+    }
+  }
+};
@@ -2,6 +2,9 @@
 #include "TestPatch.hpp"
 #include "ProgramVector.h"
 #include "PatchProcessor.h"
+#include "MemoryBuffer.hpp"
+#include "FastPowTable.h"
+#include "FastLogTable.h"
 #include <stdio.h>
 
 #include "registerpatch.h"
@@ -34,6 +37,19 @@ void arm_bitreversal_16(uint32_t *pSrc, const uint16_t bitRevLen, const uint16_t
   #warning TODO!
   // ASSERT(false, "arm_bitreversal_16");
 }
+
+void *pvPortMalloc( size_t xWantedSize ){
+#ifdef malloc
+#undef malloc
+#endif
+  return malloc(xWantedSize);
+}
+void vPortFree( void *pv ){
+#ifdef free
+#undef free
+#endif
+  free(pv);
+}
 }
 
 PatchProcessor processor;
@@ -72,11 +88,20 @@ void debugMessage(char const* msg){
   printf("%s\n", msg);
 }
 
+void error(int8_t code, const char* reason){
+  printf("Error %d: %s\n", code, reason);
+  exit(-1);
+}
+
 Patch::Patch(){}
 Patch::~Patch(){}
 PatchProcessor::PatchProcessor(){}
 PatchProcessor::~PatchProcessor(){}
 int Patch::getBlockSize(){return 128;}
+AudioBuffer::~AudioBuffer(){}
+AudioBuffer* AudioBuffer::create(int channels, int samples){
+  return new ManagedMemoryBuffer(channels, samples);
+}
 
 PatchProcessor* getInitialisingPatchProcessor(){
   return &processor;
@@ -92,6 +117,9 @@ void registerPatch(const char* name, uint8_t inputs, uint8_t outputs, TestPatch*
 #define REGISTER_PATCH(T, STR, IN, OUT) registerPatch(STR, IN, OUT, new T)
 
 int main(int argc, char** argv){
+  // default lookup tables, as set by setSystemTables() on the device
+  fast_pow_set_table(fast_pow_table, fast_pow_table_size);
+  fast_log_set_table(fast_log_table, fast_log_table_size);
 #include "registerpatch.cpp"
   ASSERT(testpatch != NULL, "Missing test patch");    
   int ret = 0;
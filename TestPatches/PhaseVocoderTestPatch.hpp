@@ -0,0 +1,104 @@
+#include "TestPatch.hpp"
+#include "PhaseVocoder.h"
+
+class PhaseVocoderTestPatch : public TestPatch {
+public:
+  // process a sine of frequency f through the vocoder, return the output
+  void run(PhaseVocoder* pv, float f, FloatArray output){
+    int blocksize = getBlockSize();
+    FloatArray block = FloatArray::create(blocksize);
+    for(int b=0; b<output.getSize()/blocksize; ++b){
+      for(int i=0; i<blocksize; ++i)
+	block[i] = sinf(2*M_PI*f*(b*blocksize+i));
+      pv->process(block, output.subArray(b*blocksize, blocksize));
+    }
+    FloatArray::destroy(block);
+  }
+  PhaseVocoderTestPatch(){
+    int blocksize = getBlockSize();
+    {
+      TEST("phase values");
+      ComplexFloatArray values = ComplexFloatArray::create(1000);
+      FloatArray phases = FloatArray::create(1000);
+      for(int i=0; i<1000; ++i){
+	values[i].re = randf()*2-1;
+	values[i].im = randf()*2-1;
+      }
+      values[0].re = 0;
+      values[0].im = 0;
+      values[1].re = -1;
+      values[1].im = 0;
+      values.getPhaseValues(phases);
+      float maxerr = 0;
+      for(int i=1; i<1000; ++i)
+	maxerr = max(maxerr, fabsf(phases[i] - atan2f(values[i].im, values[i].re)));
+      CHECK(maxerr < 0.000005);
+      CHECK_EQUAL(phases[0], 0.0f);
+      ComplexFloatArray::destroy(values);
+      FloatArray::destroy(phases);
+    }
+    const float f = 0.02;
+    const int blocks = 96;
+    FloatArray output = FloatArray::create(blocksize*blocks);
+    FloatArray tail = output.subArray(blocksize*blocks/2, blocksize*blocks/2);
+    {
+      TEST("unity");
+      PhaseVocoder* pv = PhaseVocoder::create(1024, 256);
+      run(pv, f, output);
+      CHECK_CLOSE(getAmplitude(tail, f), 1.0, 0.05);
+      PhaseVocoder::destroy(pv);
+    }
+    {
+      TEST("pitch shift");
+      float ratios[] = {1.5, 0.5, 2.0, 0.8};
+      for(int r=0; r<4; ++r){
+	PhaseVocoder* pv = PhaseVocoder::create(1024, 256);
+	pv->setPitchShift(ratios[r]);
+	run(pv, f, output);
+	CHECK_CLOSE(getAmplitude(tail, f*ratios[r]), 1.0, 0.1);
+	CHECK(getAmplitude(tail, f) < 0.05);
+	PhaseVocoder::destroy(pv);
+      }
+    }
+    {
+      TEST("freeze");
+      PhaseVocoder* pv = PhaseVocoder::create(1024, 256);
+      run(pv, f, output);
+      pv->setFreeze(true);
+      CHECK(pv->getFreeze());
+      // input is ignored while frozen
+      FloatArray silence = FloatArray::create(blocksize);
+      for(int b=0; b<blocks; ++b){
+	silence.clear();
+	pv->process(silence, output.subArray(b*blocksize, blocksize));
+      }
+      CHECK_CLOSE(getAmplitude(tail, f), 1.0, 0.05);
+      FloatArray::destroy(silence);
+      PhaseVocoder::destroy(pv);
+    }
+    {
+      TEST("transient");
+      PhaseVocoder* pv = PhaseVocoder::create(1024, 256);
+      FloatArray block = FloatArray::create(256);
+      bool steady = false;
+      for(int b=0; b<16; ++b){
+	for(int i=0; i<256; ++i)
+	  block[i] = sinf(2*M_PI*f*(b*256+i));
+	pv->process(block, block);
+	if(b > 8)
+	  steady |= pv->isTransient();
+      }
+      CHECK(!steady);
+      // an impulse after a steady sine is a transient
+      block.clear();
+      block[100] = 100;
+      pv->process(block, block);
+      block.clear();
+      pv->process(block, block);
+      CHECK(pv->isTransient());
+      FloatArray::destroy(block);
+      PhaseVocoder::destroy(pv);
+    }
+    FloatArray::destroy(output);
+  }
+};
@@ -0,0 +1,86 @@
+#include "TestPatch.hpp"
+#include "PitchDetector.h"
+
+class PitchDetectorTestPatch : public TestPatch {
+public:
+  // run a sine of frequency freq through the detector for the given number of blocks
+  void run(McLeodPitchDetector* detector, float freq, int blocks){
+    int blocksize = getBlockSize();
+    FloatArray block = FloatArray::create(blocksize);
+    for(int b=0; b<blocks; ++b){
+      for(int i=0; i<blocksize; ++i)
+	block[i] = 0.5*sinf(2*M_PI*freq*(b*blocksize+i)/48000);
+      detector->process(block);
+    }
+    FloatArray::destroy(block);
+  }
+  PitchDetectorTestPatch(){
+    const float sr = 48000;
+    int blocksize = getBlockSize();
+    {
+      TEST("McLeod");
+      McLeodPitchDetector* detector = McLeodPitchDetector::create(sr, blocksize, 1024);
+      float freqs[] = {110, 220, 440, 1000, 2500};
+      for(int f=0; f<5; ++f){
+	detector->reset();
+	run(detector, freqs[f], 32);
+	CHECK_CLOSE(detector->getFrequency(), freqs[f], freqs[f]*0.001);
+	CHECK(detector->getConfidence() > 0.95);
+      }
+      McLeodPitchDetector::destroy(detector);
+    }
+    {
+      TEST("decimated low notes");
+      McLeodPitchDetector* detector = McLeodPitchDetector::create(sr, blocksize, 1024, 4);
+      detector->setMinFrequency(30);
+      float freqs[] = {41.2, 55, 82.41, 110};
+      for(int f=0; f<4; ++f){
+	detector->reset();
+	run(detector, freqs[f], 128);
+	CHECK_CLOSE(detector->getFrequency(), freqs[f], freqs[f]*0.001);
+	CHECK(detector->getConfidence() > 0.95);
+      }
+      McLeodPitchDetector::destroy(detector);
+    }
+    {
+      TEST("noise");
+      McLeodPitchDetector detector(sr, blocksize, 1024);
+      FloatArray block = FloatArray::create(blocksize);
+      for(int b=0; b<32; ++b){
+	block.noise();
+	detector.process(block);
+      }
+      CHECK(detector.getConfidence() < 0.5);
+      FloatArray::destroy(block);
+    }
+    {
+      TEST("independent instances");
+      McLeodPitchDetector a(sr, blocksize, 1024);
+      McLeodPitchDetector b(sr, blocksize, 1024);
+      run(&a, 200, 32);
+      run(&b, 300, 32);
+      CHECK_CLOSE(a.getFrequency(), 200, 0.2);
+      CHECK_CLOSE(b.getFrequency(), 300, 0.3);
+      ZeroCrossingPitchDetector zc1(sr, blocksize);
+      ZeroCrossingPitchDetector zc2(sr, blocksize);
+      zc1.setLowPassCutoff(2000);
+      zc1.setHighPassCutoff(20);
+      zc2.setLowPassCutoff(2000);
+      zc2.setHighPassCutoff(20);
+      FloatArray block1 = FloatArray::create(blocksize);
+      FloatArray block2 = FloatArray::create(blocksize);
+      for(int n=0; n<64; ++n){
+	for(int i=0; i<blocksize; ++i){
+	  block1[i] = sinf(2*M_PI*200*(n*blocksize+i)/sr);
+	  block2[i] = sinf(2*M_PI*300*(n*blocksize+i)/sr);
+	}
+	zc1.process(block1);
+	zc2.process(block2);
+      }
+      CHECK_CLOSE(zc1.getFrequency(), 200, 2);
+      CHECK_CLOSE(zc2.getFrequency(), 300, 3);
+      FloatArray::destroy(block1);
+      FloatArray::destroy(block2);
+    }
+  }
+};
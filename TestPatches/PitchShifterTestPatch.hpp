@@ -0,0 +1,147 @@
+#include "TestPatch.hpp"
+#include "PitchShifter.h"
+#include "FastFourierTransform.h"
+
+class PitchShifterTestPatch : public TestPatch {
+public:
+  static const int FFT_SIZE = 4096;
+  float sr;
+  FastFourierTransform fft;
+  ComplexFloatArray spectrum;
+  FloatArray magnitude;
+  FloatArray signal;
+
+  /* shift **signal** in blocks, in place */
+  void shift(PitchShifter* shifter){
+    for(int i=0; i<signal.getSize(); i+=getBlockSize()){
+      FloatArray block = signal.subArray(i, getBlockSize());
+      shifter->process(block, block);
+    }
+  }
+
+  /* frequency of the strongest component between **minimum** and **maximum** Hz, at the end of **signal** */
+  float getPeak(float minimum, float maximum = 24000){
+    FloatArray end = signal.subArray(signal.getSize()-FFT_SIZE, FFT_SIZE);
+    FloatArray windowed = FloatArray::create(FFT_SIZE);
+    windowed.copyFrom(end);
+    Window hann = Window::create(Window::HannWindow, FFT_SIZE);
+    hann.apply(windowed);
+    fft.fft(windowed, spectrum);
+    spectrum.getMagnitudeValues(magnitude);
+    int first = (int)(minimum*FFT_SIZE/sr);
+    int last = min(FFT_SIZE/2, (int)(maximum*FFT_SIZE/sr));
+    magnitude.subArray(0, first).clear();
+    magnitude.subArray(last, FFT_SIZE/2-last).clear();
+    float peak = magnitude.getMaxIndex()*sr/FFT_SIZE;
+    Window::destroy(hann);
+    FloatArray::destroy(windowed);
+    return peak;
+  }
+
+  void sine(float frequency){
+    for(int i=0; i<signal.getSize(); ++i)
+      signal[i] = 0.5f*sinf(2*M_PI*frequency*i/sr);
+  }
+
+  /* pulses at **f0** through a resonance at **formant** */
+  void voice(float f0, float formant){
+    int period = (int)(sr/f0);
+    for(int i=0; i<signal.getSize(); ++i){
+      int t = i % period;
+      signal[i] = expf(-t*2000.0f/sr)*sinf(2*M_PI*formant*t/sr);
+    }
+  }
+
+  PitchShifterTestPatch() : sr(48000) {
+    fft.init(FFT_SIZE);
+    spectrum = ComplexFloatArray::create(FFT_SIZE/2);
+    magnitude = FloatArray::create(FFT_SIZE/2);
+    signal = FloatArray::create(getBlockSize()*128);
+    {
+      TEST("latency");
+      PitchShifter* shifter = PitchShifter::create(sr, getBlockSize());
+      float ratios[] = {0.25, 0.5, 1, 1.5, 2};
+      for(int i=0; i<5; ++i){
+	shifter->setRatio(ratios[i]);
+	CHECK(shifter->getLatency() > 0);
+	CHECK(shifter->getLatency() < sr*0.01f);
+      }
+      // a tone that starts after silence is heard within 10ms
+      shifter->setRatio(1);
+      signal.clear();
+      int onset = getBlockSize()*40 + 17;
+      for(int i=onset; i<signal.getSize(); ++i)
+	signal[i] = 0.5f*sinf(2*M_PI*300*i/sr);
+      shift(shifter);
+      int first = 0;
+      while(first < signal.getSize() && fabsf(signal[first]) < 0.05f)
+	first++;
+      CHECK(first >= onset);
+      CHECK(first < onset + sr*0.01f);
+      PitchShifter::destroy(shifter);
+    }
+    {
+      TEST("ratio");
+      float ratios[] = {1, 2, 0.75, 1.26};
+      for(int i=0; i<4; ++i){
+	PitchShifter* shifter = PitchShifter::create(sr, getBlockSize());
+	shifter->setRatio(ratios[i]);
+	sine(220);
+	float rms = signal.getRms();
+	shift(shifter);
+	CHECK_CLOSE(getPeak(50), 220*ratios[i], 12);
+	// level is kept, with a little loss at the splices
+	CHECK(signal.subArray(getBlockSize()*8, signal.getSize()-getBlockSize()*8).getRms() > rms*0.8f);
+	CHECK(signal.getRms() < rms*1.1f);
+	PitchShifter::destroy(shifter);
+      }
+    }
+    {
+      TEST("splices");
+      // at ratio 1, matched splices leave a steady tone almost unchanged
+      PitchShifter* shifter = PitchShifter::create(sr, getBlockSize());
+      sine(330);
+      shift(shifter);
+      FloatArray steady = signal.subArray(getBlockSize()*8, signal.getSize()-getBlockSize()*8);
+      CHECK(steady.getMaxValue() < 0.51f);
+      CHECK(steady.getMaxValue() > 0.47f);
+      CHECK(steady.getMinValue() > -0.51f);
+      PitchShifter::destroy(shifter);
+    }
+    {
+      TEST("formant preservation");
+      float f0 = 200;
+      float ratio = 1.5;
+      PitchShifter* shifter = PitchShifter::create(sr, getBlockSize());
+      shifter->setRatio(ratio);
+      shifter->setFormantPreservation(true);
+      voice(f0, 2000);
+      shift(shifter);
+      CHECK_CLOSE(shifter->getPeriod(), sr/f0, 2);
+      CHECK(shifter->getLatency() < sr*0.01f);
+      // the fundamental is shifted, the resonance stays
+      float resonance = getPeak(1000);
+      CHECK(resonance > 1700 && resonance < 2300);
+      CHECK_CLOSE(getPeak(100, 450), f0*ratio, 12);
+      // without formant preservation, the resonance moves
+      shifter->setFormantPreservation(false);
+      shifter->reset();
+      voice(f0, 2000);
+      shift(shifter);
+      resonance = getPeak(1000);
+      CHECK(resonance > 2700 && resonance < 3300);
+      // input without a pitch is passed through
+      shifter->setFormantPreservation(true);
+      shifter->reset();
+      sine(220);
+      for(int i=0; i<signal.getSize(); ++i)
+	signal[i] = 0;
+      shift(shifter);
+      CHECK_EQUAL(shifter->getPeriod(), 0.0f);
+      PitchShifter::destroy(shifter);
+    }
+    ComplexFloatArray::destroy(spectrum);
+    FloatArray::destroy(magnitude);
+    FloatArray::destroy(signal);
+  }
+};
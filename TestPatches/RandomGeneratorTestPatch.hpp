@@ -0,0 +1,116 @@
+#include "TestPatch.hpp"
+#include "RandomGenerator.h"
+#include "NoiseOscillator.h"
+#include "FastFourierTransform.h"
+
+class RandomGeneratorTestPatch : public TestPatch {
+public:
+  /* normalised correlation of two zero mean signals */
+  static float getCorrelation(FloatArray x, FloatArray y){
+    float xy = 0, xx = 0, yy = 0;
+    for(int i=0; i<x.getSize(); ++i){
+      xy += x[i]*y[i];
+      xx += x[i]*x[i];
+      yy += y[i]*y[i];
+    }
+    return xy/sqrtf(xx*yy);
+  }
+
+  RandomGeneratorTestPatch(){
+    const int size = 4096;
+    FloatArray x = FloatArray::create(size);
+    {
+      TEST("uniform");
+      RandomGenerator generator;
+      generator.fill(x);
+      CHECK(x.getMinValue() >= -1);
+      CHECK(x.getMaxValue() < 1);
+      CHECK_CLOSE(x.getMean(), 0, 0.05);
+      CHECK_CLOSE(x.getVariance(), 1.0/3, 0.02);
+      generator.fill(x, 10, 20);
+      CHECK(x.getMinValue() >= 10);
+      CHECK(x.getMaxValue() < 20);
+      CHECK_CLOSE(x.getMean(), 15, 0.2);
+      int counts[8] = {};
+      for(int i=0; i<size; ++i)
+	counts[(int)(generator.getNextFloat()*8)]++;
+      bool flat = true;
+      for(int i=0; i<8; ++i)
+	flat &= abs(counts[i] - size/8) < size/32;
+      CHECK(flat);
+    }
+    {
+      TEST("seed");
+      RandomGenerator a(1234);
+      RandomGenerator b(1234);
+      a.fill(x);
+      bool equal = true;
+      for(int i=0; i<size; ++i)
+	equal &= x[i] == b.getNextSample();
+      CHECK(equal);
+      b.setSeed(0);
+      CHECK(b.getNextValue() != 0);
+    }
+    {
+      TEST("default seeds");
+      // generators and oscillators made without a seed are uncorrelated
+      RandomGenerator a, b;
+      FloatArray y = FloatArray::create(size);
+      a.fill(x);
+      b.fill(y);
+      CHECK(fabsf(getCorrelation(x, y)) < 0.08f);
+      WhiteNoiseOscillator* left = WhiteNoiseOscillator::create();
+      WhiteNoiseOscillator* right = WhiteNoiseOscillator::create();
+      left->getSamples(x);
+      right->getSamples(y);
+      CHECK(fabsf(getCorrelation(x, y)) < 0.08f);
+      WhiteNoiseOscillator::destroy(left);
+      WhiteNoiseOscillator::destroy(right);
+      FloatArray::destroy(y);
+    }
+    {
+      TEST("white noise");
+      WhiteNoiseOscillator* white = WhiteNoiseOscillator::create();
+      white->getSamples(x);
+      CHECK(x.getMinValue() >= -1);
+      CHECK(x.getMaxValue() < 1);
+      CHECK(x.getRms() > 0.5);
+      WhiteNoiseOscillator::destroy(white);
+    }
+    {
+      TEST("pink noise");
+      PinkNoiseOscillator* block = new PinkNoiseOscillator(5678);
+      PinkNoiseOscillator* single = new PinkNoiseOscillator(5678);
+      block->getSamples(x);
+      bool equal = true;
+      for(int i=0; i<size; ++i)
+	equal &= fabsf(x[i] - single->getNextSample()) < 0.000001;
+      CHECK(equal);
+      // average power spectrum: equal power per octave
+      const int fftSize = 1024;
+      FastFourierTransform fft(fftSize);
+      ComplexFloatArray spectrum = ComplexFloatArray::create(fftSize/2);
+      FloatArray power = FloatArray::create(fftSize/2);
+      power.clear();
+      for(int frame=0; frame<256; ++frame){
+	FloatArray input = x.subArray(0, fftSize);
+	block->getSamples(input);
+	fft.fft(input, spectrum);
+	for(int k=0; k<fftSize/2; ++k)
+	  power[k] += spectrum[k].getMagnitude()*spectrum[k].getMagnitude();
+      }
+      float octaves[4];
+      for(int o=0; o<4; ++o)
+	octaves[o] = power.subArray(16<<o, 16<<o).getMean()*(16<<o);
+      for(int o=1; o<4; ++o)
+	CHECK_CLOSE(10*log10f(octaves[o]/octaves[0]), 0, 1.5);
+      CHECK(x.getMaxValue() < 1);
+      CHECK(x.getMinValue() > -1);
+      ComplexFloatArray::destroy(spectrum);
+      FloatArray::destroy(power);
+      PinkNoiseOscillator::destroy(block);
+      PinkNoiseOscillator::destroy(single);
+    }
+    FloatArray::destroy(x);
+  }
+};
@@ -0,0 +1,224 @@
+#include "TestPatch.hpp"
+#include "SampleBank.h"
+#include "Looper.h"
+
+class SampleBankTestPatch : public TestPatch {
+public:
+  /* make an image with a float sample and a stereo PCM16 sample, as made by Tools/MakeSampleBank.c */
+  static uint32_t* makeBank(int length){
+    int offset = sizeof(SampleBankHeader) + 2*sizeof(SampleBankEntry);
+    int size = offset + length*sizeof(float) + 2*length*sizeof(int16_t);
+    uint32_t* image = new uint32_t[size/4];
+    memset(image, 0, size);
+    SampleBankHeader* header = (SampleBankHeader*)image;
+    header->magic = SAMPLEBANK_MAGIC;
+    header->version = SAMPLEBANK_VERSION;
+    header->size = size;
+    header->count = 2;
+    SampleBankEntry* entries = (SampleBankEntry*)(header+1);
+    strcpy(entries[0].name, "ramp");
+    entries[0].offset = offset;
+    entries[0].length = length;
+    entries[0].channels = 1;
+    entries[0].format = SAMPLEBANK_FLOAT32;
+    entries[0].sampleRate = 48000;
+    entries[0].loopStart = 100;
+    entries[0].loopEnd = 200;
+    float* ramp = (float*)((uint8_t*)image + offset);
+    for(int i=0; i<length; ++i)
+      ramp[i] = i*0.001f;
+    strcpy(entries[1].name, "stereo");
+    entries[1].offset = offset + length*sizeof(float);
+    entries[1].length = length;
+    entries[1].channels = 2;
+    entries[1].format = SAMPLEBANK_PCM16;
+    entries[1].sampleRate = 24000;
+    int16_t* pcm = (int16_t*)((uint8_t*)image + entries[1].offset);
+    for(int i=0; i<length; ++i){
+      pcm[i] = i*16;
+      pcm[length+i] = -i*16;
+    }
+    return image;
+  }
+
+  SampleBankTestPatch(){
+    const float sr = 48000;
+    const int length = 1000;
+    uint32_t* image = makeBank(length);
+    FloatArray left = FloatArray::create(getBlockSize());
+    FloatArray right = FloatArray::create(getBlockSize());
+    {
+      TEST("bank");
+      SampleBank bank = SampleBank::create(image);
+      CHECK(bank.isValid());
+      CHECK_EQUAL(bank.getNumberOfSamples(), 2);
+      CHECK_EQUAL(bank.getIndex("stereo"), 1);
+      CHECK_EQUAL(bank.getIndex("missing"), -1);
+      CHECK(!bank.getSample("missing").isValid());
+      BankSample ramp = bank.getSample("ramp");
+      CHECK_EQUAL(ramp.getLength(), length);
+      CHECK_EQUAL(ramp.getLoopEnd(), 200);
+      // float samples are read in place
+      CHECK(ramp.getFloatChannel(0).getData() == (float*)((uint8_t*)image + sizeof(SampleBankHeader) + 2*sizeof(SampleBankEntry)));
+      BankSample stereo = bank.getSample(1);
+      CHECK(!stereo.isLooped());
+      CHECK_EQUAL(stereo.getLoopEnd(), length);
+      CHECK_CLOSE(stereo.get(1, 10), -160/32768.0f, 1e-9);
+      stereo.read(0, length-100, left);
+      CHECK_CLOSE(left[99], (length-1)*16/32768.0f, 1e-9);
+      CHECK_EQUAL(left[100], 0.0f);
+      uint32_t garbage[16] = {};
+      CHECK(!SampleBank::create(garbage).isValid());
+      CHECK_EQUAL(SampleBank::create(garbage).getNumberOfSamples(), 0);
+    }
+    {
+      TEST("varispeed playback");
+      SampleBank bank(image);
+      SamplePlayer player(sr);
+      player.setSample(bank.getSample("ramp"));
+      player.trigger();
+      left.clear();
+      player.process(left);
+      CHECK_EQUAL(left[0], 0.0f);
+      CHECK_CLOSE(left[100], 0.1f, 1e-6);
+      // interpolation is exact on a straight line
+      player.setSpeed(0.25);
+      left.clear();
+      player.process(left);
+      CHECK_CLOSE(left[1], 0.12825f, 1e-5);
+      // the PCM16 sample at half the sampling rate plays at half speed, in stereo
+      player.setSample(bank.getSample("stereo"));
+      player.setSpeed(1);
+      player.trigger(10);
+      left.clear();
+      right.clear();
+      player.process(left, right);
+      CHECK_CLOSE(left[3], 11.5f*16/32768, 1e-6);
+      CHECK_CLOSE(right[3], -11.5f*16/32768, 1e-6);
+      // one shot playback ends
+      for(int i=0; i<20; ++i)
+	player.process(left, right);
+      CHECK(!player.isPlaying());
+    }
+    {
+      TEST("loop points");
+      SampleBank bank(image);
+      SamplePlayer player(sr);
+      player.setSample(bank.getSample("ramp"));
+      player.setLooping(true);
+      player.setSpeed(1.5);
+      player.trigger();
+      FloatArray output = FloatArray::create(2048);
+      player.process(output);
+      CHECK(player.isPlaying());
+      // Hermite overshoots a little at the step from the end to the start of the loop
+      CHECK(output.getMaxValue() < 0.21f);
+      CHECK(player.getPosition() >= 100 && player.getPosition() < 200);
+      // in reverse, from the end of the loop
+      player.setSpeed(-1);
+      player.trigger();
+      output.clear();
+      player.process(output);
+      CHECK_CLOSE(output[0], 0.199f, 1e-6);
+      CHECK_CLOSE(output[99], 0.1f, 1e-6);
+      CHECK_CLOSE(output[100], 0.199f, 1e-6);
+      FloatArray::destroy(output);
+    }
+    {
+      TEST("looper");
+      Looper* looper = Looper::create(sr, 1);
+      FloatArray input = FloatArray::create(getBlockSize());
+      FloatArray output = FloatArray::create(getBlockSize());
+      int len = getBlockSize()*8;
+      looper->record();
+      for(int b=0; b<8; ++b){
+	for(int i=0; i<input.getSize(); ++i)
+	  input[i] = sinf((b*input.getSize() + i)*0.01f);
+	looper->process(input, output);
+      }
+      CHECK_EQUAL(output.getMaxValue(), 0.0f);
+      CHECK_EQUAL(looper->getLength(), 0);
+      looper->play();
+      CHECK_EQUAL(looper->getLength(), len);
+      input.clear();
+      looper->process(input, output); // fade in
+      looper->process(input, output);
+      CHECK_CLOSE(output[5], sinf((getBlockSize() + 5)*0.01f), 1e-6);
+      // half speed, with the play position between samples
+      looper->setSpeed(0.5);
+      looper->setPosition(100.5);
+      looper->process(input, output);
+      CHECK_CLOSE(output[4], sinf(102.5f*0.01f), 1e-5);
+      looper->stop();
+      looper->process(input, output); // fade out
+      looper->process(input, output);
+      CHECK_EQUAL(output.getMaxValue(), 0.0f);
+      // stopping a recording shorter than MIN_LENGTH leaves no loop
+      looper->record();
+      looper->process(input.subArray(0, 8), output.subArray(0, 8));
+      looper->play();
+      CHECK_EQUAL(looper->getLength(), 0);
+      Looper::destroy(looper);
+      FloatArray::destroy(input);
+      FloatArray::destroy(output);
+    }
+    {
+      TEST("overdub");
+      // every loop sample is overdubbed exactly once per pass, at any speed
+      float speeds[] = {1, 0.37, 2.5, -0.8, -3};
+      for(int s=0; s<5; ++s){
+	int len = 1000;
+	Looper* looper = Looper::create(sr, 1);
+	FloatArray input = FloatArray::create(getBlockSize());
+	FloatArray output = FloatArray::create(getBlockSize());
+	looper->record();
+	input.clear();
+	for(int i=0; i<len; i+=input.getSize())
+	  looper->process(input.subArray(0, min(input.getSize(), len-i)), output.subArray(0, min(input.getSize(), len-i)));
+	looper->setSpeed(speeds[s]);
+	looper->overdub();
+	CHECK_EQUAL(looper->getLength(), len);
+	input.setAll(0.25);
+	looper->process(input, output); // fade in
+	FloatArray loop = looper->getLoop();
+	FloatArray before = FloatArray::create(len);
+	before.copyFrom(loop);
+	// just under one pass
+	int samples = (int)(len/fabsf(speeds[s])) - 2;
+	for(int i=0; i<samples; i+=input.getSize())
+	  looper->process(input.subArray(0, min(input.getSize(), samples-i)), output.subArray(0, min(input.getSize(), samples-i)));
+	int count = 0;
+	for(int i=0; i<len; ++i)
+	  count += fabsf(loop[i] - before[i] - 0.25f) < 1e-6;
+	CHECK(count >= samples*fabsf(speeds[s]) - 2);
+	before.subtract(loop);
+	CHECK(before.getMinValue() > -0.25f - 1e-6);
+	// replace the loop on the next pass
+	looper->setFeedback(0);
+	for(int i=0; i<samples; i+=input.getSize())
+	  looper->process(input.subArray(0, min(input.getSize(), samples-i)), output.subArray(0, min(input.getSize(), samples-i)));
+	count = 0;
+	for(int i=0; i<len; ++i)
+	  count += loop[i] == 0.25f;
+	CHECK(count >= samples*fabsf(speeds[s]) - 2);
+	FloatArray::destroy(before);
+	FloatArray::destroy(input);
+	FloatArray::destroy(output);
+	Looper::destroy(looper);
+      }
+    }
+    {
+      TEST("load");
+      SampleBank bank(image);
+      Looper* looper = Looper::create(sr, 1);
+      looper->load(bank.getSample("stereo"), 1);
+      CHECK_EQUAL(looper->getState(), Looper::PlayingState);
+      CHECK_EQUAL(looper->getLength(), length);
+      CHECK_CLOSE(looper->getLoop()[length-1], -(length-1)*16/32768.0f, 1e-9);
+      Looper::destroy(looper);
+    }
+    FloatArray::destroy(left);
+    FloatArray::destroy(right);
+    delete[] image;
+  }
+};
@@ -1,66 +1,140 @@
 #ifndef __ShortFastFourierTestPatch_hpp__
 #define __ShortFastFourierTestPatch_hpp__
 
-#include <stdlib.h>
-#include <stdio.h>
-#include "Patch.h"
+#include "TestPatch.hpp"
+#include "FastFourierTransform.h"
 #include "ShortFastFourierTransform.h"
 
-void prettyPrint(ComplexShortArray X){
-    printf("[");
-    for(int n = 0; n < X.getSize(); ++n){
-      printf("%d + %di; ", X[n].re, X[n].im);
-    }
-    printf("];\n\n");
-}
-void prettyPrint(ShortArray x){
-    printf("[");
-    for(int n = 0; n < x.getSize(); ++n){
-      printf("%d; ", x[n]);
-    }
-    printf("];\n\n");
-}
 class ShortFastFourierTestPatch : public TestPatch {
-private:
-  ShortFastFourierTransform transform;
-  ComplexShortArray X;
-  ShortArray x;
 public:
-  ShortFastFourierTestPatch(){
-    int fftSize = 512;
-    transform.init(fftSize);
-    X = ComplexShortArray::create(fftSize);
-    x = ShortArray::create(fftSize);
-// matlab code:
-/*
-fftSize = 512;
-x = mod( (0:fftSize-1)' * 4096, 32768) - 16384;
-X = fft(x)/fftSize;
-*/
-    for(int n = 0; n < x.getSize(); ++n){
-      x[n] = ((n * 4096) % 32768 ) - 16384;
+  /* a sine at a quarter of the amplitude, plus noise */
+  void signal(FloatArray x, float amplitude){
+    x.noise(-0.75*amplitude, 0.75*amplitude);
+    for(int n=0; n<x.getSize(); ++n)
+      x[n] += 0.25*amplitude*sinf(2*M_PI*n*13.3f/x.getSize());
+  }
+
+  /* signal to noise ratio in dB of bins 0 to N/2, against a packed float spectrum */
+  float snr(ComplexFloatArray expected, ComplexFloatArray actual, int half){
+    float signal = expected[0].re*expected[0].re + expected[0].im*expected[0].im;
+    float noise = (actual[0].re-expected[0].re)*(actual[0].re-expected[0].re)
+      + (actual[half].re-expected[0].im)*(actual[half].re-expected[0].im);
+    for(int k=1; k<half; ++k){
+      signal += expected[k].re*expected[k].re + expected[k].im*expected[k].im;
+      noise += (actual[k].re-expected[k].re)*(actual[k].re-expected[k].re)
+	+ (actual[k].im-expected[k].im)*(actual[k].im-expected[k].im);
     }
-    transform.fft(x, X);
-    ShortArray data((int16_t*)X.getData(), X.getSize() * 2);
-    printf("Xc=");
-// At this point the values of X are pretty similar to the ones in matlab.
-// But their magnitude is pretty small (~2048).
-// You could try to left shift them to increase the magnitude again and
-// reduce the rounding error that will be caused by the ifft:
-//    data.shift(16 - log2(data.getMaxValue()));
-//  but this would most likely cause saturation when you do ifft ! 
-    prettyPrint(X);
-    transform.ifft(X, x);
-// shift back to 1.15 
-    x.shift(log2(fftSize));
-// At this point, with infinite precision, x should be back to being exactly
-// the same as the one we started with, instead there are some large errors
-// (~1024)
-    printf("xc=");
-    prettyPrint(x);
+    return 10*log10f(signal/noise);
   }
-  ~ShortFastFourierTestPatch(){
-    ComplexShortArray::destroy(X);
+
+  ShortFastFourierTestPatch(){
+    {
+      TEST("headroom");
+      ComplexShortArray array = ComplexShortArray::create(16);
+      array.clear();
+      CHECK_EQUAL(array.getHeadroom(), 15);
+      array[3].im = 1;
+      CHECK_EQUAL(array.getHeadroom(), 14);
+      array[5].re = -1024;
+      CHECK_EQUAL(array.getHeadroom(), 5);
+      CHECK_EQUAL(array.normalise(), 5);
+      CHECK_EQUAL((int)array[5].re, -32768);
+      CHECK_EQUAL((int)array[3].im, 32);
+      CHECK_EQUAL(array.getHeadroom(), 0);
+      ComplexShortArray::destroy(array);
+    }
+    {
+      TEST("float conversion");
+      ComplexFloatArray source = ComplexFloatArray::create(64);
+      ComplexFloatArray destination = ComplexFloatArray::create(64);
+      ComplexShortArray array = ComplexShortArray::create(64);
+      float amplitudes[] = {0.001, 1, 3000};
+      for(int i=0; i<3; ++i){
+	FloatArray((float*)source.getData(), 128).noise(-amplitudes[i], amplitudes[i]);
+	int exponent = array.fromFloat(source);
+	CHECK(array.getHeadroom() == 0);
+	array.toFloat(destination, exponent);
+	float maxerr = 0;
+	for(int n=0; n<64; ++n)
+	  maxerr = max(maxerr, max(fabsf(destination[n].re-source[n].re), fabsf(destination[n].im-source[n].im)));
+	CHECK(maxerr <= amplitudes[i]/32768);
+      }
+      ComplexFloatArray::destroy(source);
+      ComplexFloatArray::destroy(destination);
+      ComplexShortArray::destroy(array);
+    }
+    {
+      TEST("SNR against float FFT");
+      for(int fftSize=32; fftSize<=4096; fftSize*=2){
+	FastFourierTransform reference(fftSize);
+	ShortFastFourierTransform transform(fftSize);
+	FloatArray x = FloatArray::create(fftSize);
+	ShortArray input = ShortArray::create(fftSize);
+	ComplexFloatArray expected = ComplexFloatArray::create(fftSize/2);
+	ComplexFloatArray actual = ComplexFloatArray::create(fftSize);
+	ComplexShortArray spectrum = ComplexShortArray::create(fftSize);
+	for(float amplitude = 1; amplitude > 0.0001; amplitude *= 0.1){
+	  signal(x, amplitude);
+	  input.copyFrom(x);
+	  // compare against the quantised input, to measure the transform alone
+	  input.copyTo(x);
+	  reference.fft(x, expected);
+	  int exponent = transform.fft(input, spectrum);
+	  spectrum.toFloat(actual, exponent);
+	  float bfp = snr(expected, actual, fftSize/2);
+	  // without block floating point: Q15 spectrum scaled by 1/fftSize
+	  for(int k=0; k<fftSize/2; ++k){
+	    actual[k].re = roundf(expected[k].re*32768/fftSize)*fftSize/32768;
+	    actual[k].im = roundf(expected[k].im*32768/fftSize)*fftSize/32768;
+	  }
+	  actual[fftSize/2].re = roundf(expected[0].im*32768/fftSize)*fftSize/32768;
+	  actual[0].im = 0;
+	  float fixed = snr(expected, actual, fftSize/2);
+	  // the error grows by about half a bit per stage, independently of the signal level
+	  CHECK(bfp > 72 - 3*log2i(fftSize));
+	  if(amplitude < 0.01){
+	    CHECK(bfp > fixed + 20);
+	  }
+	}
+	FloatArray::destroy(x);
+	ShortArray::destroy(input);
+	ComplexFloatArray::destroy(expected);
+	ComplexFloatArray::destroy(actual);
+	ComplexShortArray::destroy(spectrum);
+      }
+    }
+    {
+      TEST("inverse");
+      // a spectrum with a strong peak loses up to a bit per stage in the inverse:
+      // bounds just below the lowest SNR measured over 1000 signals, for sizes 32 to 4096
+      const float bounds[] = { 48, 47, 46, 40.5, 36.5, 31, 25, 21 };
+      for(int fftSize=32; fftSize<=4096; fftSize*=2){
+	ShortFastFourierTransform transform(fftSize);
+	FloatArray x = FloatArray::create(fftSize);
+	ShortArray input = ShortArray::create(fftSize);
+	ShortArray copy = ShortArray::create(fftSize);
+	ShortArray output = ShortArray::create(fftSize);
+	ComplexShortArray spectrum = ComplexShortArray::create(fftSize);
+	for(float amplitude = 1; amplitude > 0.001; amplitude *= 0.1){
+	  signal(x, amplitude);
+	  input.copyFrom(x);
+	  input.copyTo(copy);
+	  int exponent = transform.fft(copy, spectrum);
+	  transform.ifft(spectrum, output, exponent);
+	  float signal = 0, noise = 0;
+	  for(int n=0; n<fftSize; ++n){
+	    signal += (float)input[n]*input[n];
+	    noise += (float)(output[n]-input[n])*(output[n]-input[n]);
+	  }
+	  CHECK(10*log10f(signal/noise) > bounds[log2i(fftSize)-5]);
+	}
+	FloatArray::destroy(x);
+	ShortArray::destroy(input);
+	ShortArray::destroy(copy);
+	ShortArray::destroy(output);
+	ComplexShortArray::destroy(spectrum);
+      }
+    }
   }
 };
 
@@ -0,0 +1,88 @@
+#include "TestPatch.hpp"
+#include "ShortTimeFourierTransform.h"
+
+class SpectrumCounter : public ShortTimeFourierTransform {
+public:
+  int count;
+  SpectrumCounter(int frameSize, int hopSize)
+    : ShortTimeFourierTransform(frameSize, hopSize), count(0) {}
+  void processSpectrum(ComplexFloatArray bins){
+    count++;
+  }
+};
+
+class ShortTimeFourierTestPatch : public TestPatch {
+public:
+  ShortTimeFourierTestPatch(){
+    int blocksize = getBlockSize();
+    {
+      TEST("reconstruction");
+      // frame size, hop size
+      int sizes[][2] = {{512, 128}, {512, 64}, {1024, 256}, {1024, 512}, {480, 120}, {256, 256}};
+      for(int s=0; s<6; ++s){
+	// a Hann window without overlap would lose the samples at the frame edges
+	Window::WindowType type = sizes[s][0] == sizes[s][1] ? Window::RectangularWindow : Window::HannWindow;
+	ShortTimeFourierTransform* stft = ShortTimeFourierTransform::create(sizes[s][0], sizes[s][1], type);
+	CHECK_EQUAL(stft->getLatency(), sizes[s][0]+sizes[s][1]);
+	const int blocks = 64;
+	FloatArray input = FloatArray::create(blocksize*blocks);
+	FloatArray output = FloatArray::create(blocksize*blocks);
+	input.noise();
+	for(int b=0; b<blocks; ++b)
+	  stft->process(input.subArray(b*blocksize, blocksize), output.subArray(b*blocksize, blocksize));
+	int latency = stft->getLatency();
+	float maxerr = 0;
+	// skip the first frames, which overlap with silence
+	for(int i=latency+sizes[s][0]; i<output.getSize(); ++i)
+	  maxerr = max(maxerr, fabsf(output[i]-input[i-latency]));
+	CHECK(maxerr < 0.0001);
+	FloatArray::destroy(input);
+	FloatArray::destroy(output);
+	ShortTimeFourierTransform::destroy(stft);
+      }
+    }
+    {
+      TEST("in place");
+      ShortTimeFourierTransform stft(256, 64, Window::HammingWindow);
+      FloatArray input = FloatArray::create(blocksize*16);
+      FloatArray buffer = FloatArray::create(blocksize);
+      for(int i=0; i<input.getSize(); ++i)
+	input[i] = sinf(2*M_PI*i/100.0f);
+      float maxerr = 0;
+      int latency = stft.getLatency();
+      for(int b=0; b<16; ++b){
+	input.subArray(b*blocksize, blocksize).copyTo(buffer);
+	stft.process(buffer, buffer);
+	for(int i=0; i<blocksize; ++i){
+	  int t = b*blocksize+i;
+	  if(t >= latency+256)
+	    maxerr = max(maxerr, fabsf(buffer[i]-input[t-latency]));
+	}
+      }
+      CHECK(maxerr < 0.0001);
+      FloatArray::destroy(input);
+      FloatArray::destroy(buffer);
+    }
+    {
+      TEST("amortized frames");
+      // four blocks per hop: at most one stage, so at most one spectrum, per block
+      SpectrumCounter counter(1024, blocksize*4);
+      FloatArray buffer = FloatArray::create(blocksize);
+      buffer.noise();
+      bool once = true;
+      for(int b=0; b<64; ++b){
+	int count = counter.count;
+	counter.process(buffer, buffer);
+	once &= counter.count - count <= 1;
+      }
+      CHECK(once);
+      CHECK_EQUAL(counter.count, 64/4-1);
+      // hop shorter than the block: several frames per block
+      SpectrumCounter fast(256, blocksize/4);
+      for(int b=0; b<8; ++b)
+	fast.process(buffer, buffer);
+      CHECK(fast.count >= 8*4-2);
+      FloatArray::destroy(buffer);
+    }
+  }
+};
@@ -51,6 +51,17 @@ public:
     success = false;
     failed++;
   }
+  /** amplitude of frequency f (cycles per sample) in x, from a Hann windowed DFT */
+  static float getAmplitude(FloatArray x, float f){
+    float re = 0, im = 0, norm = 0;
+    for(int i=0; i<x.getSize(); ++i){
+      float w = 0.5f*(1-cosf(2*M_PI*i/x.getSize()));
+      re += w*x[i]*cosf(2*M_PI*f*i);
+      im += w*x[i]*sinf(2*M_PI*f*i);
+      norm += w;
+    }
+    return 2*sqrtf(re*re+im*im)/norm;
+  }
   TestPatch(): success(true), passed(0), failed(0), errormessage((char*)DEFAULT_MESSAGE){
   }
 
@@ -0,0 +1,135 @@
+#include "TestPatch.hpp"
+#include "VoiceAllocator.h"
+
+/* outputs its note number while held, and for the first 10 samples of its release */
+class TestVoice {
+public:
+  uint8_t note;
+  int release;
+  bool held;
+  TestVoice() : note(0), release(0), held(false) {}
+  void noteOn(uint8_t n, uint16_t velocity){
+    note = n;
+    held = true;
+  }
+  void noteOff(){
+    held = false;
+    release = 10;
+  }
+  bool isActive(){
+    return held || release > 0;
+  }
+  void render(FloatArray output){
+    for(int i=0; i<output.getSize(); ++i){
+      if(held || release-- > 0)
+	output[i] += note;
+    }
+  }
+};
+
+class VoiceAllocatorTestPatch : public TestPatch {
+public:
+  VoiceAllocatorTestPatch(){
+    FloatArray output = FloatArray::create(getBlockSize());
+    {
+      TEST("sample offset");
+      VoiceAllocator<TestVoice, 4> voices;
+      CHECK(voices.buttonChanged((PatchButtonId)(MIDI_NOTE_BUTTON+60), 100, 10));
+      CHECK(!voices.buttonChanged(PUSHBUTTON, 4095, 0));
+      voices.buttonChanged((PatchButtonId)(MIDI_NOTE_BUTTON+60), 0, 50);
+      voices.process(output);
+      CHECK_EQUAL(output[9], 0.0f);
+      CHECK_EQUAL(output[10], 60.0f);
+      CHECK_EQUAL(output[59], 60.0f);
+      CHECK_EQUAL(output[60], 0.0f);
+      CHECK_EQUAL(voices.getNumberOfActiveVoices(), 0);
+    }
+    {
+      TEST("events out of order");
+      VoiceAllocator<TestVoice, 4> voices;
+      voices.noteOn(61, 100, 20);
+      voices.noteOn(60, 100, 10);
+      voices.process(output);
+      CHECK_EQUAL(output[15], 60.0f);
+      CHECK_EQUAL(output[25], 121.0f);
+      CHECK(voices.isNoteOn(60));
+      CHECK(voices.isNoteOn(61));
+      CHECK_EQUAL(voices.getNumberOfActiveVoices(), 2);
+    }
+    {
+      TEST("round robin");
+      VoiceAllocator<TestVoice, 4> voices;
+      voices.noteOn(60, 100);
+      voices.noteOff(60);
+      voices.noteOn(62, 100);
+      voices.process(output);
+      // the released voice keeps sounding while the next voice takes the new note
+      CHECK_EQUAL(voices.getVoice(0).note, (uint8_t)60);
+      CHECK_EQUAL(voices.getVoice(1).note, (uint8_t)62);
+      for(int i=0; i<5; ++i)
+	voices.noteOn(70+i, 100);
+      voices.process(output);
+      CHECK_EQUAL(voices.getNumberOfActiveVoices(), 4);
+      CHECK(!voices.isNoteOn(62));
+      CHECK(voices.isNoteOn(74));
+      // with all voices in use, a released voice is taken before the held voice next in turn
+      voices.noteOff(72);
+      voices.process(output.subArray(0, 4)); // still in its release
+      voices.noteOn(80, 100);
+      voices.process(output.subArray(0, 4));
+      CHECK(voices.isNoteOn(71));
+      CHECK(voices.isNoteOn(73));
+      CHECK(voices.isNoteOn(74));
+      CHECK(voices.isNoteOn(80));
+      CHECK_EQUAL(voices.getVoice(0).note, (uint8_t)80);
+    }
+    {
+      TEST("steal oldest");
+      VoiceAllocator<TestVoice, 4> voices;
+      voices.setPolicy(VoiceAllocator<TestVoice, 4>::OldestAllocation);
+      voices.noteOn(64, 100);
+      voices.noteOn(60, 100);
+      voices.noteOn(67, 100);
+      voices.noteOn(62, 100);
+      voices.noteOn(72, 100);
+      voices.process(output);
+      CHECK(!voices.isNoteOn(64));
+      CHECK(voices.isNoteOn(60));
+      CHECK(voices.isNoteOn(72));
+      // released voices are taken before held voices
+      voices.noteOff(67);
+      voices.noteOn(74, 100);
+      voices.process(output);
+      CHECK(voices.isNoteOn(60));
+      CHECK(voices.isNoteOn(74));
+    }
+    {
+      TEST("steal lowest");
+      VoiceAllocator<TestVoice, 4> voices;
+      voices.setPolicy(VoiceAllocator<TestVoice, 4>::LowestAllocation);
+      voices.noteOn(64, 100);
+      voices.noteOn(60, 100);
+      voices.noteOn(67, 100);
+      voices.noteOn(62, 100);
+      voices.noteOn(72, 100);
+      voices.process(output);
+      CHECK(!voices.isNoteOn(60));
+      CHECK(voices.isNoteOn(62));
+      CHECK(voices.isNoteOn(72));
+    }
+    {
+      TEST("retrigger");
+      VoiceAllocator<TestVoice, 4> voices;
+      voices.noteOn(60, 100);
+      voices.noteOn(60, 100);
+      voices.process(output);
+      CHECK_EQUAL(voices.getNumberOfActiveVoices(), 1);
+      voices.allNotesOff();
+      voices.process(output);
+      CHECK_EQUAL(output[9], 60.0f);
+      CHECK_EQUAL(output[10], 0.0f);
+      CHECK_EQUAL(voices.getNumberOfActiveVoices(), 0);
+    }
+    FloatArray::destroy(output);
+  }
+};
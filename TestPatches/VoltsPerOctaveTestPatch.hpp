@@ -0,0 +1,61 @@
+#include "TestPatch.hpp"
+#include "VoltsPerOctave.h"
+
+class VoltsPerOctaveTestPatch : public TestPatch {
+public:
+  VoltsPerOctaveTestPatch(){
+    const int size = 1000;
+    FloatArray x = FloatArray::create(size);
+    FloatArray y = FloatArray::create(size);
+    {
+      TEST("fastExp2");
+      for(int i=0; i<size; ++i)
+	x[i] = -40 + 80.0f*i/size + 0.0123f;
+      x.fastExp2(y);
+      float maxerr = 0;
+      for(int i=0; i<size; ++i){
+	float error = fabs(y[i]/exp2(x[i]) - 1);
+	maxerr = max(maxerr, error);
+      }
+      CHECK(maxerr < 3e-6);
+      // integers are exact
+      for(int i=0; i<size; ++i)
+	x[i] = i%40 - 20;
+      x.fastExp2();
+      bool exact = true;
+      for(int i=0; i<size; ++i)
+	exact &= x[i] == ldexpf(1, i%40 - 20);
+      CHECK(exact);
+      // limited range
+      x[0] = -1000;
+      x[1] = 1000;
+      x.subArray(0, 2).fastExp2();
+      CHECK(x[0] > 0);
+      CHECK(std::isfinite(x[1]));
+    }
+    {
+      TEST("block frequency");
+      VoltsPerOctave hz(0.1, 5.0);
+      hz.setTune(-1.0/12);
+      for(int i=0; i<size; ++i)
+	x[i] = -1 + 2.0f*i/size;
+      hz.getFrequency(x, y);
+      float maxcents = 0;
+      for(int i=0; i<size; ++i){
+	double exact = 440*exp2(((double)x[i] - 0.1)*5.0 - 1.0/12);
+	float cents = fabs(1200*log2(y[i]/exact));
+	maxcents = max(maxcents, cents);
+      }
+      CHECK(maxcents < 0.01);
+      CHECK_CLOSE(hz.getFrequency(0.1f + 1.0f/60), 440, 0.001);
+      // in place
+      hz.getFrequency(x);
+      bool equal = true;
+      for(int i=0; i<size; ++i)
+	equal &= x[i] == y[i];
+      CHECK(equal);
+    }
+    FloatArray::destroy(x);
+    FloatArray::destroy(y);
+  }
+};
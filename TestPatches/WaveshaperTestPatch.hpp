@@ -0,0 +1,118 @@
+#include "TestPatch.hpp"
+#include "Waveshaper.h"
+#include "FastFourierTransform.h"
+
+class WaveshaperTestPatch : public TestPatch {
+public:
+  /* power of the components of x that are not harmonics of bin k, in dB relative to the total */
+  float getAliasLevel(FloatArray x, int k){
+    FastFourierTransform fft(x.getSize());
+    ComplexFloatArray spectrum = ComplexFloatArray::create(x.getSize());
+    for(int i=0; i<x.getSize(); ++i)
+      x[i] *= 0.5f*(1-cosf(2*M_PI*i/x.getSize()));
+    fft.fft(x, spectrum);
+    float total = 0, alias = 0;
+    for(int i=2; i<x.getSize()/2; ++i){
+      float power = spectrum[i].getMagnitude()*spectrum[i].getMagnitude();
+      int d = i % k;
+      if(d > 1 && d < k-1)
+	alias += power;
+      total += power;
+    }
+    ComplexFloatArray::destroy(spectrum);
+    return 10*log10f(alias/total);
+  }
+  /* alias level of a shaped sine at bin k */
+  float getAliasLevel(Waveshaper* shaper, float gain, int k){
+    const int size = 4096;
+    FloatArray x = FloatArray::create(size);
+    int blocksize = getBlockSize();
+    for(int j=0; j<2; ++j){
+      for(int i=0; i<size; ++i)
+	x[i] = gain*sinf(2*M_PI*k*i/size);
+      // first pass settles the state of the shaper
+      for(int i=0; i<size; i+=blocksize)
+	shaper->process(x.subArray(i, blocksize), x.subArray(i, blocksize));
+    }
+    float level = getAliasLevel(x, k);
+    FloatArray::destroy(x);
+    return level;
+  }
+  WaveshaperTestPatch(){
+    {
+      TEST("curves");
+      Waveshaper* tanh = Waveshaper::create(Waveshaper::TanhCurve);
+      Waveshaper* clip = Waveshaper::create(Waveshaper::HardClipCurve);
+      Waveshaper* tube = Waveshaper::create(Waveshaper::TubeCurve);
+      float maxerr = 0;
+      for(float x=-10; x<10; x+=0.01)
+	maxerr = max(maxerr, fabsf(tanh->getCurve(x) - tanhf(x)));
+      CHECK(maxerr < 0.0001);
+      CHECK_EQUAL(clip->getCurve(0.5), 0.5f);
+      CHECK_EQUAL(clip->getCurve(-3), -1.0f);
+      CHECK_CLOSE(tube->getCurve(2), tanhf(2), 0.0001);
+      CHECK_CLOSE(tube->getCurve(-2), tanhf(-4)*0.5, 0.0001);
+      Waveshaper::destroy(tanh);
+      Waveshaper::destroy(clip);
+      Waveshaper::destroy(tube);
+    }
+    {
+      TEST("slow input");
+      // antialiased output follows the curve, delayed by half a sample per order
+      for(int order=0; order<3; ++order){
+	Waveshaper* shaper = Waveshaper::create(Waveshaper::TanhCurve, order);
+	float maxerr = 0;
+	for(int i=0; i<4000; ++i){
+	  float x = 4*sinf(2*M_PI*i/4000);
+	  float y = shaper->process(x);
+	  float expected = tanhf(4*sinf(2*M_PI*(i-0.5f*order)/4000));
+	  if(i > 2)
+	    maxerr = max(maxerr, fabsf(y - expected));
+	}
+	CHECK(maxerr < 0.0002);
+	Waveshaper::destroy(shaper);
+      }
+    }
+    {
+      TEST("lookup table");
+      FloatArray table = FloatArray::create(65);
+      for(int i=0; i<table.getSize(); ++i){
+	float x = -1 + 2.0f*i/(table.getSize()-1);
+	table[i] = x*x*x;
+      }
+      Waveshaper* shaper = Waveshaper::create(table, 2);
+      CHECK_CLOSE(shaper->getCurve(0.5), 0.125, 0.001);
+      CHECK_EQUAL(shaper->getCurve(2), 1.0f);
+      // constant input gives the curve value
+      for(int i=0; i<3; ++i)
+	shaper->process(-0.5f);
+      CHECK_CLOSE(shaper->process(-0.5f), -0.125, 0.001);
+      FloatArray::destroy(table);
+      Waveshaper::destroy(shaper);
+    }
+    {
+      TEST("aliasing");
+      // 4.7kHz at 48kHz sampling rate, driven hard into the curve
+      const int k = 401;
+      Waveshaper::WaveshaperCurve curves[] = {Waveshaper::TanhCurve, Waveshaper::HardClipCurve, Waveshaper::TubeCurve};
+      for(int c=0; c<3; ++c){
+	float levels[3];
+	for(int order=0; order<3; ++order){
+	  Waveshaper* shaper = Waveshaper::create(curves[c], order);
+	  levels[order] = getAliasLevel(shaper, 4, k);
+	  Waveshaper::destroy(shaper);
+	}
+	CHECK(levels[1] < levels[0] - 8);
+	CHECK(levels[2] < levels[1] - 8);
+	// second order ADAA at 2x oversampling against 4x oversampling without ADAA
+	Waveshaper* adaa = Waveshaper::create(curves[c], 2);
+	adaa->setOversampling(2, getBlockSize());
+	Waveshaper* naive = Waveshaper::create(curves[c], 0);
+	naive->setOversampling(4, getBlockSize());
+	CHECK(getAliasLevel(adaa, 4, k) < getAliasLevel(naive, 4, k) + 3);
+	Waveshaper::destroy(adaa);
+	Waveshaper::destroy(naive);
+      }
+    }
+  }
+};
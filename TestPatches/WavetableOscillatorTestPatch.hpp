@@ -0,0 +1,171 @@
+#include "TestPatch.hpp"
+#include "WavetableOscillator.h"
+#include "FastFourierTransform.h"
+#include "Window.h"
+
+class WavetableOscillatorTestPatch : public TestPatch {
+public:
+  WavetableOscillatorTestPatch(){
+    const float sr = 48000;
+    {
+      TEST("mipmaps");
+      Wavetable* table = Wavetable::createSine(1024);
+      CHECK_EQUAL(table->getNumberOfLevels(), 9);
+      CHECK_EQUAL((int)table->getTable(0, 0).getSize(), 1024);
+      CHECK_EQUAL((int)table->getTable(0, 2).getSize(), 256);
+      CHECK_EQUAL((int)table->getTable(0, 8).getSize(), 256);
+      bool sine = true;
+      for(int l=0; l<9; ++l){
+	FloatArray level = table->getTable(0, l);
+	for(int i=0; i<level.getSize(); ++i)
+	  sine &= fabsf(level[i] - sinf(2*M_PI*i/level.getSize())) < 0.00001;
+      }
+      CHECK(sine);
+      Wavetable::destroy(table);
+    }
+    {
+      TEST("sine");
+      WavetableOscillator* osc = WavetableOscillator::create(sr, 1024);
+      float freqs[] = {20, 440, 1000, 5000, 15000};
+      for(int f=0; f<5; ++f){
+	for(int type=0; type<2; ++type){
+	  osc->reset();
+	  osc->setFrequency(freqs[f]);
+	  osc->setInterpolation((WavetableOscillator::InterpolationType)type);
+	  float maxerr = 0;
+	  for(int i=0; i<1000; ++i){
+	    float error = fabsf(osc->getNextSample() - sinf(2*M_PI*i*freqs[f]/sr));
+	    maxerr = max(maxerr, error);
+	  }
+	  // the fundamental is read from tables of at least 256 samples
+	  CHECK(maxerr < (type == WavetableOscillator::LinearInterpolation ? 0.0005 : 0.0001));
+	}
+      }
+      WavetableOscillator::destroy(osc);
+    }
+    {
+      TEST("any size");
+      // a cycle that is not a power of two is resampled into the wavetable
+      FloatArray wave = FloatArray::create(1000);
+      for(int i=0; i<wave.getSize(); ++i)
+	wave[i] = sinf(2*M_PI*i/wave.getSize());
+      WavetableOscillator* osc = new WavetableOscillator(sr, wave);
+      CHECK_EQUAL(osc->getWavetable()->getSize(), 1024);
+      osc->setFrequency(440);
+      float maxerr = 0;
+      for(int i=0; i<1000; ++i){
+	float error = fabsf(osc->getNextSample() - sinf(2*M_PI*i*440/sr));
+	maxerr = max(maxerr, error);
+      }
+      CHECK(maxerr < 0.0005);
+      delete osc;
+      FloatArray::destroy(wave);
+    }
+    {
+      TEST("band limited");
+      const int size = 2048;
+      const int fftSize = 4096;
+      FloatArray saw = FloatArray::create(size);
+      for(int i=0; i<size; ++i)
+	saw[i] = 2.0f*i/size - 1;
+      WavetableOscillator osc(sr, saw);
+      osc.setInterpolation(WavetableOscillator::CubicInterpolation);
+      FloatArray output = FloatArray::create(fftSize);
+      ComplexFloatArray spectrum = ComplexFloatArray::create(fftSize/2);
+      FloatArray magnitudes = FloatArray::create(fftSize/2);
+      Window window = Window::create(Window::HannWindow, fftSize);
+      FastFourierTransform fft(fftSize);
+      // fundamentals on FFT bins, including frequencies crossfading between levels
+      int fundamentals[] = {16, 61, 133, 410};
+      for(int f=0; f<4; ++f){
+	osc.setFrequency(fundamentals[f]*sr/fftSize);
+	osc.getSamples(output);
+	output.multiply(window);
+	fft.fft(output, spectrum);
+	spectrum.getMagnitudeValues(magnitudes);
+	float harmonics = 0;
+	float aliases = 0;
+	for(int k=1; k<fftSize/2; ++k){
+	  // the Hann window spreads each harmonic over three bins
+	  int distance = k % fundamentals[f];
+	  if(distance <= 1 || distance == fundamentals[f]-1)
+	    harmonics += magnitudes[k]*magnitudes[k];
+	  else
+	    aliases += magnitudes[k]*magnitudes[k];
+	}
+	CHECK(10*log10f(aliases/harmonics) < -70);
+      }
+      FloatArray::destroy(saw);
+      FloatArray::destroy(output);
+      ComplexFloatArray::destroy(spectrum);
+      FloatArray::destroy(magnitudes);
+      Window::destroy(window);
+    }
+    {
+      TEST("morph");
+      const int size = 256;
+      FloatArray cycles = FloatArray::create(size*2);
+      for(int i=0; i<size; ++i){
+	cycles[i] = sinf(2*M_PI*i/size);
+	cycles[size+i] = -cycles[i];
+      }
+      Wavetable* table = Wavetable::create(cycles, size);
+      CHECK_EQUAL(table->getNumberOfWaveforms(), 2);
+      WavetableOscillator* osc = WavetableOscillator::create(sr, table);
+      CHECK_CLOSE(osc->getSample(0.25f), 1, 0.0001);
+      osc->setMorph(0.5);
+      CHECK_CLOSE(osc->getSample(0.25f), 0, 0.0001);
+      osc->setMorph(1);
+      CHECK_CLOSE(osc->getSample(0.25f), -1, 0.0001);
+      WavetableOscillator::destroy(osc);
+      Wavetable::destroy(table);
+      FloatArray::destroy(cycles);
+    }
+    {
+      TEST("frequency modulation");
+      WavetableOscillator* block = WavetableOscillator::create(sr, 512);
+      WavetableOscillator* single = WavetableOscillator::create(sr, 512);
+      FloatArray frequency = FloatArray::create(getBlockSize());
+      FloatArray output = FloatArray::create(getBlockSize());
+      for(int i=0; i<frequency.getSize(); ++i)
+	frequency[i] = 100*powf(2, 8.0f*i/frequency.getSize());
+      block->getSamples(output, frequency);
+      bool equal = true;
+      for(int i=0; i<output.getSize(); ++i){
+	single->setFrequency(frequency[i]);
+	equal &= output[i] == single->getNextSample();
+      }
+      CHECK(equal);
+      // the same while morphing, with either interpolation
+      FloatArray cycles = FloatArray::create(2*512);
+      for(int i=0; i<512; ++i){
+	cycles[i] = sinf(2*M_PI*i/512);
+	cycles[512+i] = i < 256 ? 0.5f : -0.5f;
+      }
+      Wavetable* table = Wavetable::create(cycles, 512);
+      WavetableOscillator* morphing = WavetableOscillator::create(sr, table);
+      WavetableOscillator* reference = WavetableOscillator::create(sr, table);
+      for(int type=0; type<2; ++type){
+	morphing->setInterpolation((WavetableOscillator::InterpolationType)type);
+	reference->setInterpolation((WavetableOscillator::InterpolationType)type);
+	morphing->setMorph(0.7);
+	reference->setMorph(0.7);
+	morphing->getSamples(output, frequency);
+	equal = true;
+	for(int i=0; i<output.getSize(); ++i){
+	  reference->setFrequency(frequency[i]);
+	  equal &= output[i] == reference->getNextSample();
+	}
+	CHECK(equal);
+      }
+      WavetableOscillator::destroy(morphing);
+      WavetableOscillator::destroy(reference);
+      Wavetable::destroy(table);
+      FloatArray::destroy(cycles);
+      FloatArray::destroy(frequency);
+      FloatArray::destroy(output);
+      WavetableOscillator::destroy(block);
+      WavetableOscillator::destroy(single);
+    }
+  }
+};
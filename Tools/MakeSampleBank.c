@@ -0,0 +1,164 @@
+/**
+ * gcc Tools/MakeSampleBank.c -o mkbank
+ * ./mkbank [-f] sample.wav ... > samples.bin
+ *
+ * Packs WAV files (16 or 24 bit PCM, or 32 bit float) into a sample bank image,
+ * as described in LibSource/SampleBankFormat.h. Samples are stored as PCM16, or as float
+ * with -f. The loop points of the first loop in a 'smpl' chunk are kept.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include "../LibSource/SampleBankFormat.h"
+
+#define MAX_SAMPLES 256
+
+typedef struct {
+  SampleBankEntry entry;
+  float* data; /* channels one after the other */
+} Sample;
+
+static uint32_t get32(const uint8_t* p){
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t* p){
+  return p[0] | (p[1] << 8);
+}
+
+static void setName(char* name, const char* path){
+  const char* base = strrchr(path, '/');
+  base = base ? base+1 : path;
+  strncpy(name, base, SAMPLEBANK_NAME_LENGTH-1);
+  name[SAMPLEBANK_NAME_LENGTH-1] = '\0';
+  char* ext = strrchr(name, '.');
+  if(ext)
+    memset(ext, 0, SAMPLEBANK_NAME_LENGTH - (ext - name));
+}
+
+static void readWav(const char* path, Sample* sample){
+  FILE* file = fopen(path, "rb");
+  if(!file)
+    err(1, "%s", path);
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t* wav = (uint8_t*)malloc(size);
+  if(fread(wav, 1, size, file) != (size_t)size)
+    err(1, "%s", path);
+  fclose(file);
+  if(size < 12 || memcmp(wav, "RIFF", 4) || memcmp(wav+8, "WAVE", 4))
+    errx(1, "%s: not a WAV file", path);
+  uint16_t format = 0, channels = 0, bits = 0;
+  uint32_t rate = 0, frames = 0;
+  uint8_t* data = NULL;
+  SampleBankEntry* entry = &sample->entry;
+  memset(entry, 0, sizeof(SampleBankEntry));
+  long pos = 12;
+  while(pos + 8 <= size){
+    uint8_t* chunk = wav + pos + 8;
+    uint32_t len = get32(wav+pos+4);
+    if(pos + 8 + len > size)
+      len = size - pos - 8;
+    if(!memcmp(wav+pos, "fmt ", 4) && len >= 16){
+      format = get16(chunk);
+      channels = get16(chunk+2);
+      rate = get32(chunk+4);
+      bits = get16(chunk+14);
+      if(format == 0xfffe && len >= 26)
+	format = get16(chunk+24); /* WAVE_FORMAT_EXTENSIBLE sub format */
+    }else if(!memcmp(wav+pos, "data", 4)){
+      data = chunk;
+      frames = len;
+    }else if(!memcmp(wav+pos, "smpl", 4) && len >= 36+24 && get32(chunk+28) > 0){
+      entry->loopStart = get32(chunk+36+8);
+      entry->loopEnd = get32(chunk+36+12) + 1; /* inclusive in the WAV file */
+    }
+    pos += 8 + len + (len & 1);
+  }
+  if(!data || channels == 0)
+    errx(1, "%s: missing format or data", path);
+  if(!((format == 1 && (bits == 16 || bits == 24)) || (format == 3 && bits == 32)))
+    errx(1, "%s: unsupported format %d with %d bits", path, format, bits);
+  frames /= channels*bits/8;
+  sample->data = (float*)malloc(sizeof(float)*frames*channels);
+  for(uint32_t i=0; i<frames; ++i){
+    for(int c=0; c<channels; ++c){
+      uint8_t* p = data + (i*channels + c)*bits/8;
+      float value;
+      if(bits == 16){
+	value = (int16_t)get16(p)/32768.0f;
+      }else if(bits == 24){
+	value = (int32_t)((p[0] << 8) | (p[1] << 16) | ((uint32_t)p[2] << 24))/2147483648.0f;
+      }else{
+	uint32_t u = get32(p);
+	memcpy(&value, &u, sizeof(float));
+      }
+      sample->data[c*frames + i] = value;
+    }
+  }
+  free(wav);
+  setName(entry->name, path);
+  entry->length = frames;
+  entry->channels = channels;
+  entry->sampleRate = rate;
+  if(entry->loopEnd > frames || entry->loopStart >= entry->loopEnd)
+    entry->loopStart = entry->loopEnd = 0;
+}
+
+static uint32_t align(uint32_t offset){
+  return (offset + SAMPLEBANK_ALIGNMENT - 1) & ~(SAMPLEBANK_ALIGNMENT - 1);
+}
+
+int main(int argc, char** argv) {
+  SampleBankFormat format = SAMPLEBANK_PCM16;
+  int first = 1;
+  if(argc > 1 && !strcmp(argv[1], "-f")){
+    format = SAMPLEBANK_FLOAT32;
+    first++;
+  }
+  int count = argc - first;
+  if(count < 1)
+    errx(1, "Usage: %s [-f] sample.wav ... > samples.bin", argv[0]);
+  if(count > MAX_SAMPLES)
+    errx(1, "Too many samples, maximum %d", MAX_SAMPLES);
+  Sample* samples = (Sample*)calloc(count, sizeof(Sample));
+  int bytes = format == SAMPLEBANK_FLOAT32 ? 4 : 2;
+  uint32_t offset = align(sizeof(SampleBankHeader) + count*sizeof(SampleBankEntry));
+  for(int i=0; i<count; ++i){
+    readWav(argv[first+i], &samples[i]);
+    samples[i].entry.format = format;
+    samples[i].entry.offset = offset;
+    offset = align(offset + samples[i].entry.length*samples[i].entry.channels*bytes);
+  }
+  SampleBankHeader header = { SAMPLEBANK_MAGIC, SAMPLEBANK_VERSION, offset, (uint32_t)count };
+  fwrite(&header, sizeof(header), 1, stdout);
+  for(int i=0; i<count; ++i)
+    fwrite(&samples[i].entry, sizeof(SampleBankEntry), 1, stdout);
+  uint32_t written = sizeof(SampleBankHeader) + count*sizeof(SampleBankEntry);
+  for(int i=0; i<count; ++i){
+    for(; written < samples[i].entry.offset; ++written)
+      fputc(0, stdout);
+    uint32_t len = samples[i].entry.length*samples[i].entry.channels;
+    for(uint32_t j=0; j<len; ++j){
+      float value = samples[i].data[j];
+      if(format == SAMPLEBANK_FLOAT32){
+	fwrite(&value, sizeof(float), 1, stdout);
+      }else{
+	int32_t s = (int32_t)(value*32768.0f + (value < 0 ? -0.5f : 0.5f));
+	int16_t pcm = s > 32767 ? 32767 : (s < -32768 ? -32768 : s);
+	fwrite(&pcm, sizeof(int16_t), 1, stdout);
+      }
+    }
+    written += len*bytes;
+    free(samples[i].data);
+    fprintf(stderr, "%s: %u frames, %u channels, %u Hz\n", samples[i].entry.name,
+	    samples[i].entry.length, samples[i].entry.channels, samples[i].entry.sampleRate);
+  }
+  for(; written < offset; ++written)
+    fputc(0, stdout);
+  free(samples);
+  return 0;
+}
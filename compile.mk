@@ -1,6 +1,7 @@
 BUILDROOT ?= .
 
 C_SRC   = basicmaths.c heap_5.c fastpow.c fastlog.c # sbrk.c
+C_SRC  += kiss_fft.c
 CPP_SRC = main.cpp operators.cpp message.cpp system_tables.cpp
 CPP_SRC += Patch.cpp PatchProcessor.cpp
 CPP_SRC += FloatArray.cpp ComplexFloatArray.cpp ComplexShortArray.cpp FastFourierTransform.cpp ShortFastFourierTransform.cpp 
@@ -19,6 +20,7 @@ CPPFLAGS += -I$(PATCHSOURCE)
 CPPFLAGS += -I$(LIBSOURCE)
 CPPFLAGS += -I$(GENSOURCE)
 CPPFLAGS += -I$(TESTPATCHES)
+CPPFLAGS += -I$(BUILDROOT)/Libraries/KissFFT
 PATCH_C_SRC    = $(wildcard $(PATCHSOURCE)/*.c)
 PATCH_CPP_SRC += $(wildcard $(PATCHSOURCE)/*.cpp)
 PATCH_C_SRC   += $(wildcard $(GENSOURCE)/*.c)
@@ -89,6 +91,10 @@ vpath %.cpp $(GENSOURCE)
 vpath %.c $(GENSOURCE)
 vpath %.s $(GENSOURCE)
 vpath %.c Libraries/syscalls
+vpath %.c Libraries/KissFFT
+
+# mixed radix FFT sizes: allocate from the patch heap
+$(BUILD)/kiss_fft.o: CPPFLAGS += -Dmalloc=pvPortMalloc -Dfree=vPortFree
 
 $(BUILD)/ShortPatchProgram.o: $(SOURCE)/ShortPatchProgram.cpp $(DEPS)
 	@$(CXX) -c $(CPPFLAGS) $(CXXFLAGS) -I$(BUILD) $(SOURCE)/ShortPatchProgram.cpp -o $@
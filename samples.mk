@@ -0,0 +1,23 @@
+BUILDROOT ?= .
+BUILD ?= $(BUILDROOT)/Build
+
+# size of the SAMPLEBANK flash region in Source/flash.ld: one user program slot
+SAMPLEBANK_SIZE = 131072
+
+ifdef SAMPLEFLOAT
+BANKFLAGS = -f
+endif
+
+samples: $(BUILD)/samples.bin
+
+$(BUILDROOT)/Tools/mkbank: LibSource/SampleBankFormat.h Tools/MakeSampleBank.c
+	$(CC) Tools/MakeSampleBank.c -o $@
+
+$(BUILD)/samples.bin: $(BUILDROOT)/Tools/mkbank $(SAMPLES)
+	@test -n "$(SAMPLES)" || (echo "Set SAMPLES to a list of WAV files" && false)
+	@mkdir -p $(BUILD)
+	@$(BUILDROOT)/Tools/mkbank $(BANKFLAGS) $(SAMPLES) > $@
+	@test `wc -c < $@` -le $(SAMPLEBANK_SIZE) || (echo "Sample bank is larger than $(SAMPLEBANK_SIZE) bytes" && rm $@ && false)
+
+clean:
+	rm -f $(BUILDROOT)/Tools/mkbank $(BUILD)/samples.bin
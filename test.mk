@@ -3,7 +3,8 @@ BUILDROOT ?= .
 C_SRC   = basicmaths.c
 C_SRC   += kiss_fft.c
 C_SRC   += fastpow.c fastlog.c
-CPP_SRC += FloatArray.cpp
+CPP_SRC += FloatArray.cpp ComplexFloatArray.cpp FastFourierTransform.cpp
+CPP_SRC += ComplexShortArray.cpp ShortFastFourierTransform.cpp
 CPP_SRC += ShortArray.cpp
 CPP_SRC += Envelope.cpp VoltsPerOctave.cpp Window.cpp
 CPP_SRC += WavetableOscillator.cpp PolyBlepOscillator.cpp